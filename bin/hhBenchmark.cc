@@ -0,0 +1,469 @@
+// Microbenchmarks of the HHAnalyzer helpers (src/Tools.cc) and of the MT2 computation, reporting the time and
+// the number of heap allocations per call. Inputs are generated once before timing:
+//   - lepton pt and |eta| are drawn from the binning of the HLT efficiency maps (every bin weighted equally,
+//     so that all the lookup paths of fillTriggerEfficiencies are exercised), with an even mix of flavours
+//   - jets and MET follow exponential pt spectra typical of the HH signal or of ttbar (see PROFILES)
+//   - HLT objects are placed close to the leptons, with the paths and filters matchOfflineLepton looks for
+// The efficiency maps are found through FileInPath, so the CMSSW environment must be set up.
+//
+//   hhBenchmark [-n events] [-t min_seconds] [-s seed] [--json results.json] [--csv results.csv] [filter]
+//
+// Only the benchmarks whose name contains `filter` are run.
+
+#include <cp3_llbb/HHAnalysis/interface/AllocationHook.h>
+#include <cp3_llbb/HHAnalysis/interface/HHAnalyzer.h>
+#include <cp3_llbb/HHAnalysis/interface/Inputs.h>
+#include <cp3_llbb/HHAnalysis/interface/lester_mt2_bisect.h>
+
+#include <cp3_llbb/TreeWrapper/interface/TreeWrapper.h>
+
+#include <FWCore/ParameterSet/interface/FileInPath.h>
+#include <FWCore/ParameterSet/interface/ParameterSet.h>
+
+#include <TROOT.h>
+#include <TTree.h>
+
+#include <boost/property_tree/json_parser.hpp>
+#include <boost/property_tree/ptree.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+    const std::string EFFICIENCIES_PATH = "cp3_llbb/HHAnalysis/data/Efficiencies/";
+
+    // Same maps as in test/HHConfiguration.py
+    const std::vector<std::pair<std::string, std::string>> HLT_EFFICIENCIES = {
+        {"IsoMu17leg", "Muon_DoubleIsoMu17Mu8_IsoMu17leg.json"},
+        {"IsoMu8orIsoTkMu8leg", "Muon_DoubleIsoMu17TkMu8_IsoMu8legORTkMu8leg.json"},
+        {"DoubleEleHighPtleg", "Electron_IsoEle23Leg.json"},
+        {"DoubleEleLowPtleg", "Electron_IsoEle12Leg.json"},
+        {"EleMuHighPtleg", "Electron_IsoEle23Leg.json"},
+        {"MuEleLowPtleg", "Electron_IsoEle12Leg.json"},
+        {"IsoMu8leg", "Muon_XPathIsoMu8leg.json"},
+        {"IsoMu23leg", "Muon_XPathIsoMu23leg.json"}
+    };
+
+    // Leptons are drawn from the binning of the low-pt legs, which covers the whole selected range
+    const std::string MUON_BINNING = "Muon_DoubleIsoMu17TkMu8_IsoMu8legORTkMu8leg.json";
+    const std::string ELECTRON_BINNING = "Electron_IsoEle12Leg.json";
+
+    // MT2 precisions to compare, in GeV. 0 is the machine precision, 0.5 is what HHAnalyzer uses
+    const std::vector<double> MT2_PRECISIONS = {0, 0.01, 0.1, 0.5, 1};
+
+    struct Profile {
+        std::string name;
+        float jet_pt_mean; // Mean of the exponential jet pt spectrum above the 20 GeV cut
+        float met_pt_mean;
+        int extra_hlt_objects; // Maximum number of HLT objects not matched to the leptons
+    };
+
+    const std::vector<Profile> PROFILES = {
+        {"hh", 45, 50, 2},
+        {"ttbar", 60, 70, 4}
+    };
+
+    const float LEPTON_MIN_PT = 10;
+    const float JET_MIN_PT = 20;
+    const float JET_MAX_ETA = 2.4;
+
+    struct Bin {
+        float abs_eta_min, abs_eta_max;
+        float pt_min, pt_max;
+    };
+
+    // (|eta|, pt) bins of an efficiency map above LEPTON_MIN_PT
+    std::vector<Bin> readBinning(const std::string& file) {
+        boost::property_tree::ptree json;
+        boost::property_tree::read_json(edm::FileInPath(EFFICIENCIES_PATH + file).fullPath(), json);
+
+        auto edges = [](const boost::property_tree::ptree& bin) {
+            std::vector<float> result;
+            for (const auto& edge: bin)
+                result.push_back(edge.second.get_value<float>());
+            return result;
+        };
+
+        std::vector<Bin> bins;
+        for (const auto& eta_bin: json.get_child("data")) {
+            std::vector<float> eta = edges(eta_bin.second.get_child("bin"));
+            for (const auto& pt_bin: eta_bin.second.get_child("values")) {
+                std::vector<float> pt = edges(pt_bin.second.get_child("bin"));
+                if (pt[1] <= LEPTON_MIN_PT)
+                    continue;
+                bins.push_back({eta[0], eta[1], std::max(pt[0], LEPTON_MIN_PT), pt[1]});
+            }
+        }
+
+        return bins;
+    }
+
+    edm::ParameterSet makeConfiguration() {
+        edm::ParameterSet config;
+
+        config.addParameter<std::string>("electronsProducer", "electrons");
+        config.addParameter<std::string>("muonsProducer", "muons");
+        config.addParameter<std::string>("jetsProducer", "jets");
+        config.addParameter<std::string>("metProducer", "met");
+        config.addParameter<std::string>("nohfMETProducer", "nohf_met");
+
+        config.addUntrackedParameter<double>("muonLooseIsoCut", .25);
+        config.addUntrackedParameter<double>("muonTightIsoCut", .15);
+        config.addUntrackedParameter<std::string>("electrons_loose_wp_name", "cutBasedElectronID-Summer16-80X-V1-loose");
+        config.addUntrackedParameter<std::string>("electrons_medium_wp_name", "cutBasedElectronID-Summer16-80X-V1-medium");
+        config.addUntrackedParameter<std::string>("electrons_tight_wp_name", "cutBasedElectronID-Summer16-80X-V1-tight");
+        config.addUntrackedParameter<std::string>("electrons_hlt_safe_wp_name", "cutBasedElectronHLTPreselection-Summer16-V1");
+        config.addUntrackedParameter<std::string>("discr_name", "pfCombinedMVAV2BJetTags");
+        config.addUntrackedParameter<double>("discr_cut_loose", -0.5884);
+        config.addUntrackedParameter<double>("discr_cut_medium", 0.4432);
+        config.addUntrackedParameter<double>("discr_cut_tight", 0.9432);
+        config.addUntrackedParameter<double>("hltDRCut", 0.1);
+        config.addUntrackedParameter<double>("hltDPtCut", 0.5);
+
+        edm::ParameterSet hlt_efficiencies;
+        for (const auto& efficiency: HLT_EFFICIENCIES)
+            hlt_efficiencies.addUntrackedParameter<edm::FileInPath>(efficiency.first, edm::FileInPath(EFFICIENCIES_PATH + efficiency.second));
+        config.addUntrackedParameter<edm::ParameterSet>("hlt_efficiencies", hlt_efficiencies);
+
+        return config;
+    }
+
+    HH::LorentzVector makeP4(float pt, float eta, float phi, float mass) {
+        float p = pt * std::cosh(eta);
+        return HH::LorentzVector(pt, eta, phi, std::sqrt(p * p + mass * mass));
+    }
+
+    struct Sample {
+        HH::Lepton lep1;
+        HH::Lepton lep2;
+        HH::Dilepton dilepton;
+        HH::LorentzVector jet1;
+        HH::LorentzVector jet2;
+        HH::LorentzVector met;
+        HH::EventInputs::HLT hlt;
+    };
+
+    class SampleGenerator {
+        public:
+            SampleGenerator(const Profile& profile, uint32_t seed):
+                m_profile(profile), m_random(seed),
+                m_muon_bins(readBinning(MUON_BINNING)), m_electron_bins(readBinning(ELECTRON_BINNING)) {
+                // Empty
+            }
+
+            Sample generate() {
+                Sample sample;
+
+                // mumu, elel, muel, elmu with equal probabilities
+                int flavours = std::uniform_int_distribution<int>(0, 3)(m_random);
+                bool mu1 = flavours == 0 || flavours == 2;
+                bool mu2 = flavours == 0 || flavours == 3;
+                sample.lep1 = makeLepton(mu1, 1);
+                sample.lep2 = makeLepton(mu2, -1);
+                if (sample.lep1.p4.Pt() < sample.lep2.p4.Pt())
+                    std::swap(sample.lep1, sample.lep2);
+
+                HH::Dilepton& dilepton = sample.dilepton;
+                dilepton.p4 = sample.lep1.p4 + sample.lep2.p4;
+                dilepton.ilep1 = 0;
+                dilepton.ilep2 = 1;
+                dilepton.isMuMu = sample.lep1.isMu && sample.lep2.isMu;
+                dilepton.isElEl = sample.lep1.isEl && sample.lep2.isEl;
+                dilepton.isMuEl = sample.lep1.isMu && sample.lep2.isEl;
+                dilepton.isElMu = sample.lep1.isEl && sample.lep2.isMu;
+                dilepton.isSF = dilepton.isMuMu || dilepton.isElEl;
+
+                sample.jet1 = makeP4(jetPt(), uniform(-JET_MAX_ETA, JET_MAX_ETA), uniform(-M_PI, M_PI), uniform(5, 20));
+                sample.jet2 = makeP4(jetPt(), uniform(-JET_MAX_ETA, JET_MAX_ETA), uniform(-M_PI, M_PI), uniform(5, 20));
+                sample.met = makeP4(std::exponential_distribution<float>(1. / m_profile.met_pt_mean)(m_random), 0, uniform(-M_PI, M_PI), 0);
+
+                fillHLT(sample);
+
+                return sample;
+            }
+
+        private:
+            float uniform(float min, float max) {
+                return std::uniform_real_distribution<float>(min, max)(m_random);
+            }
+
+            float jetPt() {
+                return JET_MIN_PT + std::exponential_distribution<float>(1. / m_profile.jet_pt_mean)(m_random);
+            }
+
+            HH::Lepton makeLepton(bool muon, int8_t charge) {
+                const std::vector<Bin>& bins = muon ? m_muon_bins : m_electron_bins;
+                const Bin& bin = bins[std::uniform_int_distribution<size_t>(0, bins.size() - 1)(m_random)];
+
+                float eta = uniform(bin.abs_eta_min, bin.abs_eta_max);
+                if (std::bernoulli_distribution(0.5)(m_random))
+                    eta = -eta;
+
+                HH::Lepton lepton;
+                lepton.p4 = makeP4(uniform(bin.pt_min, bin.pt_max), eta, uniform(-M_PI, M_PI), muon ? 0.106 : 0.000511);
+                lepton.charge = charge;
+                lepton.isMu = muon;
+                lepton.isEl = !muon;
+                lepton.sc_eta = eta;
+                return lepton;
+            }
+
+            // One HLT object per lepton (90% of the time), slightly off the offline lepton, plus a few others
+            void fillHLT(Sample& sample) {
+                std::string path;
+                std::vector<std::string> leg1_filters;
+                std::vector<std::string> leg2_filters;
+                if (sample.dilepton.isMuMu) {
+                    path = "HLT_Mu17_TrkIsoVVL_Mu8_TrkIsoVVL_DZ_v7";
+                    leg1_filters = {"hltL3fL1sDoubleMu114L1f0L2f10OneMuL3Filtered17"};
+                    leg2_filters = {"hltL3pfL1sDoubleMu114L1f0L2pf0L3PreFiltered8"};
+                } else if (sample.dilepton.isElEl) {
+                    path = "HLT_Ele23_Ele12_CaloIdL_TrackIdL_IsoVL_DZ_v9";
+                    leg1_filters = {"hltEle23Ele12CaloIdLTrackIdLIsoVLTrackIsoLeg1Filter"};
+                    leg2_filters = {"hltEle23Ele12CaloIdLTrackIdLIsoVLTrackIsoLeg2Filter"};
+                } else {
+                    path = "HLT_Mu23_TrkIsoVVL_Ele12_CaloIdL_TrackIdL_IsoVL_v3";
+                    leg1_filters = {"hltMu23TrkIsoVVLEle12CaloIdLTrackIdLIsoVLMuonlegL3IsoFiltered23"};
+                    leg2_filters = {"hltMu23TrkIsoVVLEle12CaloIdLTrackIdLIsoVLElectronlegTrackIsoFilter"};
+                }
+
+                HH::EventInputs::HLT& hlt = sample.hlt;
+                hlt.paths.owned() = {path};
+
+                auto addObject = [&hlt](const HH::LorentzVector& p4, int pdg_id, const std::vector<std::string>& paths, const std::vector<std::string>& filters) {
+                    hlt.object_p4.owned().push_back(p4);
+                    hlt.object_pdg_id.owned().push_back(pdg_id);
+                    hlt.object_paths.owned().push_back(paths);
+                    hlt.object_filters.owned().push_back(filters);
+                };
+
+                std::normal_distribution<float> resolution(0, 0.01);
+                for (const HH::Lepton* lepton: {&sample.lep1, &sample.lep2}) {
+                    if (!std::bernoulli_distribution(0.9)(m_random))
+                        continue;
+                    HH::LorentzVector p4 = makeP4(lepton->p4.Pt() * (1 + 2 * resolution(m_random)), lepton->p4.Eta() + resolution(m_random), lepton->p4.Phi() + resolution(m_random), 0);
+                    // The leading lepton usually fires both legs of a same-flavour path
+                    std::vector<std::string> filters = leg2_filters;
+                    if (lepton == &sample.lep1 || !sample.dilepton.isSF)
+                        filters.insert(filters.end(), leg1_filters.begin(), leg1_filters.end());
+                    addObject(p4, lepton->isMu ? 13 : 0, {path}, filters);
+                }
+
+                int extra = std::uniform_int_distribution<int>(0, m_profile.extra_hlt_objects)(m_random);
+                for (int i = 0; i < extra; i++)
+                    addObject(makeP4(jetPt(), uniform(-JET_MAX_ETA, JET_MAX_ETA), uniform(-M_PI, M_PI), 0), 0, {"HLT_PFJet40_v8"}, {"hltSinglePFJet40"});
+            }
+
+            const Profile& m_profile;
+            std::mt19937 m_random;
+            std::vector<Bin> m_muon_bins;
+            std::vector<Bin> m_electron_bins;
+    };
+
+    struct Result {
+        std::string name;
+        uint64_t calls;
+        double ns_per_call;
+        double allocations_per_call;
+        double bytes_per_call;
+    };
+
+    // Keeps the results of the benchmarked functions alive
+    volatile double sink = 0;
+
+    class Benchmarks {
+        public:
+            Benchmarks(const std::string& filter, double min_seconds):
+                m_filter(filter), m_min_seconds(min_seconds) {
+                // Empty
+            }
+
+            // Call f(i) for i in [0, n) until min_seconds have elapsed. A first untimed pass warms up the caches
+            // and lets the thread_local buffers of the kernels reach their final size
+            template <typename F> void run(const std::string& name, size_t n, F f) {
+                if (name.find(m_filter) == std::string::npos || n == 0)
+                    return;
+
+                for (size_t i = 0; i < n; i++)
+                    f(i);
+
+                uint64_t calls = 0;
+                HH::AllocationCount allocations_before = HH::threadAllocations();
+                auto start = std::chrono::steady_clock::now();
+                std::chrono::duration<double> elapsed;
+                do {
+                    for (size_t i = 0; i < n; i++)
+                        f(i);
+                    calls += n;
+                    elapsed = std::chrono::steady_clock::now() - start;
+                } while (elapsed.count() < m_min_seconds);
+
+                HH::AllocationCount allocations = HH::threadAllocations() - allocations_before;
+                m_results.push_back({name, calls, elapsed.count() * 1e9 / calls,
+                        static_cast<double>(allocations.allocations) / calls,
+                        static_cast<double>(allocations.bytes) / calls});
+
+                const Result& r = m_results.back();
+                std::cout << std::left << std::setw(40) << r.name << std::right << std::fixed
+                    << std::setw(12) << std::setprecision(1) << r.ns_per_call << " ns/call"
+                    << std::setw(10) << std::setprecision(2) << r.allocations_per_call << " allocs/call"
+                    << std::setw(10) << std::setprecision(0) << r.bytes_per_call << " bytes/call" << std::endl;
+            }
+
+            const std::vector<Result>& results() const { return m_results; }
+
+        private:
+            std::string m_filter;
+            double m_min_seconds;
+            std::vector<Result> m_results;
+    };
+
+    void usage(const char* program) {
+        std::cerr << "Usage: " << program << " [-n events] [-t min_seconds] [-s seed] [--json results.json] [--csv results.csv] [filter]" << std::endl;
+    }
+}
+
+int main(int argc, char** argv) {
+    // Before any ROOT object is created, as in hhReplay
+    ROOT::EnableThreadSafety();
+
+    size_t n_samples = 10000;
+    double min_seconds = 0.5;
+    uint32_t seed = 42;
+    std::string json_path;
+    std::string csv_path;
+    std::string filter;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-n" && i + 1 < argc) {
+            n_samples = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "-t" && i + 1 < argc) {
+            min_seconds = std::strtod(argv[++i], nullptr);
+        } else if (arg == "-s" && i + 1 < argc) {
+            seed = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--json" && i + 1 < argc) {
+            json_path = argv[++i];
+        } else if (arg == "--csv" && i + 1 < argc) {
+            csv_path = argv[++i];
+        } else if (filter.empty() && arg[0] != '-') {
+            filter = arg;
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (n_samples == 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    TTree tree("benchmark", "benchmark");
+    ROOT::TreeWrapper wrapper(&tree);
+    HHAnalyzer analyzer("hh_analyzer", wrapper.group("hh_"), makeConfiguration());
+    analyzer.leptons.resize(2);
+
+    Benchmarks benchmarks(filter, min_seconds);
+
+    for (const Profile& profile: PROFILES) {
+        SampleGenerator generator(profile, seed);
+        std::vector<Sample> samples;
+        samples.reserve(n_samples);
+        for (size_t i = 0; i < n_samples; i++)
+            samples.push_back(generator.generate());
+
+        // The L1 EMTF checks are only done on di-muon pairs
+        std::vector<const Sample*> mumu_samples;
+        for (const Sample& sample: samples) {
+            if (sample.dilepton.isMuMu)
+                mumu_samples.push_back(&sample);
+        }
+
+        const std::string prefix = profile.name + "/";
+
+        benchmarks.run(prefix + "getCosThetaStar_CS", samples.size(), [&](size_t i) {
+            const Sample& s = samples[i];
+            sink = sink + analyzer.getCosThetaStar_CS(s.dilepton.p4 + s.met, s.jet1 + s.jet2);
+        });
+
+        benchmarks.run(prefix + "getMELAAngles", samples.size(), [&](size_t i) {
+            const Sample& s = samples[i];
+            sink = sink + analyzer.getMELAAngles(s.dilepton.p4 + s.met, s.jet1 + s.jet2, s.lep1.p4, s.lep2.p4, s.jet1, s.jet2).phi;
+        });
+
+        benchmarks.run(prefix + "matchOfflineLepton", samples.size(), [&](size_t i) {
+            Sample& s = samples[i];
+            analyzer.leptons[0] = s.lep1;
+            analyzer.leptons[1] = s.lep2;
+            analyzer.matchOfflineLepton(s.hlt, s.dilepton);
+            sink = sink + analyzer.leptons[0].hlt_idx;
+        });
+
+        benchmarks.run(prefix + "fillTriggerEfficiencies", samples.size(), [&](size_t i) {
+            Sample& s = samples[i];
+            analyzer.fillTriggerEfficiencies(s.lep1, s.lep2, s.dilepton);
+            sink = sink + s.dilepton.trigger_efficiency;
+        });
+
+        benchmarks.run(prefix + "isCSCSameSector", mumu_samples.size(), [&](size_t i) {
+            const Sample& s = *mumu_samples[i];
+            sink = sink + analyzer.isCSCSameSector(s.lep1, s.lep2);
+        });
+
+        benchmarks.run(prefix + "isCSCWithOverlap", mumu_samples.size(), [&](size_t i) {
+            const Sample& s = *mumu_samples[i];
+            sink = sink + analyzer.isCSCWithOverlap(s.lep1, s.lep2);
+        });
+
+        for (double precision: MT2_PRECISIONS) {
+            std::ostringstream name;
+            name << prefix << "get_mT2/precision=" << precision;
+            benchmarks.run(name.str(), samples.size(), [&](size_t i) {
+                const Sample& s = samples[i];
+                double px_invisible = s.lep1.p4.px() + s.lep2.p4.px() + s.met.px();
+                double py_invisible = s.lep1.p4.py() + s.lep2.p4.py() + s.met.py();
+                sink = sink + asymm_mt2_lester_bisect::get_mT2(
+                        s.jet1.M(), s.jet1.px(), s.jet1.py(),
+                        s.jet2.M(), s.jet2.px(), s.jet2.py(),
+                        px_invisible, py_invisible,
+                        s.lep1.p4.M(), s.lep2.p4.M(),
+                        precision);
+            });
+        }
+    }
+
+    const std::vector<Result>& results = benchmarks.results();
+
+    if (!json_path.empty()) {
+        std::ofstream json(json_path);
+        json << "{\n  \"events\": " << n_samples << ",\n  \"seed\": " << seed << ",\n  \"benchmarks\": [";
+        for (size_t i = 0; i < results.size(); i++) {
+            const Result& r = results[i];
+            json << (i ? "," : "") << "\n    {\"name\": \"" << r.name << "\", \"calls\": " << r.calls
+                << ", \"ns_per_call\": " << r.ns_per_call << ", \"allocations_per_call\": " << r.allocations_per_call
+                << ", \"bytes_per_call\": " << r.bytes_per_call << "}";
+        }
+        json << "\n  ]\n}" << std::endl;
+    }
+
+    if (!csv_path.empty()) {
+        std::ofstream csv(csv_path);
+        csv << "name,calls,ns_per_call,allocations_per_call,bytes_per_call" << std::endl;
+        for (const Result& r: results)
+            csv << r.name << "," << r.calls << "," << r.ns_per_call << "," << r.allocations_per_call << "," << r.bytes_per_call << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,404 @@
+// Run HHAnalyzer on inputs captured from a real job (captureInputs parameter), without CMSSW, the Framework
+// producers or the original MINIAOD files. Events are loaded in memory first, so the measured rate does
+// not include reading the capture file.
+//
+//   hhReplay inputs.bin [-n loops] [-o output.root] [--timers] [--memory] [--trace trace.json] [--golden golden.root [--tolerance pattern=value]...] [--json report.json]
+//
+// --memory sets memoryReport: heap allocations per stage and per event (counted by the allocation hook compiled
+// in this executable), peak capacity of the analyzer collections, and bytes written per branch.
+// --trace writes the timeline of the stages of every event as Chrome trace-event JSON (see Trace.h).
+//
+// With --golden, every branch of the output is compared, event by event, to the same branch of a reference
+// output. Values must be identical, unless a relative tolerance is given for the branch. Patterns are matched against
+// the whole branch name, prefix included, with '*' wildcards allowed: `--tolerance 'hh_llmetjj.MT2=1e-4'` (struct
+// output), `--tolerance 'hh_llmetjj_MT2=1e-4'` (flat output). The reference is either:
+//   - the output of an earlier hhReplay run on the same inputs. All the passes are compared, so it must have been
+//     produced with the same -n;
+//   - the output file of a Framework job over the same events, e.g. with an older version of the analyzer. Its
+//     events are found by their event_run, event_lumi and event_event branches, every pass is compared with them,
+//     and only the branches of the replayed analyzer are compared. The replayed events it does not hold (the
+//     Framework only writes the events in a category) are counted, not compared.
+// The exit code is 2 if anything differs. test/checkReplay.sh runs the check on the reference inputs of test/replay.
+
+#include <cp3_llbb/HHAnalysis/interface/AllocationHook.h>
+#include <cp3_llbb/HHAnalysis/interface/Configuration.h>
+#include <cp3_llbb/HHAnalysis/interface/FlatOutput.h>
+#include <cp3_llbb/HHAnalysis/interface/HHAnalyzer.h>
+#include <cp3_llbb/HHAnalysis/interface/Inputs.h>
+
+#include <cp3_llbb/TreeWrapper/interface/TreeWrapper.h>
+
+#include <FWCore/ParameterSet/interface/ParameterSet.h>
+
+#include <TBranch.h>
+#include <TFile.h>
+#include <TLeaf.h>
+#include <TObjArray.h>
+#include <TROOT.h>
+#include <TTree.h>
+#include <TTreeFormula.h>
+
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace {
+    void usage(const char* program) {
+        std::cerr << "Usage: " << program << " inputs.bin [-n loops] [-o output.root] [--timers] [--memory] [--trace trace.json] [--golden golden.root [--tolerance pattern=value]...] [--json report.json]" << std::endl;
+    }
+
+    // Maximum number of differences printed
+    const size_t MAX_REPORTED_DIFFERENCES = 20;
+
+    // Event id branches of the Framework output, written by the `event` producer
+    const std::string RUN_BRANCH = "event_run";
+    const std::string LUMI_BRANCH = "event_lumi";
+    const std::string EVENT_BRANCH = "event_event";
+    // (run, lumi, event)
+    typedef std::tuple<uint64_t, uint64_t, uint64_t> EventId;
+
+    // Peak resident set size of the process, in MB
+    double peakRSS() {
+        struct rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        return usage.ru_maxrss / 1024.;
+    }
+
+    // One TTreeFormula expression per leaf of the tree. The top branch of a split collection is compared
+    // through its size, its members through their own branches
+    std::vector<std::string> leafExpressions(TTree* tree) {
+        std::vector<std::string> expressions;
+        TObjArray* leaves = tree->GetListOfLeaves();
+        for (int i = 0; i < leaves->GetEntries(); i++) {
+            TLeaf* leaf = static_cast<TLeaf*>(leaves->At(i));
+            TBranch* branch = leaf->GetBranch();
+            std::string name = branch->GetName();
+            if (branch->GetListOfBranches()->GetEntries() > 0)
+                expressions.push_back(name + "@.size()");
+            else if (branch->GetListOfLeaves()->GetEntries() > 1)
+                expressions.push_back(name + "." + leaf->GetName());
+            else
+                expressions.push_back(name);
+        }
+        return expressions;
+    }
+
+    // Bytes written per branch, uncompressed and compressed, largest first
+    void reportBranchBytes(TTree* tree, std::ostream& out) {
+        std::vector<TBranch*> branches;
+        TObjArray* list = tree->GetListOfBranches();
+        for (int i = 0; i < list->GetEntries(); i++)
+            branches.push_back(static_cast<TBranch*>(list->At(i)));
+        std::sort(branches.begin(), branches.end(), [](TBranch* a, TBranch* b) { return a->GetZipBytes("*") > b->GetZipBytes("*"); });
+
+        out << std::left << std::setw(48) << "Branch" << std::right << std::setw(16) << "bytes" << std::setw(16) << "compressed" << std::endl;
+        for (TBranch* branch: branches)
+            out << std::left << std::setw(48) << branch->GetName() << std::right
+                << std::setw(16) << branch->GetTotBytes("*") << std::setw(16) << branch->GetZipBytes("*") << std::endl;
+    }
+
+    bool equal(double value, double expected, double tolerance) {
+        if (std::isnan(value) || std::isnan(expected))
+            return std::isnan(value) && std::isnan(expected);
+        return value == expected || std::abs(value - expected) <= tolerance * std::max(std::abs(value), std::abs(expected));
+    }
+
+    struct ComparisonResult {
+        size_t branches = 0;
+        size_t failed_branches = 0;
+        size_t differences = 0;
+    };
+
+    // Compare the entries of `tree`, `loops` passes over `events`, with `golden`, printing the differences. Only the
+    // golden branches starting with `prefix` are compared
+    ComparisonResult compare(TTree* tree, TTree* golden, const std::vector<HH::EventInputs>& events, size_t loops, const std::string& prefix,
+            const std::vector<std::pair<std::string, double>>& tolerances) {
+        ComparisonResult result;
+        std::set<std::string> failed;
+
+        auto fail = [&result, &failed](const std::string& expression, const std::string& message) {
+            if (result.differences++ < MAX_REPORTED_DIFFERENCES)
+                std::cout << "    " << expression << ": " << message << std::endl;
+            failed.insert(expression);
+        };
+
+        // Golden entry of each replayed one, -1 if the golden file does not have this event
+        long long n_events = events.size() * loops;
+        std::vector<long long> golden_entries(n_events, -1);
+        if (golden->GetBranch(EVENT_BRANCH.c_str())) {
+            TTreeFormula run("run", RUN_BRANCH.c_str(), golden);
+            TTreeFormula lumi("lumi", LUMI_BRANCH.c_str(), golden);
+            TTreeFormula event("event", EVENT_BRANCH.c_str(), golden);
+            std::map<EventId, long long> golden_index;
+            for (long long entry = 0; entry < golden->GetEntries(); entry++) {
+                golden->LoadTree(entry);
+                run.GetNdata();
+                lumi.GetNdata();
+                event.GetNdata();
+                golden_index[EventId(run.EvalInstance(), lumi.EvalInstance(), event.EvalInstance())] = entry;
+            }
+
+            std::set<long long> replayed_golden_entries;
+            for (long long entry = 0; entry < n_events; entry++) {
+                const HH::EventInputs& inputs = events[entry % events.size()];
+                auto it = golden_index.find(EventId(inputs.run, inputs.lumi, inputs.event));
+                if (it == golden_index.end())
+                    continue;
+                golden_entries[entry] = it->second;
+                replayed_golden_entries.insert(it->second);
+            }
+
+            long long missing = n_events - std::count_if(golden_entries.begin(), golden_entries.end(), [](long long entry) { return entry >= 0; });
+            std::cout << "    " << missing << " of the " << n_events << " replayed events are not in the golden file, and are not compared" << std::endl;
+            if (static_cast<long long>(replayed_golden_entries.size()) != golden->GetEntries())
+                fail("entries", std::to_string(golden->GetEntries() - replayed_golden_entries.size()) + " events of the golden file were not replayed");
+        } else {
+            if (golden->GetEntries() != n_events)
+                fail("entries", std::to_string(n_events) + " events replayed (" + std::to_string(loops) + " x " + std::to_string(events.size())
+                        + "), " + std::to_string(golden->GetEntries()) + " in the golden file");
+            for (long long entry = 0; entry < std::min(golden->GetEntries(), n_events); entry++)
+                golden_entries[entry] = entry;
+        }
+
+        std::vector<std::string> expressions;
+        for (const std::string& expression: leafExpressions(golden)) {
+            if (expression.compare(0, prefix.size(), prefix) == 0)
+                expressions.push_back(expression);
+        }
+        std::vector<std::string> output_expressions = leafExpressions(tree);
+        for (const std::string& expression: output_expressions) {
+            if (std::find(expressions.begin(), expressions.end(), expression) == expressions.end())
+                fail(expression, "not in the golden file");
+        }
+
+        for (const std::string& expression: expressions) {
+            result.branches++;
+            if (std::find(output_expressions.begin(), output_expressions.end(), expression) == output_expressions.end()) {
+                fail(expression, "missing from the output");
+                continue;
+            }
+
+            double tolerance = 0;
+            for (const auto& t: tolerances) {
+                if (HH::wildcardMatch(t.first, expression))
+                    tolerance = t.second;
+            }
+
+            TTreeFormula formula("output", expression.c_str(), tree);
+            TTreeFormula golden_formula("golden", expression.c_str(), golden);
+            if (formula.GetNdim() == 0 || golden_formula.GetNdim() == 0) {
+                fail(expression, "cannot be read");
+                continue;
+            }
+
+            for (long long entry = 0; entry < n_events; entry++) {
+                if (golden_entries[entry] < 0)
+                    continue;
+                tree->LoadTree(entry);
+                golden->LoadTree(golden_entries[entry]);
+
+                auto where = [&events, entry]() {
+                    const HH::EventInputs& event = events[entry % events.size()];
+                    return "event " + std::to_string(event.run) + ":" + std::to_string(event.lumi) + ":" + std::to_string(event.event) + " (entry " + std::to_string(entry) + ")";
+                };
+
+                int n = formula.GetNdata();
+                int golden_n = golden_formula.GetNdata();
+                if (n != golden_n) {
+                    fail(expression, where() + ", " + std::to_string(n) + " values, expected " + std::to_string(golden_n));
+                    continue;
+                }
+
+                for (int i = 0; i < n; i++) {
+                    double value = formula.EvalInstance(i);
+                    double expected = golden_formula.EvalInstance(i);
+                    if (!equal(value, expected, tolerance))
+                        fail(expression, where() + ", element " + std::to_string(i) + ": " + std::to_string(value) + ", expected " + std::to_string(expected));
+                }
+            }
+        }
+
+        if (result.differences > MAX_REPORTED_DIFFERENCES)
+            std::cout << "    ... and " << result.differences - MAX_REPORTED_DIFFERENCES << " more differences" << std::endl;
+
+        result.failed_branches = failed.size();
+        return result;
+    }
+}
+
+int main(int argc, char** argv) {
+    // Before any ROOT object is created: an asynchronous skim fills its trees from a background thread
+    ROOT::EnableThreadSafety();
+
+    std::string inputs_path;
+    std::string output_path = "hhReplay.root";
+    std::string golden_path;
+    std::string json_path;
+    std::vector<std::pair<std::string, double>> tolerances;
+    size_t loops = 1;
+    bool timers = false;
+    bool memory = false;
+    std::string trace_path;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-n" && i + 1 < argc) {
+            loops = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "-o" && i + 1 < argc) {
+            output_path = argv[++i];
+        } else if (arg == "--timers") {
+            timers = true;
+        } else if (arg == "--memory") {
+            memory = true;
+        } else if (arg == "--trace" && i + 1 < argc) {
+            trace_path = argv[++i];
+        } else if (arg == "--golden" && i + 1 < argc) {
+            golden_path = argv[++i];
+        } else if (arg == "--tolerance" && i + 1 < argc) {
+            std::string tolerance = argv[++i];
+            size_t separator = tolerance.find('=');
+            if (separator == std::string::npos) {
+                usage(argv[0]);
+                return 1;
+            }
+            tolerances.emplace_back(tolerance.substr(0, separator), std::strtod(tolerance.c_str() + separator + 1, nullptr));
+        } else if (arg == "--json" && i + 1 < argc) {
+            json_path = argv[++i];
+        } else if (inputs_path.empty() && arg[0] != '-') {
+            inputs_path = arg;
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (inputs_path.empty() || loops == 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    HH::InputsReader reader(inputs_path);
+    std::vector<HH::EventInputs> events;
+    HH::EventInputs inputs;
+    while (reader.next(inputs))
+        events.push_back(inputs);
+
+    std::cout << "Loaded " << events.size() << " events captured from analyzer '" << reader.analyzerName() << "'" << std::endl;
+    if (events.empty())
+        return 0;
+
+    edm::ParameterSet config(reader.configuration());
+    // Do not capture again what is being replayed, and do not overwrite the other outputs of the job the inputs
+    // were captured from: only the tree and the files given on the command line are written
+    config.addUntrackedParameter<std::string>("captureInputs", "");
+    config.addUntrackedParameter<std::string>("slowEventsFile", "");
+    config.addUntrackedParameter<std::vector<edm::ParameterSet>>("histograms", {});
+    config.addUntrackedParameter<std::string>("histogramsFile", "");
+    config.addUntrackedParameter<edm::ParameterSet>("cutScan", edm::ParameterSet());
+    config.addUntrackedParameter<edm::ParameterSet>("skim", edm::ParameterSet());
+    config.addUntrackedParameter<std::string>("recordsFile", "");
+    config.addUntrackedParameter<std::string>("traceFile", trace_path);
+    config.addUntrackedParameter<unsigned int>("traceSampling", 1);
+    if (timers)
+        config.addUntrackedParameter<bool>("stageTimers", true);
+    if (memory)
+        config.addUntrackedParameter<bool>("memoryReport", true);
+
+    // Outputs added to the analyzer later must be disabled above as well. Kept alive so that the analyzer
+    // shares it instead of parsing the configuration again
+    std::shared_ptr<const HH::AnalyzerConfiguration> analyzer_config = HH::AnalyzerConfiguration::get(config);
+    for (const std::string& file: analyzer_config->outputFiles()) {
+        if (file != trace_path) {
+            std::cerr << "Refusing to replay: the analyzer would write '" << file << "', which was not requested" << std::endl;
+            return 1;
+        }
+    }
+
+    std::unique_ptr<TFile> output(TFile::Open(output_path.c_str(), "recreate"));
+    TTree* tree = new TTree("t", "t");
+    ROOT::TreeWrapper wrapper(tree);
+
+    HHAnalyzer analyzer(reader.analyzerName(), wrapper.group(reader.analyzerName() + "_"), config);
+
+    std::chrono::steady_clock::duration analysis_time = std::chrono::steady_clock::duration::zero();
+    auto start = std::chrono::steady_clock::now();
+    for (size_t loop = 0; loop < loops; loop++) {
+        for (const HH::EventInputs& event: events) {
+            auto event_start = std::chrono::steady_clock::now();
+            analyzer.analyze(event);
+            analysis_time += std::chrono::steady_clock::now() - event_start;
+
+            wrapper.fill();
+        }
+    }
+    std::chrono::duration<double> total_time = std::chrono::steady_clock::now() - start;
+
+    size_t n_events = loops * events.size();
+    double analysis_seconds = std::chrono::duration<double>(analysis_time).count();
+    double analysis_rate = n_events / analysis_seconds;
+    double total_rate = n_events / total_time.count();
+    std::cout << "Processed " << n_events << " events in " << total_time.count() << " s" << std::endl;
+    std::cout << "    analysis only: " << analysis_rate << " events/s" << std::endl;
+    std::cout << "    analysis and tree filling: " << total_rate << " events/s" << std::endl;
+    std::cout << "    peak RSS: " << peakRSS() << " MB" << std::endl;
+
+    if (timers) {
+        std::cout << "Time spent in each stage:" << std::endl;
+        analyzer.stageTimings().report(std::cout);
+    }
+
+    if (memory) {
+        std::cout << "Heap allocations in each stage:" << std::endl;
+        analyzer.stageTimings().reportAllocations(std::cout);
+        analyzer.memoryStats().report(std::cout);
+    }
+
+    output->cd();
+    tree->Write();
+
+    if (memory) {
+        std::cout << "Bytes written per branch:" << std::endl;
+        reportBranchBytes(tree, std::cout);
+    }
+
+    ComparisonResult comparison;
+    if (!golden_path.empty()) {
+        std::unique_ptr<TFile> golden_file(TFile::Open(golden_path.c_str()));
+        TTree* golden = nullptr;
+        if (golden_file && !golden_file->IsZombie())
+            golden_file->GetObject("t", golden);
+        if (!golden) {
+            std::cerr << "Cannot read the tree of the golden file '" << golden_path << "'" << std::endl;
+            return 1;
+        }
+
+        std::cout << "Comparing with '" << golden_path << "':" << std::endl;
+        comparison = compare(tree, golden, events, loops, reader.analyzerName() + "_", tolerances);
+        std::cout << comparison.branches << " branches compared, " << comparison.failed_branches << " with differences" << std::endl;
+    }
+
+    if (!json_path.empty()) {
+        std::ofstream json(json_path);
+        json << "{\n  \"events\": " << n_events << ",\n  \"analysis_events_per_second\": " << analysis_rate
+            << ",\n  \"events_per_second\": " << total_rate << ",\n  \"peak_rss_mb\": " << peakRSS();
+        if (!golden_path.empty())
+            json << ",\n  \"compared_branches\": " << comparison.branches << ",\n  \"failed_branches\": " << comparison.failed_branches
+                << ",\n  \"differences\": " << comparison.differences;
+        json << "\n}" << std::endl;
+    }
+
+    return comparison.differences ? 2 : 0;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+// Replacement of the global operator new / delete counting the allocations of each thread in
+// HH::threadAllocations(). Include it in exactly one source file of an executable (bin/hhReplay.cc,
+// bin/hhBenchmark.cc). Never in the library or the plugins: it would replace the allocator of the whole
+// cmsRun process. The array and nothrow forms of operator new end up here as well
+
+#include <cp3_llbb/HHAnalysis/interface/Allocations.h>
+
+#include <cstdlib>
+#include <new>
+
+namespace {
+    struct AllocationHookRegistration {
+        AllocationHookRegistration() {
+            HH::installAllocationHook();
+        }
+    } s_allocation_hook_registration;
+}
+
+void* operator new(std::size_t size) {
+    HH::AllocationCount& count = HH::threadAllocations();
+    count.allocations++;
+    count.bytes += size;
+    if (void* p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
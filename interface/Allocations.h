@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cp3_llbb/HHAnalysis/interface/Types.h>
+
+#include <array>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace HH {
+
+    struct AllocationCount {
+        uint64_t allocations = 0;
+        uint64_t bytes = 0;
+
+        AllocationCount& operator+=(const AllocationCount& other) {
+            allocations += other.allocations;
+            bytes += other.bytes;
+            return *this;
+        }
+
+        AllocationCount operator-(const AllocationCount& other) const {
+            AllocationCount result;
+            result.allocations = allocations - other.allocations;
+            result.bytes = bytes - other.bytes;
+            return result;
+        }
+    };
+
+    // Heap allocations done so far by the calling thread. They are only counted when the executable includes
+    // interface/AllocationHook.h (hhReplay, hhBenchmark): in a cmsRun job they stay at zero
+    AllocationCount& threadAllocations();
+    bool allocationHookInstalled();
+    void installAllocationHook();
+
+    // Heap usage of HHAnalyzer::analyze, collected when memoryReport is set
+    struct MemoryStats {
+        // The first events of each thread, while the buffers grow, are not counted in the steady state
+        static const uint64_t WARMUP_EVENTS = 100;
+
+        enum Collection { Leptons, Jets, Ll, Jj, Llmetjj, CollectionCount };
+        static const std::array<std::string, CollectionCount> collection_names;
+
+        uint64_t events = 0;
+        AllocationCount steady_state;
+        uint64_t steady_state_events = 0;
+        // Largest number of allocations in a single event
+        uint64_t max_event_allocations = 0;
+        // Largest capacity reached by the analyzer collections
+        std::array<size_t, CollectionCount> peak_capacity {};
+
+        void addEvent(const AllocationCount& event);
+        void observe(const std::vector<Lepton>& leptons, const std::vector<Jet>& jets, const std::vector<Dilepton>& ll, const std::vector<Dijet>& jj, const std::vector<DileptonMetDijet>& llmetjj);
+
+        MemoryStats& operator+=(const MemoryStats& other);
+
+        void report(std::ostream& out) const;
+    };
+
+    // Counts the allocations between its construction and its destruction as one event of `stats`.
+    // Does nothing when `stats` is null
+    class EventAllocationCounter {
+        public:
+            EventAllocationCounter(MemoryStats* stats):
+                m_stats(stats) {
+                if (m_stats)
+                    m_start = threadAllocations();
+            }
+
+            ~EventAllocationCounter() {
+                if (m_stats)
+                    m_stats->addEvent(threadAllocations() - m_start);
+            }
+
+            EventAllocationCounter(const EventAllocationCounter&) = delete;
+            EventAllocationCounter& operator=(const EventAllocationCounter&) = delete;
+
+        private:
+            MemoryStats* m_stats;
+            AllocationCount m_start;
+    };
+}
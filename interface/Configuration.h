@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cp3_llbb/Framework/interface/BinnedValues.h>
+#include <cp3_llbb/HHAnalysis/interface/CutScan.h>
+#include <cp3_llbb/HHAnalysis/interface/Dijets.h>
+#include <cp3_llbb/HHAnalysis/interface/FlatOutput.h>
+#include <cp3_llbb/HHAnalysis/interface/Histograms.h>
+#include <cp3_llbb/HHAnalysis/interface/Skim.h>
+#include <cp3_llbb/HHAnalysis/interface/TruthScans.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace edm {
+    class ParameterSet;
+}
+
+namespace HH {
+
+    // "struct": `leptons`, `jets`, `met` and `llmetjj` written as vectors of HH structs; "flat": one primitive branch per member;
+    // "none": nothing written to the tree, e.g. when only the histograms are needed
+    enum class OutputMode { Struct, Flat, None };
+
+    // Configuration of HHAnalyzer, parsed once and never modified afterwards. Shared between all the
+    // analyzers built from an identical PSet (for example the copies made for each systematic) so that
+    // the HLT efficiency maps are only loaded once, and safe to read concurrently from any thread
+    struct AnalyzerConfiguration {
+        static std::shared_ptr<const AnalyzerConfiguration> get(const edm::ParameterSet& config);
+
+        AnalyzerConfiguration(const edm::ParameterSet& config);
+
+        static bool parseGenDeltaRMode(const std::string& mode);
+        static OutputMode parseOutputMode(const std::string& mode);
+        static bool parseTauBRCorrection(const std::string& mode);
+        static SampleType parseSampleType(const std::string& type);
+
+        // Producers name
+        std::string electrons_producer;
+        std::string muons_producer;
+        std::string jets_producer;
+        std::string met_producer;
+        std::string nohf_met_producer;
+        // MET variants of the `met`, `llmet` and `llmetjj` candidates (`imet` is the position in this list). The first
+        // one, metProducer by default, is the nominal MET used by the categories
+        std::vector<std::string> met_producers;
+
+        float electronEtaCut, leadingElectronPtCut, subleadingElectronPtCut;
+        float muonLooseIsoCut, muonTightIsoCut, muonEtaCut, leadingMuonPtCut, subleadingMuonPtCut;
+        float jetEtaCut, jetPtCut, jet_bDiscrCut_loose, jet_bDiscrCut_medium, jet_bDiscrCut_tight;
+        float minDR_l_j_Cut;
+        float hltDRCut, hltDPtCut;
+        std::string jet_bDiscrName;
+        std::string electron_loose_wp_name;
+        std::string electron_medium_wp_name;
+        std::string electron_tight_wp_name;
+        std::string electron_hlt_safe_wp_name;
+        bool applyBJetRegression;
+        std::unordered_map<std::string, std::unique_ptr<BinnedValues>> hlt_efficiencies;
+
+        OutputMode output_mode;
+        OutputPolicy output_policy;
+        // Histograms of llmetjj[0] filled for each category (see HHAnalyzer::selectedCategory), and the ROOT file they are written to at the end of the job
+        std::vector<HistogramDefinition> histograms;
+        std::string histograms_file;
+        // Grid of thresholds whose yields are computed in the same pass, when cutScan is set
+        CutScanGrid cut_scan;
+        // Per-category skim trees and their event index, when skim.file is set
+        SkimConfiguration skim;
+        // If not empty, path of the binary records file of the selected events (see EventRecords.h)
+        std::string records_file;
+        // "dense": one ΔR per reco object for each gen target; "sparse": only the best k reco objects per gen target found
+        bool sparse_gen_deltaR;
+        size_t gen_deltaR_top_k;
+        // "reject": signal events are randomly dropped according to BR(tau -> e / mu); "weight": kept, with the BR stored in `gen_tau_br_weight`
+        bool tau_br_weight;
+        // Key of the event-based random numbers used for the rejection
+        uint32_t tau_br_seed;
+        // Fill the gen truth (HH and ttbar) even for the events that cannot produce an `ll` candidate, e.g. for acceptance studies.
+        // When false, the truth of these events, never written, is skipped
+        bool fill_truth_for_all_events;
+        // Gen truth scans to run (see SampleType; 'all' by default, 'auto' is opt-in), and number of events used by the detection in 'auto' mode
+        SampleType sample_type;
+        uint64_t sample_detection_events;
+        // If not 0, only the leading max_jets_for_pairing jets are used to build `jj` (and so `llmetjj`)
+        size_t max_jets_for_pairing;
+        // Orderings of the jet pairs: `cmva` first, it picks jj[0] and so llmetjj[0], then the other dijetRankings in
+        // the configured order. Number of best cmva pairs kept in `jj` (0: all), plus the best pair of each other ordering
+        std::vector<DijetRanking::DijetRanking> dijet_rankings;
+        size_t max_dijets;
+        // Time each stage of analyze(), report at the end of the job
+        bool stage_timers;
+        // Count the heap allocations per stage and per event, and the peak capacity of the collections (see Allocations.h)
+        bool memory_report;
+        // If not empty, path of the file where the inputs of each event are captured, for bin/hhReplay
+        std::string capture_inputs;
+        // If not empty, path of the file where the inputs of the slow events are captured, in the same format
+        std::string slow_events_file;
+        // An event is slow if analyze() takes longer than this (0: no absolute threshold)
+        uint64_t slow_event_threshold_ns;
+        // ... or longer than this quantile of the previous events (0: no quantile)
+        double slow_event_quantile;
+        // If not empty, path of the Chrome trace-event JSON file with the stages of the sampled events
+        std::string trace_file;
+        // Events whose number is a multiple of trace_sampling are traced
+        uint64_t trace_sampling;
+        // Maximum number of slices kept in memory; the oldest ones are dropped
+        size_t trace_buffer_size;
+
+        // Stage timers are needed for the timing, memory or trace reports
+        bool stageInstrumentation() const {
+            return stage_timers || memory_report || !trace_file.empty();
+        }
+
+        // Files written by the analyzers besides the tree: histograms, cut scan, skim and its index, records,
+        // captured inputs, slow events and trace. Empty paths are not listed
+        std::vector<std::string> outputFiles() const;
+    };
+}
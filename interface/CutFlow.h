@@ -0,0 +1,31 @@
+#pragma once
+
+#include <array>
+#include <string>
+
+namespace HH {
+
+    // Weighted event counts after the main selection steps, stored in the metadata as `<analyzer>_count_<step>`
+    struct CutFlow {
+        enum Step {
+            has2leptons, has2leptons_elel, has2leptons_elmu, has2leptons_muel, has2leptons_mumu,
+            has2leptons_1llmetjj, has2leptons_elel_1llmetjj, has2leptons_elmu_1llmetjj, has2leptons_muel_1llmetjj, has2leptons_mumu_1llmetjj,
+            has2leptons_1llmetjj_2btagM, has2leptons_elel_1llmetjj_2btagM, has2leptons_elmu_1llmetjj_2btagM, has2leptons_muel_1llmetjj_2btagM, has2leptons_mumu_1llmetjj_2btagM,
+            Count
+        };
+
+        static const std::array<std::string, Count> names;
+
+        std::array<float, Count> counts {};
+
+        float& operator[](Step step) {
+            return counts[step];
+        }
+
+        CutFlow& operator+=(const CutFlow& other) {
+            for (size_t i = 0; i < Count; i++)
+                counts[i] += other.counts[i];
+            return *this;
+        }
+    };
+}
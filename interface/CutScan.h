@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cp3_llbb/HHAnalysis/interface/Types.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace edm {
+    class ParameterSet;
+}
+
+namespace HH {
+
+    // Thresholds scanned by the `cutScan` PSet. The grid is the product of the four lists (at most MAX_AXIS_SIZE
+    // values each); an empty list scans the value of the analyzer configuration alone. The scan runs on the
+    // selected objects, so values looser than the analyzer selection have the same effect as the latter
+    struct CutScanGrid {
+        static const size_t MAX_AXIS_SIZE = 64;
+
+        // On the harder and the softer lepton of ll[0]
+        std::vector<float> leading_lepton_pt;
+        std::vector<float> subleading_lepton_pt;
+        // ΔR between a jet and the closest selected lepton
+        std::vector<float> min_dr_l_j;
+        // Cut on the b-tagging discriminant (discr_name) of the paired jets
+        std::vector<float> b_discr;
+        // Text file the yields are written to at the end of the job
+        std::string file;
+
+        CutScanGrid() = default;
+        CutScanGrid(const edm::ParameterSet& config, float min_dr_l_j_cut, float b_discr_cut);
+
+        bool enabled() const { return !file.empty(); }
+        size_t points() const { return leading_lepton_pt.size() * subleading_lepton_pt.size() * min_dr_l_j.size() * b_discr.size(); }
+    };
+
+    // Weighted yields of each grid point and dilepton flavour of ll[0], for the events with an `ll` candidate and two
+    // b-tagged jets among the paired ones (the has2leptons_*_1llmetjj_2btagM steps of the cut flow). Each jet carries
+    // bitmasks of the ΔR and b-tagging points it passes, so one pass over the jets gives the result for the whole grid.
+    // Instances can be summed, e.g. to merge the outputs of several jobs
+    class CutScanYields {
+        public:
+            CutScanYields(const CutScanGrid& grid);
+
+            // `b_discr` is indexed by Jet::idx
+            void fill(size_t category, const Lepton& lep1, const Lepton& lep2, const std::vector<Lepton>& leptons,
+                    const std::vector<Jet>& jets, size_t n_pairing_jets, const std::vector<float>& b_discr, float weight);
+
+            CutScanYields& operator+=(const CutScanYields& other);
+
+            // One line per flavour and grid point: analyzer, flavour, thresholds, sum of weights, sum of squared weights and
+            // entries. The first call for a path in the job recreates the file, the next ones (e.g. the systematic clones) append to it
+            void write(const std::string& path, const std::string& analyzer) const;
+
+        private:
+            size_t index(size_t category, size_t ilead, size_t isublead, size_t idr, size_t ib) const;
+
+            const CutScanGrid* m_grid;
+            std::vector<double> m_sumw;
+            std::vector<double> m_sumw2;
+            std::vector<uint64_t> m_entries;
+
+            // Per-event buffers: number of jets passing each (ΔR, b-tagging) point
+            std::vector<uint32_t> m_jet_counts;
+    };
+}
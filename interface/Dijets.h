@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cp3_llbb/HHAnalysis/interface/Types.h>
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace HH {
+
+    // Orderings of the jet pairs. Names follow HHAnalysis::jetPair, plus `cmva`, the ordering used to pick
+    // the llmetjj candidate. `jp` (jet probability) is not available: the discriminant is not read
+    namespace DijetRanking {
+        enum DijetRanking { ht, mh, pt, csv, cmva, ptOverM, Count };
+        const std::array<std::string, Count> names = {{ "ht", "mh", "pt", "csv", "cmva", "ptOverM" }};
+
+        // Throws for an unknown name
+        DijetRanking parse(const std::string& name);
+    }
+
+    // Ranks the pairs of the leading `n_jets` jets under one or several orderings in a single pass. For
+    // each ordering only the best `k` pairs are kept, in a bounded heap, so that the Dijet structs (gen
+    // flavours, ΔR, ...) only need to be built for the survivors. Buffers are reused from one event to the next
+    class DijetRanker {
+        public:
+            struct Pair {
+                uint32_t ijet1;
+                uint32_t ijet2;
+                float score;
+                // Position in the loop over the pairs, to break ties
+                uint32_t order;
+            };
+
+            // `k` = 0 keeps all the pairs
+            void rank(const std::vector<Jet>& jets, size_t n_jets, const std::vector<DijetRanking::DijetRanking>& rankings, size_t k);
+
+            // Best pairs under rankings[i], best first
+            const std::vector<Pair>& best(size_t i) const { return m_best[i]; }
+
+            // Number of pairs seen by the last rank()
+            size_t pairs() const { return m_pairs; }
+
+        private:
+            std::vector<std::vector<Pair>> m_best;
+            size_t m_pairs = 0;
+    };
+}
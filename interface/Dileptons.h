@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cp3_llbb/HHAnalysis/interface/Types.h>
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace HH {
+
+    // Opposite-sign pair of leptons, `ilep1` < `ilep2` being indices in the pt-sorted lepton collection
+    struct DileptonCandidate {
+        uint32_t ilep1;
+        uint32_t ilep2;
+        float ht;
+        // Position of the pair in the loop over all the pairs (see DileptonCandidates::order)
+        uint32_t order;
+
+        // Filled when the pair goes through the HLT matching: indices of the matched online objects, and
+        // whether the two leptons fire the two legs of a dilepton path
+        std::pair<int8_t, int8_t> hlt_idxs = std::make_pair(-1, -1);
+        bool hlt_legs = false;
+    };
+
+    // Dilepton candidates of one event. The leptons are partitioned by flavour and charge so that only
+    // opposite-sign pairs are built, the first (harder) lepton above its leading pt cut. The candidates are
+    // sorted by decreasing ht, the ranking of `ll`: the expensive steps (HLT matching, trigger efficiencies)
+    // can then be run only on the pairs that matter. Buffers are reused from one event to the next
+    class DileptonCandidates {
+        public:
+            // One entry of the loop over all the pairs ilep1 < ilep2 with ilep1 above its leading pt cut, same-sign
+            // pairs included, in the order of that loop
+            struct Pair {
+                uint32_t ilep1;
+                uint32_t ilep2;
+                // Index in candidates(), -1 for a same-sign pair
+                int32_t candidate;
+            };
+
+            void build(const std::vector<Lepton>& leptons, float leading_electron_pt_cut, float leading_muon_pt_cut);
+
+            std::vector<DileptonCandidate>& candidates() { return m_candidates; }
+            const std::vector<Pair>& order() const { return m_order; }
+
+        private:
+            enum Partition { ElPlus, ElMinus, MuPlus, MuMinus, Count };
+
+            std::vector<uint32_t> m_partitions[Count];
+            std::vector<DileptonCandidate> m_candidates;
+            std::vector<Pair> m_order;
+    };
+}
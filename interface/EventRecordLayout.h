@@ -0,0 +1,189 @@
+#pragma once
+
+// Layout of the event records written with `recordsFile` (see EventRecords.h for the writer, EventRecordReader.h
+// for the reader). Only depends on the standard library, so that it can be used outside CMSSW.
+//
+// Each record is described once, as a list of X(type, name, getter) entries: the getters are expressions on `o`,
+// the object of Types.h the record is built from, only expanded by the writer. The structs, the schema text stored
+// in the file header and the writer are all generated from these lists: adding a field is a one-line change here.
+// The reader refuses files whose schema differs from the one it was compiled with.
+//
+// Booleans are stored as uint8_t after the 4 bytes fields, padded to a multiple of 4 bytes, so that the structs
+// have no implicit padding and the records of a section are contiguous.
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#define HH_EVENT_RECORD_FIELDS(X) \
+    X(uint32_t, size, 0) /* Bytes of the whole event: this record, the sections and the padding to 8 bytes */ \
+    X(uint32_t, analyzer, 0) /* Position of the analyzer in the file trailer */ \
+    X(uint32_t, run, 0) \
+    X(uint32_t, lumi, 0) \
+    X(uint64_t, event, 0) \
+    X(float, weight, 0) \
+    X(uint32_t, n_leptons, 0) \
+    X(uint32_t, n_jets, 0) \
+    X(uint32_t, n_met, 0) \
+    X(uint32_t, n_llmetjj, 0) \
+    X(uint32_t, pad, 0)
+
+#define HH_LEPTON_RECORD_FIELDS(X) \
+    X(float, pt, o.p4.Pt()) \
+    X(float, eta, o.p4.Eta()) \
+    X(float, phi, o.p4.Phi()) \
+    X(float, e, o.p4.E()) \
+    X(int32_t, charge, o.charge) \
+    X(int32_t, idx, o.idx) \
+    X(int32_t, hlt_idx, o.hlt_idx) \
+    X(float, gen_DR, o.gen_DR) \
+    X(float, gen_DPtOverPt, o.gen_DPtOverPt) \
+    X(uint8_t, isMu, o.isMu) \
+    X(uint8_t, isEl, o.isEl) \
+    X(uint8_t, hlt_leg1, o.hlt_leg1) \
+    X(uint8_t, hlt_leg2, o.hlt_leg2) \
+    X(uint8_t, ele_hlt_id, o.ele_hlt_id) \
+    X(uint8_t, gen_matched, o.gen_matched) \
+    X(uint8_t, pad0, 0) \
+    X(uint8_t, pad1, 0)
+
+#define HH_JET_RECORD_FIELDS(X) \
+    X(float, pt, o.p4.Pt()) \
+    X(float, eta, o.p4.Eta()) \
+    X(float, phi, o.p4.Phi()) \
+    X(float, e, o.p4.E()) \
+    X(int32_t, idx, o.idx) \
+    X(float, CSV, o.CSV) \
+    X(float, CMVAv2, o.CMVAv2) \
+    X(float, gen_DR, o.gen_DR) \
+    X(float, gen_DPtOverPt, o.gen_DPtOverPt) \
+    X(uint8_t, btag_M, o.btag_M) \
+    X(uint8_t, gen_matched_bParton, o.gen_matched_bParton) \
+    X(uint8_t, gen_matched_bHadron, o.gen_matched_bHadron) \
+    X(uint8_t, gen_matched, o.gen_matched) \
+    X(uint8_t, gen_b, o.gen_b) \
+    X(uint8_t, gen_c, o.gen_c) \
+    X(uint8_t, gen_l, o.gen_l) \
+    X(uint8_t, pad0, 0)
+
+#define HH_MET_RECORD_FIELDS(X) \
+    X(float, pt, o.p4.Pt()) \
+    X(float, phi, o.p4.Phi()) \
+    X(uint8_t, isNoHF, o.isNoHF) \
+    X(uint8_t, gen_matched, o.gen_matched) \
+    X(uint8_t, pad0, 0) \
+    X(uint8_t, pad1, 0)
+
+// Indices refer to the leptons, jets and met sections of the same event
+#define HH_CANDIDATE_RECORD_FIELDS(X) \
+    X(int32_t, ilep1, o.ilep1) \
+    X(int32_t, ilep2, o.ilep2) \
+    X(int32_t, ijet1, o.ijet1) \
+    X(int32_t, ijet2, o.ijet2) \
+    X(int32_t, imet, o.imet) \
+    X(float, pt, o.p4.Pt()) \
+    X(float, eta, o.p4.Eta()) \
+    X(float, phi, o.p4.Phi()) \
+    X(float, M, o.p4.M()) \
+    X(float, ll_pt, o.ll_p4.Pt()) \
+    X(float, ll_M, o.ll_p4.M()) \
+    X(float, jj_pt, o.jj_p4.Pt()) \
+    X(float, jj_M, o.jj_p4.M()) \
+    X(float, lljj_M, o.lljj_p4.M()) \
+    X(float, DR_l_l, o.DR_l_l) \
+    X(float, DPhi_l_l, o.DPhi_l_l) \
+    X(float, DR_j_j, o.DR_j_j) \
+    X(float, DPhi_j_j, o.DPhi_j_j) \
+    X(float, sumCSV, o.sumCSV) \
+    X(float, sumCMVAv2, o.sumCMVAv2) \
+    X(float, DPhi_ll_met, o.DPhi_ll_met) \
+    X(float, MT, o.MT) \
+    X(float, MT_formula, o.MT_formula) \
+    X(float, projectedMet, o.projectedMet) \
+    X(float, DPhi_jj_met, o.DPhi_jj_met) \
+    X(float, minDR_l_j, o.minDR_l_j) \
+    X(float, maxDR_l_j, o.maxDR_l_j) \
+    X(float, DR_ll_jj, o.DR_ll_jj) \
+    X(float, DPhi_ll_jj, o.DPhi_ll_jj) \
+    X(float, DR_llmet_jj, o.DR_llmet_jj) \
+    X(float, DPhi_llmet_jj, o.DPhi_llmet_jj) \
+    X(float, cosThetaStar_CS, o.cosThetaStar_CS) \
+    X(float, MT_fullsystem, o.MT_fullsystem) \
+    X(float, MT2, o.MT2) \
+    X(float, trigger_efficiency, o.trigger_efficiency) \
+    X(float, trigger_efficiency_downVariated, o.trigger_efficiency_downVariated) \
+    X(float, trigger_efficiency_upVariated, o.trigger_efficiency_upVariated) \
+    X(uint8_t, isElEl, o.isElEl) \
+    X(uint8_t, isElMu, o.isElMu) \
+    X(uint8_t, isMuEl, o.isMuEl) \
+    X(uint8_t, isMuMu, o.isMuMu) \
+    X(uint8_t, isOS, o.isOS) \
+    X(uint8_t, btag_MM, o.btag_MM) \
+    X(uint8_t, gen_matched, o.gen_matched) \
+    X(uint8_t, pad0, 0)
+
+// Records of an event, in this order: EventRecord, then n_leptons LeptonRecord, n_jets JetRecord, n_met MetRecord
+// and n_llmetjj CandidateRecord, then padding up to a multiple of 8 bytes
+#define HH_RECORDS(X) \
+    X(EventRecord, event, HH_EVENT_RECORD_FIELDS) \
+    X(LeptonRecord, lepton, HH_LEPTON_RECORD_FIELDS) \
+    X(JetRecord, jet, HH_JET_RECORD_FIELDS) \
+    X(MetRecord, met, HH_MET_RECORD_FIELDS) \
+    X(CandidateRecord, candidate, HH_CANDIDATE_RECORD_FIELDS)
+
+namespace HH {
+
+    // Name of the field types in the schema text
+    template <typename T> struct RecordFieldType;
+    template <> struct RecordFieldType<float> { static const char* name() { return "float32"; } };
+    template <> struct RecordFieldType<int32_t> { static const char* name() { return "int32"; } };
+    template <> struct RecordFieldType<uint32_t> { static const char* name() { return "uint32"; } };
+    template <> struct RecordFieldType<uint64_t> { static const char* name() { return "uint64"; } };
+    template <> struct RecordFieldType<uint8_t> { static const char* name() { return "uint8"; } };
+
+#define HH_RECORD_MEMBER(TYPE, NAME, GETTER) TYPE NAME;
+#define HH_RECORD_FIELD_SIZE(TYPE, NAME, GETTER) + sizeof(TYPE)
+#define HH_RECORD_STRUCT(STRUCT, NAME, FIELDS) \
+    struct STRUCT { \
+        FIELDS(HH_RECORD_MEMBER) \
+    }; \
+    static_assert(sizeof(STRUCT) == 0 FIELDS(HH_RECORD_FIELD_SIZE), #STRUCT " must not have implicit padding"); \
+    static_assert(sizeof(STRUCT) % 4 == 0, #STRUCT " must be a multiple of 4 bytes");
+
+    HH_RECORDS(HH_RECORD_STRUCT)
+
+#undef HH_RECORD_STRUCT
+#undef HH_RECORD_FIELD_SIZE
+#undef HH_RECORD_MEMBER
+
+    static_assert(sizeof(EventRecord) % 8 == 0, "Events start on 8 bytes boundaries");
+
+    namespace EventRecordFormat {
+        const char MAGIC[8] = {'H', 'H', 'R', 'E', 'C', 'O', 'R', 'D'};
+        const char TRAILER_MAGIC[8] = {'H', 'H', 'R', 'E', 'C', 'E', 'N', 'D'};
+        const uint32_t VERSION = 1;
+        // Written as is: reads back as another value on a machine of the other endianness
+        const uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+        // One "record <name> <size>" line per record, followed by one "field <name> <type> <offset>" line per field
+        inline std::string schema() {
+            std::string result = "version " + std::to_string(VERSION) + "\n";
+#define HH_RECORD_SCHEMA_FIELD(TYPE, NAME, GETTER) \
+            result += "field " #NAME " " + std::string(RecordFieldType<TYPE>::name()) + " " + std::to_string(offsetof(Record, NAME)) + "\n";
+#define HH_RECORD_SCHEMA(STRUCT, NAME, FIELDS) \
+            { \
+                typedef STRUCT Record; \
+                result += "record " #NAME " " + std::to_string(sizeof(Record)) + "\n"; \
+                FIELDS(HH_RECORD_SCHEMA_FIELD) \
+            }
+            HH_RECORDS(HH_RECORD_SCHEMA)
+#undef HH_RECORD_SCHEMA
+#undef HH_RECORD_SCHEMA_FIELD
+            return result;
+        }
+
+        inline size_t padding(size_t size, size_t alignment) {
+            return (alignment - size % alignment) % alignment;
+        }
+    }
+}
@@ -0,0 +1,198 @@
+#pragma once
+
+// Header-only reader of the files written with `recordsFile`, without ROOT nor CMSSW:
+//
+//     HH::EventRecordReader reader("records.bin");
+//     for (size_t i = 0; i < reader.size(); i++) {
+//         HH::EventRecordView event = reader[i];
+//         for (const HH::CandidateRecord& candidate: event.llmetjj())
+//             use(event.header().weight, candidate.MT2, event.leptons()[candidate.ilep1].pt);
+//     }
+//
+// The file is mapped in memory and the views point into it: nothing is copied or decoded, the pages are read by
+// the kernel on first access. Errors are reported as std::runtime_error, so that only the standard library and
+// POSIX are needed.
+
+#include <cp3_llbb/HHAnalysis/interface/EventRecordLayout.h>
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace HH {
+
+    // Contiguous records of one section of an event
+    template <typename T>
+    class RecordSpan {
+        public:
+            RecordSpan(const T* begin, size_t size): m_begin(begin), m_size(size) {}
+
+            const T* begin() const { return m_begin; }
+            const T* end() const { return m_begin + m_size; }
+            size_t size() const { return m_size; }
+            bool empty() const { return m_size == 0; }
+            const T& operator[](size_t i) const { return m_begin[i]; }
+
+        private:
+            const T* m_begin;
+            size_t m_size;
+    };
+
+    // One event of the file: header and sections
+    class EventRecordView {
+        public:
+            EventRecordView(const char* data): m_header(reinterpret_cast<const EventRecord*>(data)) {}
+
+            const EventRecord& header() const { return *m_header; }
+
+            RecordSpan<LeptonRecord> leptons() const {
+                return {reinterpret_cast<const LeptonRecord*>(m_header + 1), m_header->n_leptons};
+            }
+
+            RecordSpan<JetRecord> jets() const {
+                return {reinterpret_cast<const JetRecord*>(leptons().end()), m_header->n_jets};
+            }
+
+            RecordSpan<MetRecord> met() const {
+                return {reinterpret_cast<const MetRecord*>(jets().end()), m_header->n_met};
+            }
+
+            RecordSpan<CandidateRecord> llmetjj() const {
+                return {reinterpret_cast<const CandidateRecord*>(met().end()), m_header->n_llmetjj};
+            }
+
+        private:
+            const EventRecord* m_header;
+    };
+
+    class EventRecordReader {
+        public:
+            EventRecordReader(const std::string& path) {
+                int fd = ::open(path.c_str(), O_RDONLY);
+                if (fd < 0)
+                    throw std::runtime_error("Cannot open '" + path + "'");
+
+                struct stat info;
+                if (::fstat(fd, &info) == 0)
+                    m_size = info.st_size;
+                if (m_size > 0)
+                    m_data = static_cast<const char*>(::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0));
+                ::close(fd);
+                if (m_size == 0 || m_data == MAP_FAILED) {
+                    m_data = nullptr;
+                    throw std::runtime_error("Cannot map '" + path + "'");
+                }
+
+                try {
+                    parse(path);
+                } catch (...) {
+                    ::munmap(const_cast<char*>(m_data), m_size);
+                    throw;
+                }
+            }
+
+            ~EventRecordReader() {
+                ::munmap(const_cast<char*>(m_data), m_size);
+            }
+
+            EventRecordReader(const EventRecordReader&) = delete;
+            EventRecordReader& operator=(const EventRecordReader&) = delete;
+
+            // Number of events
+            size_t size() const { return m_n_events; }
+
+            EventRecordView operator[](size_t i) const {
+                return EventRecordView(m_data + m_offsets[i]);
+            }
+
+            // Name of the analyzers, indexed by EventRecord::analyzer
+            const std::vector<std::string>& analyzers() const { return m_analyzers; }
+
+            // Schema text of the file (see EventRecordFormat::schema()), equal to the one of this reader
+            const std::string& schema() const { return m_schema; }
+
+            // Hint that the events will be read in order
+            void adviseSequential() const {
+                ::madvise(const_cast<char*>(m_data), m_size, MADV_SEQUENTIAL);
+            }
+
+        private:
+            template <typename T> T read(size_t offset) const {
+                if (offset + sizeof(T) > m_size)
+                    throw std::runtime_error("Truncated records file");
+                T value;
+                std::memcpy(&value, m_data + offset, sizeof(T));
+                return value;
+            }
+
+            void parse(const std::string& path) {
+                using namespace EventRecordFormat;
+
+                if (m_size < sizeof(MAGIC) + sizeof(TRAILER_MAGIC) || !std::equal(MAGIC, MAGIC + sizeof(MAGIC), m_data))
+                    throw std::runtime_error("'" + path + "' is not a records file");
+                if (read<uint32_t>(8) != VERSION)
+                    throw std::runtime_error("'" + path + "' has version " + std::to_string(read<uint32_t>(8)) + ", expected " + std::to_string(VERSION));
+                if (read<uint32_t>(12) != BYTE_ORDER_MARK)
+                    throw std::runtime_error("'" + path + "' was written on a machine of the other endianness");
+
+                uint32_t schema_size = read<uint32_t>(16);
+                if (20 + schema_size > m_size)
+                    throw std::runtime_error("Truncated records file '" + path + "'");
+                m_schema.assign(m_data + 20, schema_size);
+                if (m_schema != schema())
+                    throw std::runtime_error("'" + path + "' has a different schema than this reader:\n" + m_schema);
+
+                const char* end = m_data + m_size;
+                if (!std::equal(TRAILER_MAGIC, TRAILER_MAGIC + sizeof(TRAILER_MAGIC), end - sizeof(TRAILER_MAGIC)))
+                    throw std::runtime_error("'" + path + "' is incomplete (no trailer)");
+
+                size_t tail = m_size - sizeof(TRAILER_MAGIC) - 2 * sizeof(uint64_t);
+                uint64_t trailer = read<uint64_t>(tail);
+                m_n_events = read<uint64_t>(tail + sizeof(uint64_t));
+                if (m_n_events > tail / sizeof(uint64_t))
+                    throw std::runtime_error("Corrupted trailer in '" + path + "'");
+                size_t offsets = tail - m_n_events * sizeof(uint64_t);
+                m_offsets = reinterpret_cast<const uint64_t*>(m_data + offsets);
+                if (trailer > offsets)
+                    throw std::runtime_error("Corrupted trailer in '" + path + "'");
+
+                uint32_t n_analyzers = read<uint32_t>(trailer);
+                size_t position = trailer + sizeof(uint32_t);
+                for (uint32_t i = 0; i < n_analyzers; i++) {
+                    uint32_t name_size = read<uint32_t>(position);
+                    position += sizeof(uint32_t);
+                    if (position + name_size > offsets)
+                        throw std::runtime_error("Corrupted trailer in '" + path + "'");
+                    m_analyzers.emplace_back(m_data + position, name_size);
+                    position += name_size;
+                }
+
+                // The header of each event is read once here, so that the section accessors never go past the mapping:
+                // its sections, padded to 8 bytes, must make up `size`, and the event must end before the trailer
+                for (size_t i = 0; i < m_n_events; i++) {
+                    if (m_offsets[i] % 8 != 0 || m_offsets[i] + sizeof(EventRecord) > trailer)
+                        throw std::runtime_error("Corrupted event offsets in '" + path + "'");
+
+                    EventRecord header = read<EventRecord>(m_offsets[i]);
+                    uint64_t content = sizeof(EventRecord) + uint64_t(header.n_leptons) * sizeof(LeptonRecord) + uint64_t(header.n_jets) * sizeof(JetRecord)
+                        + uint64_t(header.n_met) * sizeof(MetRecord) + uint64_t(header.n_llmetjj) * sizeof(CandidateRecord);
+                    if (header.size % 8 != 0 || content > header.size || header.size - content >= 8 || m_offsets[i] + header.size > trailer)
+                        throw std::runtime_error("Corrupted event " + std::to_string(i) + " in '" + path + "'");
+                }
+            }
+
+            const char* m_data = nullptr;
+            size_t m_size = 0;
+            std::string m_schema;
+            std::vector<std::string> m_analyzers;
+            const uint64_t* m_offsets = nullptr;
+            size_t m_n_events = 0;
+    };
+}
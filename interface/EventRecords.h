@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cp3_llbb/HHAnalysis/interface/EventRecordLayout.h>
+#include <cp3_llbb/HHAnalysis/interface/Types.h>
+
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace HH {
+
+    // Writes the selected events as binary records (see EventRecordLayout.h), for readers without ROOT
+    // (EventRecordReader.h). The file is:
+    //   - a header: MAGIC, VERSION, BYTE_ORDER_MARK, size of the schema text, the schema text, padding to 8 bytes;
+    //   - the events, each one starting on a multiple of 8 bytes;
+    //   - a trailer: number of analyzers and their names (size and characters), padding to 8 bytes, the offset
+    //     of each event in the file, the offset of the trailer, the number of events and TRAILER_MAGIC.
+    // Everything is little-endian. One writer per file, shared by the analyzers (nominal and systematic clones)
+    // writing to it; the trailer is written when the last one is destroyed
+    class EventRecordWriter {
+        public:
+            static std::shared_ptr<EventRecordWriter> get(const std::string& path);
+
+            EventRecordWriter(const std::string& path);
+            ~EventRecordWriter();
+
+            EventRecordWriter(const EventRecordWriter&) = delete;
+            EventRecordWriter& operator=(const EventRecordWriter&) = delete;
+
+            // Position of a new analyzer in the trailer, stored in the `analyzer` field of its events
+            uint32_t addAnalyzer(const std::string& name);
+
+            // Thread-safe
+            void write(uint32_t analyzer, uint32_t run, uint32_t lumi, uint64_t event, float weight,
+                    const std::vector<Lepton>& leptons, const std::vector<Jet>& jets, const std::vector<Met>& met, const std::vector<DileptonMetDijet>& llmetjj);
+
+        private:
+            template <typename T> void writeValue(const T& value) {
+                m_file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+            }
+            void writePadding();
+
+            std::string m_path;
+            std::mutex m_mutex;
+            std::ofstream m_file;
+            uint64_t m_offset = 0;
+            std::vector<std::string> m_analyzers;
+            std::vector<uint64_t> m_events;
+    };
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cp3_llbb/HHAnalysis/interface/StageTimers.h>
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+namespace HH {
+
+    // Histogram of small non-negative integers: exact up to 255, larger values are only counted
+    // in an overflow bin (count, mean and max stay exact)
+    class CountHistogram {
+        public:
+            void add(uint64_t value) {
+                m_bins[value < N_BINS - 1 ? value : N_BINS - 1]++;
+                m_count++;
+                m_sum += value;
+                if (value > m_max)
+                    m_max = value;
+            }
+
+            CountHistogram& operator+=(const CountHistogram& other);
+
+            uint64_t count() const { return m_count; }
+            double mean() const { return m_count ? static_cast<double>(m_sum) / m_count : 0; }
+            uint64_t max() const { return m_max; }
+            // Value of the quantile q (0 < q <= 1), or max() if it falls in the overflow
+            uint64_t quantile(double q) const;
+
+        private:
+            static const size_t N_BINS = 257;
+
+            std::array<uint64_t, N_BINS> m_bins {};
+            uint64_t m_count = 0;
+            uint64_t m_sum = 0;
+            uint64_t m_max = 0;
+    };
+
+    // Size of the combinatorics of each event and time spent in analyze(), reported at the end of the job.
+    // The pathological events (many jets, thousands of llmetjj candidates) show up in the tails
+    struct EventStatistics {
+        enum Quantity { Leptons, Jets, Ll, Jj, Llmetjj, Count };
+        static const std::array<std::string, Count> names;
+
+        std::array<CountHistogram, Count> multiplicities;
+        DurationHistogram time;
+        // Time of the last event
+        uint64_t last_time = 0;
+        // Events where only the leading maxJetsForPairing jets were paired
+        uint64_t capped_events = 0;
+        // Events written to slowEventsFile
+        uint64_t slow_events = 0;
+        // MC events whose gen truth was skipped because they cannot produce an `ll` (see fillTruthForAllEvents)
+        uint64_t truth_skipped_events = 0;
+
+        EventStatistics& operator+=(const EventStatistics& other);
+
+        // One line per quantity with mean, p50, p99 and max
+        void report(std::ostream& out) const;
+    };
+
+    // Records the time between its construction and its destruction as the time of one event
+    class EventTimer {
+        public:
+            EventTimer(EventStatistics& statistics):
+                m_statistics(statistics), m_start(std::chrono::steady_clock::now()) {
+                // Empty
+            }
+
+            ~EventTimer() {
+                auto elapsed = std::chrono::steady_clock::now() - m_start;
+                m_statistics.last_time = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+                m_statistics.time.add(m_statistics.last_time);
+            }
+
+            EventTimer(const EventTimer&) = delete;
+            EventTimer& operator=(const EventTimer&) = delete;
+
+        private:
+            EventStatistics& m_statistics;
+            std::chrono::steady_clock::time_point m_start;
+    };
+
+    // Decides if an event is slow enough to be written to slowEventsFile: slower than `threshold_ns` (if not 0),
+    // or than the `quantile` (if not 0) of the event times seen so far. The quantile is only
+    // used after WARMUP_EVENTS events, and recomputed every REFRESH_EVENTS events
+    class SlowEventSelector {
+        public:
+            static const uint64_t WARMUP_EVENTS = 1000;
+            static const uint64_t REFRESH_EVENTS = 1000;
+
+            SlowEventSelector(uint64_t threshold_ns, double quantile):
+                m_threshold(threshold_ns), m_quantile(quantile) {
+                // Empty
+            }
+
+            bool isSlow(const EventStatistics& statistics);
+
+        private:
+            uint64_t m_threshold;
+            double m_quantile;
+            uint64_t m_quantile_threshold = 0;
+            uint64_t m_events_since_refresh = 0;
+    };
+}
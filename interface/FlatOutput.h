@@ -0,0 +1,204 @@
+#pragma once
+
+#include <cp3_llbb/TreeWrapper/interface/TreeWrapper.h>
+#include <cp3_llbb/HHAnalysis/interface/Types.h>
+
+#include <cmath>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace edm {
+    class ParameterSet;
+}
+
+namespace HH {
+
+    // Storage type of a flat column. Small integers are widened so that only the
+    // vectors of primitive types ROOT knows natively are needed (no dictionary)
+    template <typename T> struct FlatColumnType { typedef T type; };
+    template <> struct FlatColumnType<int8_t> { typedef int type; };
+
+    // Glob-like match, where '*' matches any (possibly empty) sequence of characters
+    bool wildcardMatch(const std::string& pattern, const std::string& name);
+
+    // Round `value` to `bits` bits of mantissa (out of 23). The low bits are zeroed and compress away
+    float reduceMantissa(float value, unsigned int bits);
+
+    // Per-branch output policy for the flat output, configured with the `outputPolicy` PSet
+    struct OutputPolicy {
+        // Patterns (with '*' wildcards) matched against the full column name, e.g. 'llmetjj_gen_*'
+        std::vector<std::string> drop;
+        // Do not write llmetjj four-vectors which are copies, or sums, of the leptons / jets / met ones (reachable with ilep1, ijet1, imet, ...)
+        bool deduplicate = false;
+        // Float columns stored with only `mantissaBits` bits of mantissa
+        std::vector<std::string> reducedPrecision;
+        unsigned int mantissaBits = 23;
+        // Store phi columns as 16 bits fixed-point integers (phi * 32767 / pi) in `<column>_fp16` branches
+        bool fixedPointAngles = false;
+
+        OutputPolicy() = default;
+        OutputPolicy(const edm::ParameterSet& config);
+
+        bool isDefault() const;
+        bool isDropped(const std::string& column) const;
+        bool isReducedPrecision(const std::string& column) const;
+    };
+
+    // Uncompressed bytes per column, with and without the output policy applied
+    struct ColumnStats {
+        std::string name;
+        uint64_t values = 0;
+        uint64_t bytes_before = 0;
+        // Reduced-mantissa floats are still written as 32 bits floats
+        uint64_t bytes_after = 0;
+        // Estimate, not a measurement: bytes_after with the reduced-mantissa floats counted at their significant bits
+        // (sign, exponent and kept mantissa), the best the compression can do with them. The compressed bytes actually
+        // written per branch are reported by `hhReplay --memory`
+        uint64_t estimated_bytes = 0;
+        bool dropped = false;
+    };
+
+    // Writes a collection of HH structs as one primitive-typed branch per member,
+    // named <collection>_<member> (for example `jets_pt` or `llmetjj_MT2`)
+    template <typename T>
+    class FlatCollection {
+        public:
+            FlatCollection(ROOT::TreeGroup& tree, const std::string& name, const OutputPolicy& policy):
+                m_tree(tree), m_name(name), m_policy(policy) {
+                // Empty
+            }
+
+            // Plain member. Members of a base class are accepted, the most derived one is used when shadowed
+            template <typename V, typename C>
+            FlatCollection& column(const std::string& member, V C::* field) {
+                static_assert(std::is_base_of<C, T>::value, "Member does not belong to the collection type");
+                typedef typename FlatColumnType<V>::type S;
+                return column<S>(member, [field](const T& object) -> S { return object.*field; });
+            }
+
+            // Computed column, for nested members
+            template <typename S>
+            FlatCollection& column(const std::string& member, std::function<S(const T&)> getter) {
+                m_stats.emplace_back();
+                ColumnStats& stats = m_stats.back();
+                stats.name = m_name + "_" + member;
+
+                if (m_policy.isDropped(stats.name)) {
+                    stats.dropped = true;
+                    m_fillers.push_back([&stats](const std::vector<T>& objects) {
+                        stats.values += objects.size();
+                        stats.bytes_before += objects.size() * sizeof(S);
+                    });
+                } else {
+                    book(stats, getter);
+                }
+
+                return *this;
+            }
+
+            // Four-vectors are split into pt, eta, phi and energy columns, prefixed by `prefix` if not empty
+            template <typename C>
+            FlatCollection& p4(const std::string& prefix, LorentzVector C::* field) {
+                std::string p = prefix.empty() ? "" : prefix + "_";
+                column<float>(p + "pt", [field](const T& o) { return (o.*field).Pt(); });
+                column<float>(p + "eta", [field](const T& o) { return (o.*field).Eta(); });
+                column<float>(p + "phi", [field](const T& o) { return (o.*field).Phi(); });
+                column<float>(p + "e", [field](const T& o) { return (o.*field).E(); });
+                return *this;
+            }
+
+            void fill(const std::vector<T>& objects) const {
+                for (const auto& filler: m_fillers)
+                    filler(objects);
+            }
+
+            const std::deque<ColumnStats>& stats() const {
+                return m_stats;
+            }
+
+        private:
+            template <typename S>
+            void book(ColumnStats& stats, std::function<S(const T&)> getter) {
+                std::vector<S>& branch = m_tree[stats.name].write<std::vector<S>>();
+                m_fillers.push_back([&branch, &stats, getter](const std::vector<T>& objects) {
+                    for (const T& object: objects)
+                        branch.push_back(getter(object));
+                    stats.values += objects.size();
+                    stats.bytes_before += objects.size() * sizeof(S);
+                    stats.bytes_after += objects.size() * sizeof(S);
+                    stats.estimated_bytes += objects.size() * sizeof(S);
+                });
+            }
+
+            void book(ColumnStats& stats, std::function<float(const T&)> getter) {
+                bool is_angle = stats.name.size() > 4 && stats.name.compare(stats.name.size() - 4, 4, "_phi") == 0;
+
+                if (m_policy.fixedPointAngles && is_angle) {
+                    stats.name += "_fp16";
+                    std::vector<int16_t>& branch = m_tree[stats.name].write<std::vector<int16_t>>();
+                    m_fillers.push_back([&branch, &stats, getter](const std::vector<T>& objects) {
+                        for (const T& object: objects)
+                            branch.push_back(std::lround(getter(object) * 32767 / M_PI));
+                        stats.values += objects.size();
+                        stats.bytes_before += objects.size() * sizeof(float);
+                        stats.bytes_after += objects.size() * sizeof(int16_t);
+                        stats.estimated_bytes += objects.size() * sizeof(int16_t);
+                    });
+                } else if (m_policy.isReducedPrecision(stats.name)) {
+                    unsigned int bits = m_policy.mantissaBits;
+                    std::vector<float>& branch = m_tree[stats.name].write<std::vector<float>>();
+                    m_fillers.push_back([&branch, &stats, getter, bits](const std::vector<T>& objects) {
+                        for (const T& object: objects)
+                            branch.push_back(reduceMantissa(getter(object), bits));
+                        stats.values += objects.size();
+                        stats.bytes_before += objects.size() * sizeof(float);
+                        stats.bytes_after += objects.size() * sizeof(float);
+                        stats.estimated_bytes += (objects.size() * (9 + bits) + 7) / 8;
+                    });
+                } else {
+                    book<float>(stats, getter);
+                }
+            }
+
+            ROOT::TreeGroup& m_tree;
+            std::string m_name;
+            const OutputPolicy& m_policy;
+            std::vector<std::function<void(const std::vector<T>&)>> m_fillers;
+            // Deque: fillers keep references to their entry
+            mutable std::deque<ColumnStats> m_stats;
+    };
+
+    // Flat version of the `leptons`, `jets`, `met` and `llmetjj` branches. Columns are booked in src/FlatOutput.cc
+    class FlatOutput {
+        public:
+            FlatOutput(ROOT::TreeGroup& tree, const OutputPolicy& policy);
+
+            void fill(const std::vector<Lepton>& leptons, const std::vector<Jet>& jets, const std::vector<Met>& met, const std::vector<DileptonMetDijet>& llmetjj) const;
+
+            // Table of uncompressed bytes per branch, before and after the output policy, and estimate of the
+            // reduced-precision columns (see ColumnStats)
+            void report(std::ostream& out) const;
+            uint64_t bytesBefore() const;
+            uint64_t bytesAfter() const;
+            uint64_t estimatedBytes() const;
+
+        private:
+            template <typename F> void forEachColumn(F f) const {
+                for (const auto& stats: m_leptons.stats()) f(stats);
+                for (const auto& stats: m_jets.stats()) f(stats);
+                for (const auto& stats: m_met.stats()) f(stats);
+                for (const auto& stats: m_llmetjj.stats()) f(stats);
+            }
+
+            OutputPolicy m_policy;
+            FlatCollection<Lepton> m_leptons;
+            FlatCollection<Jet> m_jets;
+            FlatCollection<Met> m_met;
+            FlatCollection<DileptonMetDijet> m_llmetjj;
+    };
+}
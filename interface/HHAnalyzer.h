@@ -7,76 +7,99 @@
 #include <cp3_llbb/Framework/interface/WeightedBinnedValues.h>
 
 #include <cp3_llbb/HHAnalysis/interface/Types.h>
+#include <cp3_llbb/HHAnalysis/interface/Allocations.h>
+#include <cp3_llbb/HHAnalysis/interface/Configuration.h>
+#include <cp3_llbb/HHAnalysis/interface/CutFlow.h>
+#include <cp3_llbb/HHAnalysis/interface/CutScan.h>
+#include <cp3_llbb/HHAnalysis/interface/Dijets.h>
+#include <cp3_llbb/HHAnalysis/interface/Dileptons.h>
+#include <cp3_llbb/HHAnalysis/interface/EventRecords.h>
+#include <cp3_llbb/HHAnalysis/interface/EventStatistics.h>
+#include <cp3_llbb/HHAnalysis/interface/FlatOutput.h>
+#include <cp3_llbb/HHAnalysis/interface/Histograms.h>
+#include <cp3_llbb/HHAnalysis/interface/Inputs.h>
+#include <cp3_llbb/HHAnalysis/interface/Random.h>
+#include <cp3_llbb/HHAnalysis/interface/Selection.h>
+#include <cp3_llbb/HHAnalysis/interface/Skim.h>
+#include <cp3_llbb/HHAnalysis/interface/StageTimers.h>
+#include <cp3_llbb/HHAnalysis/interface/TruthScans.h>
 #include <cp3_llbb/HHAnalysis/interface/lester_mt2_bisect.h>
 #include <cp3_llbb/Framework/interface/HLTProducer.h>
 
 #include <Math/VectorUtil.h>
 
-#include <random>
+#include <FWCore/Utilities/interface/EDMException.h>
+
+#include <array>
+#include <memory>
+#include <utility>
 
 using namespace HH;
 using namespace HHAnalysis;
 
+// Branch only written to the tree when COND holds, transient storage otherwise. With outputMode = 'none',
+// every branch is transient: all the branches below use it instead of the Framework BRANCH and
+// ONLY_NOMINAL_BRANCH, with COND = true and !doingSystematics() respectively
+#define CONDITIONAL_BRANCH(COND, NAME, ...) __VA_ARGS__& NAME = ((m_config->output_mode != HH::OutputMode::None && (COND)) ? tree[#NAME].write<__VA_ARGS__>() : tree[#NAME].transient_write<__VA_ARGS__>())
+
+// Not reentrant: the products of an event (leptons, ll, met, llmet, jj, llmetjj, ...) are the branches of the
+// module's tree, and the counters and buffers below are plain members, so analyze() must not be called
+// concurrently on the same instance. The Framework runs the analyzers of a job on a single stream
 class HHAnalyzer: public Framework::Analyzer {
+    private:
+        // Declared first since it decides how some branches below are booked
+        std::shared_ptr<const HH::AnalyzerConfiguration> m_config;
+
     public:
         HHAnalyzer(const std::string& name, const ROOT::TreeGroup& tree_, const edm::ParameterSet& config):
-            Analyzer(name, tree_, config), random_generator(42), br_generator(0, 1)
+            Analyzer(name, tree_, config),
+            m_config(HH::AnalyzerConfiguration::get(config))
         {
-            // Not untracked as these parameters are mandatory
-            m_electrons_producer = config.getParameter<std::string>("electronsProducer");
-            m_muons_producer = config.getParameter<std::string>("muonsProducer");
-            m_jets_producer = config.getParameter<std::string>("jetsProducer");
-            m_met_producer = config.getParameter<std::string>("metProducer");
-            m_nohf_met_producer = config.getParameter<std::string>("nohfMETProducer");
-            // other parameters
-            m_muonLooseIsoCut = config.getUntrackedParameter<double>("muonLooseIsoCut");
-            m_muonTightIsoCut = config.getUntrackedParameter<double>("muonTightIsoCut");
-            m_muonEtaCut = config.getUntrackedParameter<double>("muonEtaCut", 2.4);
-            m_leadingMuonPtCut = config.getUntrackedParameter<double>("leadingMuonPtCut", 20);
-            m_subleadingMuonPtCut = config.getUntrackedParameter<double>("subleadingMuonPtCut", 10);
-
-            m_electronEtaCut = config.getUntrackedParameter<double>("electronEtaCut", 2.5);
-            m_leadingElectronPtCut = config.getUntrackedParameter<double>("leadingElectronPtCut", 20);
-            m_subleadingElectronPtCut = config.getUntrackedParameter<double>("subleadingElectronPtCut", 15);
-            m_electron_loose_wp_name = config.getUntrackedParameter<std::string>("electrons_loose_wp_name");
-            m_electron_medium_wp_name = config.getUntrackedParameter<std::string>("electrons_medium_wp_name");
-            m_electron_tight_wp_name = config.getUntrackedParameter<std::string>("electrons_tight_wp_name");
-            m_electron_hlt_safe_wp_name = config.getUntrackedParameter<std::string>("electrons_hlt_safe_wp_name");
-
-            m_jetEtaCut = config.getUntrackedParameter<double>("jetEtaCut", 2.4);
-            m_jetPtCut = config.getUntrackedParameter<double>("jetPtCut", 20);
-            m_jet_bDiscrName = config.getUntrackedParameter<std::string>("discr_name", "pfCombinedInclusiveSecondaryVertexV2BJetTags");
-            m_jet_bDiscrCut_loose = config.getUntrackedParameter<double>("discr_cut_loose");
-            m_jet_bDiscrCut_medium = config.getUntrackedParameter<double>("discr_cut_medium");
-            m_jet_bDiscrCut_tight = config.getUntrackedParameter<double>("discr_cut_tight");
-            m_minDR_l_j_Cut = config.getUntrackedParameter<double>("minDR_l_j_Cut", 0.3);
-            m_applyBJetRegression = config.getUntrackedParameter<bool>("applyBJetRegression", false);
-
-            m_hltDRCut = config.getUntrackedParameter<double>("hltDRCut", std::numeric_limits<float>::max());
-            m_hltDPtCut = config.getUntrackedParameter<double>("hltDPtCut", std::numeric_limits<float>::max());
-
-            const edm::ParameterSet& hlt_efficiencies = config.getUntrackedParameter<edm::ParameterSet>("hlt_efficiencies");
-            std::vector<std::string> hlt_efficiencies_name = hlt_efficiencies.getParameterNames();
-            for (const std::string& hlt_efficiency: hlt_efficiencies_name) {
-                std::cout << "    Registering new HLT efficiency: " << hlt_efficiency;
-                if (hlt_efficiencies.existsAs<edm::FileInPath>(hlt_efficiency, false)) {
-                    BinnedValuesJSONParser parser(hlt_efficiencies.getUntrackedParameter<edm::FileInPath>(hlt_efficiency).fullPath());
-                    m_hlt_efficiencies.emplace(hlt_efficiency, std::unique_ptr<BinnedValues>(new BinnedValues(std::move(parser.get_values()))));
-                    std::cout << " -> non-weighted. " << std::endl;
-                } else {
-                    const auto& parts = hlt_efficiencies.getUntrackedParameter<std::vector<edm::ParameterSet>>(hlt_efficiency);
-                    m_hlt_efficiencies.emplace(hlt_efficiency, std::unique_ptr<BinnedValues>(new WeightedBinnedValues(parts)));
-                    std::cout << " -> weighted. " << std::endl;
+            if (m_config->output_mode == HH::OutputMode::Flat)
+                m_flat_writer.reset(new HH::FlatOutput(tree, m_config->output_policy));
+
+            if (!m_config->capture_inputs.empty())
+                m_inputs_writer.reset(new HH::InputsWriter(m_config->capture_inputs, name, config.toString()));
+
+            if (!m_config->slow_events_file.empty())
+                m_slow_events_writer.reset(new HH::InputsWriter(m_config->slow_events_file, name, config.toString()));
+
+            if (!m_config->trace_file.empty()) {
+                std::shared_ptr<HH::TraceRecorder> recorder = HH::TraceRecorder::get(m_config->trace_file, m_config->trace_buffer_size);
+                std::vector<std::string> tracks = {"event"};
+                tracks.insert(tracks.end(), HH::Stage::names.begin(), HH::Stage::names.end());
+                uint32_t first_tid = recorder->addAnalyzer(name, tracks) * tracks.size();
+                m_trace_track.reset(new HH::TraceTrack{recorder, first_tid});
+            }
+
+            HH::SampleType sample_type = m_config->sample_type;
+            uint64_t detection_events = sample_type == HH::SampleType::Auto ? m_config->sample_detection_events : 0;
+            m_hh_truth_scan.reset(new HH::TruthScanSwitch(name + ": HH truth scan",
+                        sample_type != HH::SampleType::TTbar && sample_type != HH::SampleType::Background, detection_events));
+            m_ttbar_truth_scan.reset(new HH::TruthScanSwitch(name + ": ttbar truth scan",
+                        sample_type != HH::SampleType::Signal && sample_type != HH::SampleType::Background, detection_events));
+
+            if (m_config->skim.enabled()) {
+                m_skim_writer = HH::SkimWriter::get(m_config->skim);
+                for (size_t category = 0; category < m_skim_streams.size(); category++) {
+                    if (m_config->skim.enabled_categories[category])
+                        m_skim_streams[category] = m_skim_writer->addStream(name + "_" + HH::SkimConfiguration::categories[category], m_config->output_policy);
                 }
             }
 
+            if (!m_config->records_file.empty()) {
+                m_records_writer = HH::EventRecordWriter::get(m_config->records_file);
+                m_records_analyzer = m_records_writer->addAnalyzer(name);
+            }
+
             asymm_mt2_lester_bisect::disableCopyrightMessage();
         }
         virtual void endJob(MetadataManager&) override;
 
-        BRANCH(leptons, std::vector<HH::Lepton>);
-        BRANCH(met, std::vector<HH::Met>);
-        BRANCH(jets, std::vector<HH::Jet>);
+        // Struct branches. In flat and none output modes they are still filled (categories rely on them) but not written
+        CONDITIONAL_BRANCH(m_config->output_mode == HH::OutputMode::Struct, leptons, std::vector<HH::Lepton>);
+        CONDITIONAL_BRANCH(m_config->output_mode == HH::OutputMode::Struct, met, std::vector<HH::Met>);
+        CONDITIONAL_BRANCH(m_config->output_mode == HH::OutputMode::Struct, jets, std::vector<HH::Jet>);
         std::vector<HH::Dilepton> ll;
         std::vector<HH::DileptonMet> llmet;
         std::vector<HH::Dijet> jj;
@@ -93,52 +116,63 @@ class HHAnalyzer: public Framework::Analyzer {
         //BRANCH(llmetjj_HWWleptons_btagLM_cmva, std::vector<HH::DileptonMetDijet>);
         //BRANCH(llmetjj_HWWleptons_btagMT_cmva, std::vector<HH::DileptonMetDijet>);
 
-        BRANCH(llmetjj, std::vector<HH::DileptonMetDijet>);
+        CONDITIONAL_BRANCH(m_config->output_mode == HH::OutputMode::Struct, llmetjj, std::vector<HH::DileptonMetDijet>);
+        // Ordering that picked the pair of each llmetjj candidate, as a HH::DijetRanking value (0: ht, 1: mh, 2: pt, 3: csv,
+        // 4: cmva, 5: ptOverM). Only written when dijetRankings asks for more than cmva
+        CONDITIONAL_BRANCH(m_config->dijet_rankings.size() > 1, llmetjj_ranking, std::vector<int>);
 
         virtual void analyze(const edm::Event&, const edm::EventSetup&, const ProducersManager&, const AnalyzersManager&, const CategoryManager&) override;
+        // The analysis itself, from inputs gathered from the producers or replayed from a file
+        void analyze(const HH::EventInputs& inputs);
+        // Time spent in each stage so far (empty unless stageTimers or memoryReport is set)
+        HH::StageTimings stageTimings() const;
+        // Allocations per event and peak capacities so far (empty unless memoryReport is set)
+        HH::MemoryStats memoryStats() const;
         virtual void registerCategories(CategoryManager& manager, const edm::ParameterSet& config) override;
-
-        // Various helper functions, implemented in plugins/Tools.cc
-        float getCosThetaStar_CS(const LorentzVector & h1, const LorentzVector & h2, float ebeam = 6500);
-        MELAAngles getMELAAngles(const LorentzVector &q1, const LorentzVector &q2, const LorentzVector &q11, const LorentzVector &q12, const LorentzVector &q21, const LorentzVector &q22, float ebeam = 6500);
-        void matchOfflineLepton(const HLTProducer& hlt, Dilepton& dilepton);
-        void fillTriggerEfficiencies(const Lepton & lep1, const Lepton & lep2, Dilepton & dilep);
+        // Dilepton flavour of the current event (0: elel, 1: elmu, 2: muel, 3: mumu) if it passes the selection of
+        // event_in_category_post_analyzers (src/Categories.cc), NO_CATEGORY otherwise. Used by the histograms and the skim
+        size_t selectedCategory() const;
+
+        // Various helper functions, implemented in src/Tools.cc. Except matchOfflineLepton, which fills the HLT fields of `leptons`, they only read the configuration
+        float getCosThetaStar_CS(const LorentzVector & h1, const LorentzVector & h2, float ebeam = 6500) const;
+        MELAAngles getMELAAngles(const LorentzVector &q1, const LorentzVector &q2, const LorentzVector &q11, const LorentzVector &q12, const LorentzVector &q21, const LorentzVector &q22, float ebeam = 6500) const;
+        void matchOfflineLepton(const HH::EventInputs::HLT& hlt, Dilepton& dilepton);
+        void fillTriggerEfficiencies(const Lepton & lep1, const Lepton & lep2, Dilepton & dilep) const;
+        // Keep the (at most genDeltaRTopK) gen-matched reco objects closest to `target`, sorted by increasing ΔR
+        void fillGenMatches(const std::vector<LorentzVector>& reco_gen_p4, const std::vector<bool>& reco_matched, const LorentzVector& target, std::vector<int>& indices, std::vector<float>& deltaRs) const;
+        // Cheap preselection on the electrons and muons passing the object selection: false if the event cannot produce any `ll` candidate
+        bool canBuildDilepton(const HH::ObjectSelection& selection) const;
         
         // Stuff for L1 EMTF muon mitigation
-        float getL1TPhi(int charge, const LorentzVector& p);
-        bool sameEndCap(const LorentzVector& p1, const LorentzVector& p2);
+        float getL1TPhi(int charge, const LorentzVector& p) const;
+        bool sameEndCap(const LorentzVector& p1, const LorentzVector& p2) const;
         // Translate phi by 'translation', and put it into [0, 2pi[
-        float translatePhi(float phi, float translation=0);
+        float translatePhi(float phi, float translation=0) const;
         // Get N s.t. start + 60° * N <= phi < end + 60° + N; return -1 if no such N
-        int getPhiSector(float phi, float start, float end);
+        int getPhiSector(float phi, float start, float end) const;
         // See https://twiki.cern.ch/twiki/bin/view/CMS/EndcapHighPtMuonEfficiencyProblem:
         // Case 2) -- using gen info (to apply weights on MC)
-        bool isCSCSameSector(const Lepton& lep1, const Lepton& lep2);
+        bool isCSCSameSector(const Lepton& lep1, const Lepton& lep2) const;
         // Case 3) -- using reco info (to reject data and MC)
-        bool isCSCWithOverlap(const Lepton& lep1, const Lepton& lep2);
+        bool isCSCWithOverlap(const Lepton& lep1, const Lepton& lep2) const;
 
         // global event stuff (selected objects multiplicity)
-        BRANCH(HT, float);
-        BRANCH(nJetsL, unsigned int);
-        ONLY_NOMINAL_BRANCH(nBJetsM, unsigned int);
-        ONLY_NOMINAL_BRANCH(nMuonsT, unsigned int);
-        ONLY_NOMINAL_BRANCH(nElectronsM, unsigned int);
-
-        float count_has2leptons = 0.;
-        float count_has2leptons_elel = 0.;
-        float count_has2leptons_elmu = 0.;
-        float count_has2leptons_muel = 0.;
-        float count_has2leptons_mumu = 0.;
-        float count_has2leptons_1llmetjj = 0.;
-        float count_has2leptons_elel_1llmetjj = 0.;
-        float count_has2leptons_elmu_1llmetjj = 0.;
-        float count_has2leptons_muel_1llmetjj = 0.;
-        float count_has2leptons_mumu_1llmetjj = 0.;
-        float count_has2leptons_1llmetjj_2btagM = 0.;
-        float count_has2leptons_elel_1llmetjj_2btagM = 0.;
-        float count_has2leptons_elmu_1llmetjj_2btagM = 0.;
-        float count_has2leptons_muel_1llmetjj_2btagM = 0.;
-        float count_has2leptons_mumu_1llmetjj_2btagM = 0.;
+        CONDITIONAL_BRANCH(true, HT, float);
+        CONDITIONAL_BRANCH(true, nJetsL, unsigned int);
+        CONDITIONAL_BRANCH(!doingSystematics(), nBJetsM, unsigned int);
+        CONDITIONAL_BRANCH(!doingSystematics(), nMuonsT, unsigned int);
+        CONDITIONAL_BRANCH(!doingSystematics(), nElectronsM, unsigned int);
+        // True when more than maxJetsForPairing jets were selected and only the leading ones were paired
+        CONDITIONAL_BRANCH(m_config->max_jets_for_pairing > 0, jets_pairing_capped, bool);
+
+        // Counters, written to the metadata in endJob
+        HH::CutFlow m_cutflow;
+        // Time spent in each stage of analyze(), when stageTimers or memoryReport is set
+        HH::StageTimings m_stage_timings;
+        // Heap usage, when memoryReport is set
+        HH::MemoryStats m_memory_stats;
+        // Multiplicities and time per event
+        HH::EventStatistics m_event_statistics;
 
         // ttbar system mc truth
         // Gen matching. All indexes are from the `pruned` collection
@@ -172,91 +206,138 @@ class HHAnalyzer: public Framework::Analyzer {
         uint16_t gen_neutrino_tbar; // Index of the neutrino from the anti-top decay chain
         uint16_t gen_neutrino_tbar_beforeFSR; // Index of the neutrino from the anti-top decay chain, before any FSR
 
-        ONLY_NOMINAL_BRANCH(gen_ttbar_decay_type, char); // Type of ttbar decay. Can take any values from TTDecayType enum
+        CONDITIONAL_BRANCH(!doingSystematics(), gen_ttbar_decay_type, char); // Type of ttbar decay. Can take any values from TTDecayType enum
 
         // Di-higgs gen system
-        ONLY_NOMINAL_BRANCH(gen_iX, char);
-        ONLY_NOMINAL_BRANCH(gen_X, LorentzVector);
-
-        ONLY_NOMINAL_BRANCH(gen_iH1, char);
-        ONLY_NOMINAL_BRANCH(gen_iH2, char);
-        ONLY_NOMINAL_BRANCH(gen_H1, LorentzVector);
-        ONLY_NOMINAL_BRANCH(gen_H2, LorentzVector);
-        ONLY_NOMINAL_BRANCH(gen_mHH, double);
-        ONLY_NOMINAL_BRANCH(gen_costhetastar, double);
-        ONLY_NOMINAL_BRANCH(gen_iH1_afterFSR, char);
-        ONLY_NOMINAL_BRANCH(gen_iH2_afterFSR, char);
-        ONLY_NOMINAL_BRANCH(gen_H1_afterFSR, LorentzVector);
-        ONLY_NOMINAL_BRANCH(gen_H2_afterFSR, LorentzVector);
-
-        ONLY_NOMINAL_BRANCH(gen_iB, char);
-        ONLY_NOMINAL_BRANCH(gen_iBbar, char);
-        ONLY_NOMINAL_BRANCH(gen_iB_afterFSR, char);
-        ONLY_NOMINAL_BRANCH(gen_iBbar_afterFSR, char);
-        ONLY_NOMINAL_BRANCH(gen_B, LorentzVector);
-        ONLY_NOMINAL_BRANCH(gen_Bbar, LorentzVector);
-        ONLY_NOMINAL_BRANCH(gen_B_afterFSR, LorentzVector);
-        ONLY_NOMINAL_BRANCH(gen_Bbar_afterFSR, LorentzVector);
-
-        ONLY_NOMINAL_BRANCH(gen_iV2, char);
-        ONLY_NOMINAL_BRANCH(gen_iV1, char);
-        ONLY_NOMINAL_BRANCH(gen_iV2_afterFSR, char);
-        ONLY_NOMINAL_BRANCH(gen_iV1_afterFSR, char);
-        ONLY_NOMINAL_BRANCH(gen_V2, LorentzVector);
-        ONLY_NOMINAL_BRANCH(gen_V1, LorentzVector);
-        ONLY_NOMINAL_BRANCH(gen_V2_afterFSR, LorentzVector);
-        ONLY_NOMINAL_BRANCH(gen_V1_afterFSR, LorentzVector);
-
-        ONLY_NOMINAL_BRANCH(gen_iLminus, char);
-        ONLY_NOMINAL_BRANCH(gen_iLplus, char);
-        ONLY_NOMINAL_BRANCH(gen_iLminus_afterFSR, char);
-        ONLY_NOMINAL_BRANCH(gen_iLplus_afterFSR, char);
-        ONLY_NOMINAL_BRANCH(gen_Lminus, LorentzVector);
-        ONLY_NOMINAL_BRANCH(gen_Lplus, LorentzVector);
-        ONLY_NOMINAL_BRANCH(gen_Lminus_afterFSR, LorentzVector);
-        ONLY_NOMINAL_BRANCH(gen_Lplus_afterFSR, LorentzVector);
-
-        ONLY_NOMINAL_BRANCH(gen_iNu1, char);
-        ONLY_NOMINAL_BRANCH(gen_iNu2, char);
-        ONLY_NOMINAL_BRANCH(gen_Nu1, LorentzVector);
-        ONLY_NOMINAL_BRANCH(gen_Nu2, LorentzVector);
-
-        ONLY_NOMINAL_BRANCH(gen_deltaR_jet_B, std::vector<float>);
-        ONLY_NOMINAL_BRANCH(gen_deltaR_jet_Bbar, std::vector<float>);
-        ONLY_NOMINAL_BRANCH(gen_deltaR_jet_B_afterFSR, std::vector<float>);
-        ONLY_NOMINAL_BRANCH(gen_deltaR_jet_Bbar_afterFSR, std::vector<float>);
-        ONLY_NOMINAL_BRANCH(gen_deltaR_electron_L1, std::vector<float>);
-        ONLY_NOMINAL_BRANCH(gen_deltaR_electron_L2, std::vector<float>);
-        ONLY_NOMINAL_BRANCH(gen_deltaR_electron_L1_afterFSR, std::vector<float>);
-        ONLY_NOMINAL_BRANCH(gen_deltaR_electron_L2_afterFSR, std::vector<float>);
-        ONLY_NOMINAL_BRANCH(gen_deltaR_muon_L1, std::vector<float>);
-        ONLY_NOMINAL_BRANCH(gen_deltaR_muon_L2, std::vector<float>);
-        ONLY_NOMINAL_BRANCH(gen_deltaR_muon_L1_afterFSR, std::vector<float>);
-        ONLY_NOMINAL_BRANCH(gen_deltaR_muon_L2_afterFSR, std::vector<float>);
+        // BR(tau -> e / mu)^n_taus correction of the signal samples, when tauBRCorrection = 'weight' (1 otherwise)
+        CONDITIONAL_BRANCH(m_config->tau_br_weight && !doingSystematics(), gen_tau_br_weight, float);
+        CONDITIONAL_BRANCH(!doingSystematics(), gen_iX, char);
+        CONDITIONAL_BRANCH(!doingSystematics(), gen_X, LorentzVector);
+
+        CONDITIONAL_BRANCH(!doingSystematics(), gen_iH1, char);
+        CONDITIONAL_BRANCH(!doingSystematics(), gen_iH2, char);
+        CONDITIONAL_BRANCH(!doingSystematics(), gen_H1, LorentzVector);
+        CONDITIONAL_BRANCH(!doingSystematics(), gen_H2, LorentzVector);
+        CONDITIONAL_BRANCH(!doingSystematics(), gen_mHH, double);
+        CONDITIONAL_BRANCH(!doingSystematics(), gen_costhetastar, double);
+        CONDITIONAL_BRANCH(!doingSystematics(), gen_iH1_afterFSR, char);
+        CONDITIONAL_BRANCH(!doingSystematics(), gen_iH2_afterFSR, char);
+        CONDITIONAL_BRANCH(!doingSystematics(), gen_H1_afterFSR, LorentzVector);
+        CONDITIONAL_BRANCH(!doingSystematics(), gen_H2_afterFSR, LorentzVector);
+
+        CONDITIONAL_BRANCH(!doingSystematics(), gen_iB, char);
+        CONDITIONAL_BRANCH(!doingSystematics(), gen_iBbar, char);
+        CONDITIONAL_BRANCH(!doingSystematics(), gen_iB_afterFSR, char);
+        CONDITIONAL_BRANCH(!doingSystematics(), gen_iBbar_afterFSR, char);
+        CONDITIONAL_BRANCH(!doingSystematics(), gen_B, LorentzVector);
+        CONDITIONAL_BRANCH(!doingSystematics(), gen_Bbar, LorentzVector);
+        CONDITIONAL_BRANCH(!doingSystematics(), gen_B_afterFSR, LorentzVector);
+        CONDITIONAL_BRANCH(!doingSystematics(), gen_Bbar_afterFSR, LorentzVector);
+
+        CONDITIONAL_BRANCH(!doingSystematics(), gen_iV2, char);
+        CONDITIONAL_BRANCH(!doingSystematics(), gen_iV1, char);
+        CONDITIONAL_BRANCH(!doingSystematics(), gen_iV2_afterFSR, char);
+        CONDITIONAL_BRANCH(!doingSystematics(), gen_iV1_afterFSR, char);
+        CONDITIONAL_BRANCH(!doingSystematics(), gen_V2, LorentzVector);
+        CONDITIONAL_BRANCH(!doingSystematics(), gen_V1, LorentzVector);
+        CONDITIONAL_BRANCH(!doingSystematics(), gen_V2_afterFSR, LorentzVector);
+        CONDITIONAL_BRANCH(!doingSystematics(), gen_V1_afterFSR, LorentzVector);
+
+        CONDITIONAL_BRANCH(!doingSystematics(), gen_iLminus, char);
+        CONDITIONAL_BRANCH(!doingSystematics(), gen_iLplus, char);
+        CONDITIONAL_BRANCH(!doingSystematics(), gen_iLminus_afterFSR, char);
+        CONDITIONAL_BRANCH(!doingSystematics(), gen_iLplus_afterFSR, char);
+        CONDITIONAL_BRANCH(!doingSystematics(), gen_Lminus, LorentzVector);
+        CONDITIONAL_BRANCH(!doingSystematics(), gen_Lplus, LorentzVector);
+        CONDITIONAL_BRANCH(!doingSystematics(), gen_Lminus_afterFSR, LorentzVector);
+        CONDITIONAL_BRANCH(!doingSystematics(), gen_Lplus_afterFSR, LorentzVector);
+
+        CONDITIONAL_BRANCH(!doingSystematics(), gen_iNu1, char);
+        CONDITIONAL_BRANCH(!doingSystematics(), gen_iNu2, char);
+        CONDITIONAL_BRANCH(!doingSystematics(), gen_Nu1, LorentzVector);
+        CONDITIONAL_BRANCH(!doingSystematics(), gen_Nu2, LorentzVector);
+
+        // Dense gen-reco matching: one entry per reco object, even if the gen target was not found
+        CONDITIONAL_BRANCH(!m_config->sparse_gen_deltaR && !doingSystematics(), gen_deltaR_jet_B, std::vector<float>);
+        CONDITIONAL_BRANCH(!m_config->sparse_gen_deltaR && !doingSystematics(), gen_deltaR_jet_Bbar, std::vector<float>);
+        CONDITIONAL_BRANCH(!m_config->sparse_gen_deltaR && !doingSystematics(), gen_deltaR_jet_B_afterFSR, std::vector<float>);
+        CONDITIONAL_BRANCH(!m_config->sparse_gen_deltaR && !doingSystematics(), gen_deltaR_jet_Bbar_afterFSR, std::vector<float>);
+        CONDITIONAL_BRANCH(!m_config->sparse_gen_deltaR && !doingSystematics(), gen_deltaR_electron_L1, std::vector<float>);
+        CONDITIONAL_BRANCH(!m_config->sparse_gen_deltaR && !doingSystematics(), gen_deltaR_electron_L2, std::vector<float>);
+        CONDITIONAL_BRANCH(!m_config->sparse_gen_deltaR && !doingSystematics(), gen_deltaR_electron_L1_afterFSR, std::vector<float>);
+        CONDITIONAL_BRANCH(!m_config->sparse_gen_deltaR && !doingSystematics(), gen_deltaR_electron_L2_afterFSR, std::vector<float>);
+        CONDITIONAL_BRANCH(!m_config->sparse_gen_deltaR && !doingSystematics(), gen_deltaR_muon_L1, std::vector<float>);
+        CONDITIONAL_BRANCH(!m_config->sparse_gen_deltaR && !doingSystematics(), gen_deltaR_muon_L2, std::vector<float>);
+        CONDITIONAL_BRANCH(!m_config->sparse_gen_deltaR && !doingSystematics(), gen_deltaR_muon_L1_afterFSR, std::vector<float>);
+        CONDITIONAL_BRANCH(!m_config->sparse_gen_deltaR && !doingSystematics(), gen_deltaR_muon_L2_afterFSR, std::vector<float>);
+
+        // Sparse gen-reco matching: indices (in the framework collection) and ΔR of the best matching reco objects,
+        // empty if the gen target was not found
+        CONDITIONAL_BRANCH(m_config->sparse_gen_deltaR && !doingSystematics(), gen_match_jet_B_idx, std::vector<int>);
+        CONDITIONAL_BRANCH(m_config->sparse_gen_deltaR && !doingSystematics(), gen_match_jet_B_deltaR, std::vector<float>);
+        CONDITIONAL_BRANCH(m_config->sparse_gen_deltaR && !doingSystematics(), gen_match_jet_Bbar_idx, std::vector<int>);
+        CONDITIONAL_BRANCH(m_config->sparse_gen_deltaR && !doingSystematics(), gen_match_jet_Bbar_deltaR, std::vector<float>);
+        CONDITIONAL_BRANCH(m_config->sparse_gen_deltaR && !doingSystematics(), gen_match_jet_B_afterFSR_idx, std::vector<int>);
+        CONDITIONAL_BRANCH(m_config->sparse_gen_deltaR && !doingSystematics(), gen_match_jet_B_afterFSR_deltaR, std::vector<float>);
+        CONDITIONAL_BRANCH(m_config->sparse_gen_deltaR && !doingSystematics(), gen_match_jet_Bbar_afterFSR_idx, std::vector<int>);
+        CONDITIONAL_BRANCH(m_config->sparse_gen_deltaR && !doingSystematics(), gen_match_jet_Bbar_afterFSR_deltaR, std::vector<float>);
+        CONDITIONAL_BRANCH(m_config->sparse_gen_deltaR && !doingSystematics(), gen_match_electron_Lminus_idx, std::vector<int>);
+        CONDITIONAL_BRANCH(m_config->sparse_gen_deltaR && !doingSystematics(), gen_match_electron_Lminus_deltaR, std::vector<float>);
+        CONDITIONAL_BRANCH(m_config->sparse_gen_deltaR && !doingSystematics(), gen_match_electron_Lplus_idx, std::vector<int>);
+        CONDITIONAL_BRANCH(m_config->sparse_gen_deltaR && !doingSystematics(), gen_match_electron_Lplus_deltaR, std::vector<float>);
+        CONDITIONAL_BRANCH(m_config->sparse_gen_deltaR && !doingSystematics(), gen_match_electron_Lminus_afterFSR_idx, std::vector<int>);
+        CONDITIONAL_BRANCH(m_config->sparse_gen_deltaR && !doingSystematics(), gen_match_electron_Lminus_afterFSR_deltaR, std::vector<float>);
+        CONDITIONAL_BRANCH(m_config->sparse_gen_deltaR && !doingSystematics(), gen_match_electron_Lplus_afterFSR_idx, std::vector<int>);
+        CONDITIONAL_BRANCH(m_config->sparse_gen_deltaR && !doingSystematics(), gen_match_electron_Lplus_afterFSR_deltaR, std::vector<float>);
+        CONDITIONAL_BRANCH(m_config->sparse_gen_deltaR && !doingSystematics(), gen_match_muon_Lminus_idx, std::vector<int>);
+        CONDITIONAL_BRANCH(m_config->sparse_gen_deltaR && !doingSystematics(), gen_match_muon_Lminus_deltaR, std::vector<float>);
+        CONDITIONAL_BRANCH(m_config->sparse_gen_deltaR && !doingSystematics(), gen_match_muon_Lplus_idx, std::vector<int>);
+        CONDITIONAL_BRANCH(m_config->sparse_gen_deltaR && !doingSystematics(), gen_match_muon_Lplus_deltaR, std::vector<float>);
+        CONDITIONAL_BRANCH(m_config->sparse_gen_deltaR && !doingSystematics(), gen_match_muon_Lminus_afterFSR_idx, std::vector<int>);
+        CONDITIONAL_BRANCH(m_config->sparse_gen_deltaR && !doingSystematics(), gen_match_muon_Lminus_afterFSR_deltaR, std::vector<float>);
+        CONDITIONAL_BRANCH(m_config->sparse_gen_deltaR && !doingSystematics(), gen_match_muon_Lplus_afterFSR_idx, std::vector<int>);
+        CONDITIONAL_BRANCH(m_config->sparse_gen_deltaR && !doingSystematics(), gen_match_muon_Lplus_afterFSR_deltaR, std::vector<float>);
 
 
     private:
-        // Producers name
-        std::string m_electrons_producer;
-        std::string m_muons_producer;
-        std::string m_jets_producer;
-        std::string m_met_producer;
-        std::string m_nohf_met_producer;
-        float m_electronIsoCut_EB_Loose, m_electronIsoCut_EE_Loose, m_electronIsoCut_EB_Tight, m_electronIsoCut_EE_Tight, m_electronEtaCut, m_leadingElectronPtCut, m_subleadingElectronPtCut;
-        float m_muonLooseIsoCut, m_muonTightIsoCut, m_muonEtaCut, m_leadingMuonPtCut, m_subleadingMuonPtCut;
-        float m_jetEtaCut, m_jetPtCut, m_jet_bDiscrCut_loose, m_jet_bDiscrCut_medium, m_jet_bDiscrCut_tight;
-        float m_minDR_l_j_Cut;
-        float m_hltDRCut, m_hltDPtCut;
-        std::string m_jet_bDiscrName;
-        std::string m_electron_loose_wp_name;
-        std::string m_electron_medium_wp_name;
-        std::string m_electron_tight_wp_name;
-        std::string m_electron_hlt_safe_wp_name;
-        bool m_applyBJetRegression;
-        std::unordered_map<std::string, std::unique_ptr<BinnedValues>> m_hlt_efficiencies;
-
-        std::mt19937 random_generator;
-        std::uniform_real_distribution<double> br_generator;
+        std::unique_ptr<HH::FlatOutput> m_flat_writer;
+
+        // Buffers for the inputs of the current event, reused from one event to the next
+        HH::EventInputs m_inputs;
+        // Buffers of the object selection
+        HH::ObjectSelection m_selection;
+        HH::DileptonCandidates m_dilepton_candidates;
+        HH::DijetRanker m_dijet_ranker;
+        // Scratch buffer of fillGenMatches
+        mutable std::vector<std::pair<float, int>> m_gen_match_candidates;
+        // Histograms of the selected candidates, when `histograms` is set
+        HH::HistogramSet m_histograms {m_config->histograms};
+        // Yields of the cut scan grid, when cutScan is set
+        HH::CutScanYields m_cut_scan {m_config->cut_scan};
+        // Skim trees, when skim.file is set. Shared with the systematic clones
+        std::shared_ptr<HH::SkimWriter> m_skim_writer;
+        static const size_t NO_CATEGORY = static_cast<size_t>(-1);
+        // Stream of each dilepton flavour, NO_SKIM_STREAM for the categories not skimmed
+        static const size_t NO_SKIM_STREAM = static_cast<size_t>(-1);
+        std::array<size_t, 4> m_skim_streams {{ NO_SKIM_STREAM, NO_SKIM_STREAM, NO_SKIM_STREAM, NO_SKIM_STREAM }};
+        // Lepton pt cuts of the categories (categories_parameters), by flavour, as (leading, subleading), for
+        // selectedCategory(). Set in registerCategories, so left at 0 when the analyzer runs outside the Framework (bin/hhReplay)
+        std::array<std::pair<float, float>, 4> m_category_pt_cuts {};
+        // Binary records of the selected events, when recordsFile is set. Shared with the systematic clones
+        std::shared_ptr<HH::EventRecordWriter> m_records_writer;
+        uint32_t m_records_analyzer = 0;
+        std::unique_ptr<HH::InputsWriter> m_inputs_writer;
+        // Inputs of the slow events, when slowEventsFile is set
+        std::unique_ptr<HH::InputsWriter> m_slow_events_writer;
+        // Timeline of the sampled events, when traceFile is set. The recorder is shared with the systematic clones
+        std::unique_ptr<HH::TraceTrack> m_trace_track;
+        // Gen truth scans worth running on this sample (see sampleType)
+        std::unique_ptr<HH::TruthScanSwitch> m_hh_truth_scan;
+        std::unique_ptr<HH::TruthScanSwitch> m_ttbar_truth_scan;
+        HH::SlowEventSelector m_slow_event_selector {m_config->slow_event_threshold_ns, m_config->slow_event_quantile};
+
+        // Stage timings, tracing `event` if it is sampled. Null when no stage instrumentation is on
+        HH::StageTimings* stageTimings(uint64_t event);
 };
 
 // Some macros for gen information
@@ -329,6 +410,11 @@ class HHAnalyzer: public Framework::Analyzer {
             } \
         }
 
+#define FILL_GEN_MATCHES(RECO, COLLECTION, X) \
+        if (gen_i##X != -1) { \
+            fillGenMatches(RECO.gen_p4, RECO.matched, gen_##X, gen_match_##COLLECTION##_##X##_idx, gen_match_##COLLECTION##_##X##_deltaR); \
+        }
+
 #define PRINT_PARTICULE(X) \
         if (gen_i##X != -1) { \
             std::cout << "    gen_" #X ".M() = " << gen_##X.M() << std::endl; \
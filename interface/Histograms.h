@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cp3_llbb/HHAnalysis/interface/Types.h>
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace edm {
+    class ParameterSet;
+}
+
+namespace HH {
+
+    // Quantity of the selected llmetjj candidate. Names follow the flat output columns (`MT2`, `ll_pt`, ...),
+    // with an extra `_M` for the four-vectors
+    typedef float (*CandidateVariable)(const DileptonMetDijet&);
+
+    // Throws for an unknown name
+    CandidateVariable candidateVariable(const std::string& name);
+
+    // Uniform binning of one variable. Bin 0 is the underflow, bin `bins + 1` the overflow, as in ROOT
+    struct HistogramAxis {
+        std::string variable;
+        CandidateVariable getter = nullptr;
+        size_t bins = 0;
+        float min = 0;
+        float max = 0;
+
+        size_t find(float value) const;
+    };
+
+    // One entry of the `histograms` VPSet: name, x (and optionally y) variable with its binning, and whether the
+    // trigger efficiency of the candidate is applied on top of the event weight
+    struct HistogramDefinition {
+        std::string name;
+        HistogramAxis x;
+        // y.bins == 0 for a 1D histogram
+        HistogramAxis y;
+        bool trigger_efficiency;
+
+        HistogramDefinition(const edm::ParameterSet& config);
+
+        bool is2D() const { return y.bins > 0; }
+        // Number of bins, under- and overflows included
+        size_t cells() const { return (x.bins + 2) * (is2D() ? y.bins + 2 : 1); }
+    };
+
+    // Sums of weights and of squared weights of every histogram, for each dilepton flavour of llmetjj[0].
+    // Instances can be summed, e.g. to merge the outputs of several jobs
+    class HistogramSet {
+        public:
+            // Same order as the dilepton flavour index, 2 * lep1.isMu + lep2.isMu
+            static const std::array<std::string, 4> categories;
+
+            HistogramSet(const std::vector<HistogramDefinition>& definitions);
+
+            void fill(size_t category, const DileptonMetDijet& candidate, float event_weight);
+
+            HistogramSet& operator+=(const HistogramSet& other);
+
+            // Written as TH1D / TH2D named <prefix>_<histogram>_<category>. The first call for a path in the job
+            // recreates the file, the next ones (e.g. the systematic clones) add to it
+            void write(const std::string& path, const std::string& prefix) const;
+
+        private:
+            const std::vector<HistogramDefinition>* m_definitions;
+            // Offset of each histogram of the first category in m_sumw; the categories follow each other
+            std::vector<size_t> m_offsets;
+            size_t m_category_size = 0;
+            std::vector<double> m_sumw;
+            std::vector<double> m_sumw2;
+            std::vector<uint64_t> m_entries;
+    };
+}
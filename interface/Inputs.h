@@ -0,0 +1,227 @@
+#pragma once
+
+#include <cp3_llbb/Framework/interface/EventProducer.h>
+#include <cp3_llbb/Framework/interface/GenParticlesProducer.h>
+#include <cp3_llbb/Framework/interface/JetsProducer.h>
+#include <cp3_llbb/Framework/interface/ElectronsProducer.h>
+#include <cp3_llbb/Framework/interface/MuonsProducer.h>
+#include <cp3_llbb/Framework/interface/METProducer.h>
+#include <cp3_llbb/Framework/interface/HLTProducer.h>
+
+#include <cp3_llbb/HHAnalysis/interface/Types.h>
+
+#include <FWCore/Utilities/interface/EDMException.h>
+
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+class ProducersManager;
+
+namespace edm {
+    class Event;
+}
+
+// Same type as the producer branch NAME, without the reference: copy of a single value
+#define HH_INPUT_VALUE(PRODUCER, NAME) std::decay<decltype(std::declval<PRODUCER>().NAME)>::type NAME
+// View of the producer collection NAME (see InputView)
+#define HH_INPUT(PRODUCER, NAME) HH::InputView<std::decay<decltype(std::declval<PRODUCER>().NAME)>::type> NAME
+
+namespace HH {
+
+    struct AnalyzerConfiguration;
+
+    // Collection read by the analysis. While the Framework runs it only points to the producer branch, valid for the
+    // current event: nothing is copied. It owns its values when they are read from a file (bin/hhReplay), set by
+    // hand (bin/hhBenchmark) or when the EventInputs is copied
+    template <typename T> class InputView {
+        public:
+            typedef typename T::value_type value_type;
+            typedef typename T::const_iterator const_iterator;
+
+            InputView(): m_data(&m_owned) {}
+            InputView(const InputView& other): m_owned(other.get()), m_data(&m_owned) {}
+            InputView& operator=(const InputView& other) {
+                if (this != &other) {
+                    m_owned = other.get();
+                    m_data = &m_owned;
+                }
+                return *this;
+            }
+
+            // Point to `values`, which must outlive the use of the view
+            void bind(const T& values) { m_data = &values; }
+
+            // Own storage, now viewed, to be filled
+            T& owned() {
+                m_data = &m_owned;
+                return m_owned;
+            }
+
+            void clear() { owned().clear(); }
+
+            const T& get() const { return *m_data; }
+            operator const T&() const { return *m_data; }
+
+            size_t size() const { return m_data->size(); }
+            bool empty() const { return m_data->empty(); }
+            const_iterator begin() const { return m_data->begin(); }
+            const_iterator end() const { return m_data->end(); }
+            auto operator[](size_t i) const -> decltype(std::declval<const T&>()[i]) { return (*m_data)[i]; }
+
+        private:
+            T m_owned;
+            const T* m_data;
+    };
+
+    // Everything HHAnalyzer reads from the producers for one event. Gathering it first decouples the analysis
+    // from the Framework: the same inputs can be captured to a file and replayed offline (see bin/hhReplay.cc).
+    // Members are named after the producer branches so that the analysis code reads the same. The producer collections
+    // are views: a job only pays for copies when the EventInputs itself is copied
+    struct EventInputs {
+        bool isRealData;
+        uint32_t run;
+        uint32_t lumi;
+        uint64_t event;
+
+        struct Event {
+            HH_INPUT_VALUE(EventProducer, run);
+            HH_INPUT_VALUE(EventProducer, weight);
+
+            template <typename V> void visit(V& v) { v(run); v(weight); }
+        } fwevent;
+
+        struct Jets {
+            HH_INPUT(JetsProducer, p4);
+            HH_INPUT(JetsProducer, gen_p4);
+            HH_INPUT(JetsProducer, matched);
+            HH_INPUT(JetsProducer, passLooseID);
+            HH_INPUT(JetsProducer, regPt);
+            HH_INPUT(JetsProducer, hadronFlavor);
+            HH_INPUT(JetsProducer, partonFlavor);
+            // b-tagging discriminants: CSVv2, cMVAv2 and the one named by `discr_name`. Only for the selected jets, 0 otherwise
+            std::vector<float> CSV;
+            std::vector<float> CMVAv2;
+            std::vector<float> bDiscr;
+
+            template <typename V> void visit(V& v) {
+                v(p4); v(gen_p4); v(matched); v(passLooseID); v(regPt); v(hadronFlavor); v(partonFlavor);
+                v(CSV); v(CMVAv2); v(bDiscr);
+            }
+        } jets;
+
+        struct Electrons {
+            HH_INPUT(ElectronsProducer, p4);
+            HH_INPUT(ElectronsProducer, charge);
+            HH_INPUT(ElectronsProducer, gen_p4);
+            HH_INPUT(ElectronsProducer, matched);
+            HH_INPUT(ElectronsProducer, dxy);
+            HH_INPUT(ElectronsProducer, dz);
+            // Read from the pat::Electron, which is not available offline. Only for the selected electrons, false and 0 otherwise
+            std::vector<bool> isEB;
+            std::vector<float> sc_eta;
+            // IDs named by `electrons_medium_wp_name` and `electrons_hlt_safe_wp_name`. Only for the electrons passing the
+            // kinematic cuts (medium) and the selected ones (HLT-safe), false otherwise
+            std::vector<bool> medium_id;
+            std::vector<bool> hlt_safe_id;
+
+            template <typename V> void visit(V& v) {
+                v(p4); v(charge); v(gen_p4); v(matched); v(dxy); v(dz);
+                v(isEB); v(sc_eta); v(medium_id); v(hlt_safe_id);
+            }
+        } electrons;
+
+        struct Muons {
+            HH_INPUT(MuonsProducer, p4);
+            HH_INPUT(MuonsProducer, charge);
+            HH_INPUT(MuonsProducer, gen_p4);
+            HH_INPUT(MuonsProducer, matched);
+            HH_INPUT(MuonsProducer, isTight);
+            HH_INPUT(MuonsProducer, relativeIsoR04_deltaBeta);
+
+            template <typename V> void visit(V& v) {
+                v(p4); v(charge); v(gen_p4); v(matched); v(isTight); v(relativeIsoR04_deltaBeta);
+            }
+        } muons;
+
+        struct HLT {
+            HH_INPUT(HLTProducer, paths);
+            HH_INPUT(HLTProducer, object_p4);
+            HH_INPUT(HLTProducer, object_pdg_id);
+            HH_INPUT(HLTProducer, object_paths);
+            HH_INPUT(HLTProducer, object_filters);
+
+            template <typename V> void visit(V& v) {
+                v(paths); v(object_p4); v(object_pdg_id); v(object_paths); v(object_filters);
+            }
+        } hlt;
+
+        // One entry per metProducers, in the same order
+        struct MET {
+            std::vector<std::decay<decltype(std::declval<METProducer>().p4)>::type> p4;
+
+            template <typename V> void visit(V& v) { v(p4); }
+        } met;
+
+        // Empty for data
+        struct GenParticles {
+            HH_INPUT(GenParticlesProducer, pruned_p4);
+            HH_INPUT(GenParticlesProducer, pruned_pdg_id);
+            HH_INPUT(GenParticlesProducer, pruned_status_flags);
+            HH_INPUT(GenParticlesProducer, pruned_mothers_index);
+
+            template <typename V> void visit(V& v) {
+                v(pruned_p4); v(pruned_pdg_id); v(pruned_status_flags); v(pruned_mothers_index);
+            }
+        } gen_particles;
+
+        // Point to the collections of the current event in the producers (see InputView); only the values computed
+        // here (b-tagging discriminants, electron IDs, ...) are stored. Buffers are reused when called again on the same object
+        void fill(const edm::Event& event, const ProducersManager& producers, const AnalyzerConfiguration& config);
+
+        template <typename V> void visit(V& v) {
+            v(isRealData); v(run); v(lumi); v(event);
+            fwevent.visit(v);
+            jets.visit(v);
+            electrons.visit(v);
+            muons.visit(v);
+            hlt.visit(v);
+            met.visit(v);
+            gen_particles.visit(v);
+        }
+    };
+
+    // Binary file of captured inputs: a header (magic, version, analyzer name and the analyzer PSet as
+    // edm::ParameterSet::toString), then one length-prefixed record per event
+    class InputsWriter {
+        public:
+            InputsWriter(const std::string& path, const std::string& analyzer_name, const std::string& configuration);
+
+            // Thread-safe
+            void write(EventInputs& inputs);
+
+        private:
+            std::ofstream m_file;
+            std::mutex m_mutex;
+    };
+
+    class InputsReader {
+        public:
+            InputsReader(const std::string& path);
+
+            const std::string& analyzerName() const { return m_analyzer_name; }
+            const std::string& configuration() const { return m_configuration; }
+
+            // False at the end of the file
+            bool next(EventInputs& inputs);
+
+        private:
+            std::ifstream m_file;
+            std::string m_analyzer_name;
+            std::string m_configuration;
+    };
+}
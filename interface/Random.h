@@ -0,0 +1,52 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+namespace HH {
+
+    // Philox4x32-10 counter-based generator (Salmon et al., "Parallel random numbers: as easy as 1, 2, 3", SC11).
+    // The output only depends on (counter, key): there is no state, so the same event always gets the
+    // same numbers whatever the job splitting, the event order or the number of threads
+    class Philox4x32 {
+        public:
+            typedef std::array<uint32_t, 4> Counter;
+            typedef std::array<uint32_t, 2> Key;
+
+            static Counter generate(Counter counter, Key key) {
+                for (int round = 0; round < 10; round++) {
+                    if (round > 0) {
+                        key[0] += W0;
+                        key[1] += W1;
+                    }
+
+                    uint64_t product0 = static_cast<uint64_t>(M0) * counter[0];
+                    uint64_t product1 = static_cast<uint64_t>(M1) * counter[2];
+                    counter = {{
+                        static_cast<uint32_t>(product1 >> 32) ^ counter[1] ^ key[0],
+                        static_cast<uint32_t>(product1),
+                        static_cast<uint32_t>(product0 >> 32) ^ counter[3] ^ key[1],
+                        static_cast<uint32_t>(product0)
+                    }};
+                }
+
+                return counter;
+            }
+
+        private:
+            static const uint32_t M0 = 0xD2511F53;
+            static const uint32_t M1 = 0xCD9E8D57;
+            static const uint32_t W0 = 0x9E3779B9;
+            static const uint32_t W1 = 0xBB67AE85;
+    };
+
+    // Uniform number in [0, 1[ for the event (run, lumi, event). `stream` separates independent uses within an event
+    inline double eventUniform(uint32_t seed, uint32_t stream, uint32_t run, uint32_t lumi, uint64_t event) {
+        Philox4x32::Counter counter = {{ static_cast<uint32_t>(event), static_cast<uint32_t>(event >> 32), lumi, run }};
+        Philox4x32::Counter output = Philox4x32::generate(counter, {{ seed, stream }});
+
+        // 53 random bits, the full precision of a double
+        uint64_t bits = (static_cast<uint64_t>(output[0]) << 21) ^ (output[1] >> 11);
+        return bits * (1.0 / (UINT64_C(1) << 53));
+    }
+}
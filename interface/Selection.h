@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cp3_llbb/HHAnalysis/interface/Inputs.h>
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace HH {
+
+    struct AnalyzerConfiguration;
+
+    // pt > `pt_cut` and |eta| < `eta_cut`. Also used by EventInputs::fill to only read the producer objects that can pass
+    inline bool passesKinematicCuts(float pt, float eta, float pt_cut, float eta_cut) {
+        return (pt > pt_cut) & (std::abs(eta) < eta_cut);
+    }
+
+    // Object-level selection of one collection. The cut variables are gathered from the four-vectors into
+    // contiguous arrays, the cuts are evaluated over them into a byte mask (branch-free loops the compiler
+    // can vectorize), and the mask is compacted into the indices of the objects passing. Buffers are reused
+    // from one event to the next
+    struct CollectionSelection {
+        std::vector<float> pt;
+        std::vector<float> eta;
+        // 1 if the object passes the cuts
+        std::vector<uint8_t> mask;
+        // Indices of the objects passing, in the order of the collection
+        std::vector<uint32_t> indices;
+
+        void gather(const std::vector<LorentzVector>& p4);
+        // Kinematic cuts: pt > `pt_cut` and |eta| < `eta_cut`
+        void cut(float pt_cut, float eta_cut);
+        // mask &= flags
+        void require(const std::vector<bool>& flags);
+        void compact();
+    };
+
+    // Electrons, muons and jets passing the object selection of HHAnalyzer. Filled at the top of analyze(),
+    // before the gen truth, since the dilepton preselection relies on it
+    struct ObjectSelection {
+        // pt > subleading pt cut, |eta| cut and medium ID
+        CollectionSelection electrons;
+        // pt > subleading pt cut, |eta| cut, tight ID and tight isolation
+        CollectionSelection muons;
+        // pt (after b-jet regression, if enabled) and |eta| cuts, loose ID. The ΔR cleaning against the
+        // selected leptons happens later, in the jet loop
+        CollectionSelection jets;
+
+        void select(const EventInputs& inputs, const AnalyzerConfiguration& config);
+    };
+}
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <cp3_llbb/HHAnalysis/interface/FlatOutput.h>
+#include <cp3_llbb/HHAnalysis/interface/Types.h>
+
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+class TFile;
+
+namespace edm {
+    class ParameterSet;
+}
+
+namespace HH {
+
+    // Configured with the `skim` PSet: events of the selected dilepton categories are also written to `file`, one
+    // flat tree per analyzer and category, with a sorted index of the events next to it
+    struct SkimConfiguration {
+        // Same order as the dilepton flavour index, 2 * lep1.isMu + lep2.isMu
+        static const std::array<std::string, 4> categories;
+
+        std::string file;
+        // Defaults to `file` + ".index"
+        std::string index_file;
+        // Skimmed categories, by flavour index
+        std::array<bool, 4> enabled_categories = {{ false, false, false, false }};
+        // Fill and compress the trees in a background thread (see SkimWriter)
+        bool asynchronous = true;
+        // Events per staging buffer. At most twice as many events are held in memory
+        size_t buffer_events = 1000;
+
+        SkimConfiguration() = default;
+        SkimConfiguration(const edm::ParameterSet& config);
+
+        bool enabled() const { return !file.empty(); }
+    };
+
+    // Entry of the skim index: where to find one event of one stream. Records are sorted by (run, lumi, event, tree)
+    struct SkimIndexRecord {
+        uint32_t run;
+        uint32_t lumi;
+        uint64_t event;
+        // Position of the tree in SkimIndex::trees()
+        uint32_t tree;
+        uint32_t entry;
+    };
+    static_assert(sizeof(SkimIndexRecord) == 24, "The index records are written as is");
+
+    // Writes the skim trees and their index. One writer per file, shared by the analyzers (nominal and systematic
+    // clones) writing to it; the trees and the index are written when the last one is destroyed.
+    //
+    // In asynchronous mode, fill() only copies the event into the front staging buffer. When it is full, it is
+    // swapped with the back one, which a background thread fills into the trees (where the baskets are compressed)
+    // while the analyzers carry on with the front buffer. An analyzer only waits when the front buffer is
+    // full again before the background thread is done with the back one, which bounds the memory used. The thread
+    // needs ROOT::EnableThreadSafety(), called by the constructor. Only the skim trees are filled this way: the main
+    // tree belongs to the Framework, which fills and compresses it on the event thread
+    class SkimWriter {
+        public:
+            static std::shared_ptr<SkimWriter> get(const SkimConfiguration& config);
+
+            SkimWriter(const SkimConfiguration& config);
+            ~SkimWriter();
+
+            SkimWriter(const SkimWriter&) = delete;
+            SkimWriter& operator=(const SkimWriter&) = delete;
+
+            // New tree named `name`, with the run, lumi and event numbers, the event weight and the flat columns of the
+            // objects (see FlatOutput). Returns the index of the stream, to pass to fill()
+            size_t addStream(const std::string& name, const OutputPolicy& policy);
+
+            // Thread-safe
+            void fill(size_t stream, uint32_t run, uint32_t lumi, uint64_t event, float event_weight,
+                    const std::vector<Lepton>& leptons, const std::vector<Jet>& jets, const std::vector<Met>& met, const std::vector<DileptonMetDijet>& llmetjj);
+
+            uint64_t entries(size_t stream) const;
+
+        private:
+            struct Stream;
+
+            // Copy of the event, kept between events so that the vectors keep their capacity
+            struct StagedEvent {
+                Stream* stream;
+                uint32_t run;
+                uint32_t lumi;
+                uint64_t event;
+                float event_weight;
+                std::vector<Lepton> leptons;
+                std::vector<Jet> jets;
+                std::vector<Met> met;
+                std::vector<DileptonMetDijet> llmetjj;
+            };
+
+            struct StagingBuffer {
+                std::vector<StagedEvent> events;
+                size_t size = 0;
+            };
+
+            static void writeEvent(Stream& stream, uint32_t run, uint32_t lumi, uint64_t event, float event_weight,
+                    const std::vector<Lepton>& leptons, const std::vector<Jet>& jets, const std::vector<Met>& met, const std::vector<DileptonMetDijet>& llmetjj);
+            // Body of the background thread
+            void run();
+            void writeIndex() const;
+
+            std::string m_path;
+            std::string m_index_path;
+            std::unique_ptr<TFile> m_file;
+
+            mutable std::mutex m_mutex;
+            std::vector<std::unique_ptr<Stream>> m_streams;
+            std::vector<SkimIndexRecord> m_index;
+
+            // Asynchronous mode only. `m_front` is filled by the analyzers, `m_back` written by `m_thread`
+            // while `m_back_busy`. Both are guarded by `m_mutex`
+            size_t m_buffer_events;
+            StagingBuffer m_front;
+            StagingBuffer m_back;
+            bool m_back_busy = false;
+            bool m_stop = false;
+            // Number of times an analyzer had to wait for the background thread
+            uint64_t m_waits = 0;
+            std::condition_variable m_back_ready;
+            std::condition_variable m_back_done;
+            std::thread m_thread;
+    };
+
+    // Reads a skim index. Lookups are binary searches in the sorted records
+    class SkimIndex {
+        public:
+            SkimIndex(const std::string& path);
+
+            const std::vector<std::string>& trees() const { return m_trees; }
+            const std::vector<SkimIndexRecord>& records() const { return m_records; }
+
+            // Records of the event, one per tree it was written to (e.g. the systematic clones)
+            std::pair<std::vector<SkimIndexRecord>::const_iterator, std::vector<SkimIndexRecord>::const_iterator> find(uint32_t run, uint32_t lumi, uint64_t event) const;
+
+        private:
+            std::vector<std::string> m_trees;
+            std::vector<SkimIndexRecord> m_records;
+    };
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cp3_llbb/HHAnalysis/interface/Allocations.h>
+#include <cp3_llbb/HHAnalysis/interface/Trace.h>
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+namespace HH {
+
+    // Stages of HHAnalyzer::analyze. Inputs is the copy from the producers (and the capture, if enabled), Selection
+    // the object-level cuts (see Selection.h); HLT matching and trigger efficiencies are nested inside the leptons stage
+    namespace Stage {
+        enum Stage { Inputs, Selection, GenTruth, Leptons, HLTMatching, TriggerEfficiencies, Met, Jets, Dijets, Llmetjj, TTbarTruth, Count };
+        const std::array<std::string, Count> names = {{ "inputs", "selection", "gen_truth", "leptons", "hlt_matching", "trigger_efficiencies", "met", "jets", "dijets", "llmetjj", "ttbar_truth" }};
+    }
+
+    // Histogram of durations in ns, with 8 logarithmic bins per power of two: quantiles are
+    // known within 12.5%, count, mean and max are exact
+    class DurationHistogram {
+        public:
+            void add(uint64_t ns) {
+                m_bins[bin(ns)]++;
+                m_count++;
+                m_sum += ns;
+                if (ns > m_max)
+                    m_max = ns;
+            }
+
+            DurationHistogram& operator+=(const DurationHistogram& other);
+
+            uint64_t count() const { return m_count; }
+            double mean() const { return m_count ? static_cast<double>(m_sum) / m_count : 0; }
+            uint64_t max() const { return m_max; }
+            // Lower edge of the bin containing the quantile q (0 < q <= 1)
+            uint64_t quantile(double q) const;
+
+        private:
+            static const size_t SUB_BINS = 8;
+            static const size_t N_BINS = (64 - 2) * SUB_BINS;
+
+            static size_t bin(uint64_t ns) {
+                if (ns < SUB_BINS)
+                    return ns;
+                size_t exponent = 63 - __builtin_clzll(ns);
+                return (exponent - 2) * SUB_BINS + ((ns >> (exponent - 3)) & (SUB_BINS - 1));
+            }
+
+            static uint64_t lowerEdge(size_t bin) {
+                if (bin < SUB_BINS)
+                    return bin;
+                size_t exponent = bin / SUB_BINS + 2;
+                return (SUB_BINS + bin % SUB_BINS) << (exponent - 3);
+            }
+
+            std::array<uint64_t, N_BINS> m_bins {};
+            uint64_t m_count = 0;
+            uint64_t m_sum = 0;
+            uint64_t m_max = 0;
+    };
+
+    struct StageTimings {
+        std::array<DurationHistogram, Stage::Count> stages;
+        // Heap allocations done in each stage (see AllocationHook.h)
+        std::array<AllocationCount, Stage::Count> allocations;
+        // Where the stages of the current event are traced, null if it is not
+        TraceTrack* trace = nullptr;
+
+        StageTimings& operator+=(const StageTimings& other);
+
+        // One line per stage with count, mean, p50, p99 and max
+        void report(std::ostream& out) const;
+        // One line per stage with the allocations and bytes per call
+        void reportAllocations(std::ostream& out) const;
+    };
+
+    // Measures the time and the allocations between its construction and stop() (or its destruction) into a stage.
+    // Does nothing, without reading the clock, when `timings` is null: this is how timers are switched off
+    class StageTimer {
+        public:
+            StageTimer(StageTimings* timings, Stage::Stage stage):
+                m_timings(timings), m_stage(stage) {
+                if (m_timings) {
+                    m_start_allocations = threadAllocations();
+                    m_start = std::chrono::steady_clock::now();
+                }
+            }
+
+            ~StageTimer() {
+                stop();
+            }
+
+            StageTimer(const StageTimer&) = delete;
+            StageTimer& operator=(const StageTimer&) = delete;
+
+            void stop() {
+                if (!m_timings)
+                    return;
+                auto elapsed = std::chrono::steady_clock::now() - m_start;
+                m_timings->stages[m_stage].add(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+                m_timings->allocations[m_stage] += threadAllocations() - m_start_allocations;
+                if (m_timings->trace)
+                    m_timings->trace->record(Stage::names[m_stage].c_str(), m_stage + 1, m_start, elapsed);
+                m_timings = nullptr;
+            }
+
+        private:
+            StageTimings* m_timings;
+            Stage::Stage m_stage;
+            std::chrono::steady_clock::time_point m_start;
+            AllocationCount m_start_allocations;
+    };
+}
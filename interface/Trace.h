@@ -0,0 +1,91 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace HH {
+
+    // One slice of the timeline: `name` must outlive the recorder (string literals, Stage::names)
+    struct TraceSlice {
+        const char* name;
+        uint32_t tid;
+        uint64_t event;
+        std::chrono::steady_clock::time_point start;
+        std::chrono::steady_clock::duration duration;
+    };
+
+    // Collects timeline slices in a bounded ring buffer (the oldest are overwritten) and writes them as
+    // Chrome trace-event JSON, readable by chrome://tracing or https://ui.perfetto.dev, when the last
+    // analyzer using it is destroyed. Each (analyzer, stage) is a thread of the trace, so that systematic
+    // clones and stages get their own tracks
+    class TraceRecorder {
+        public:
+            // One recorder per file, shared by the analyzers (nominal and systematic clones) writing to it
+            static std::shared_ptr<TraceRecorder> get(const std::string& path, size_t capacity);
+
+            TraceRecorder(const std::string& path, size_t capacity);
+            ~TraceRecorder();
+
+            TraceRecorder(const TraceRecorder&) = delete;
+            TraceRecorder& operator=(const TraceRecorder&) = delete;
+
+            // Index of a new analyzer in the trace. Its tracks are `index * tracks + [0, tracks)`, named after `track_names`
+            uint32_t addAnalyzer(const std::string& name, const std::vector<std::string>& track_names);
+
+            void record(const TraceSlice& slice);
+
+        private:
+            void write() const;
+
+            std::string m_path;
+            std::chrono::steady_clock::time_point m_epoch;
+
+            mutable std::mutex m_mutex;
+            std::vector<TraceSlice> m_buffer;
+            size_t m_next = 0;
+            uint64_t m_recorded = 0;
+            std::map<uint32_t, std::string> m_track_names;
+            uint32_t m_analyzers = 0;
+    };
+
+    // Tracks of one analyzer, for the event being traced
+    struct TraceTrack {
+        std::shared_ptr<TraceRecorder> recorder;
+        uint32_t first_tid;
+        // Event being traced, 0 when the current event is not sampled
+        uint64_t event = 0;
+
+        void record(const char* name, uint32_t track, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::duration duration) {
+            recorder->record({name, first_tid + track, event, start, duration});
+        }
+    };
+
+    // Records the time between its construction and its destruction as a slice of track 0 (the whole
+    // event). Does nothing when `track` is null
+    class TraceScope {
+        public:
+            TraceScope(TraceTrack* track, const char* name):
+                m_track(track), m_name(name) {
+                if (m_track)
+                    m_start = std::chrono::steady_clock::now();
+            }
+
+            ~TraceScope() {
+                if (m_track)
+                    m_track->record(m_name, 0, m_start, std::chrono::steady_clock::now() - m_start);
+            }
+
+            TraceScope(const TraceScope&) = delete;
+            TraceScope& operator=(const TraceScope&) = delete;
+
+        private:
+            TraceTrack* m_track;
+            const char* m_name;
+            std::chrono::steady_clock::time_point m_start;
+    };
+}
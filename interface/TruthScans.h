@@ -0,0 +1,48 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace HH {
+
+    // Kind of MC sample, as hinted by the sampleType parameter. Decides which gen truth scans are run
+    enum class SampleType {
+        Auto,       // Both scans, each disabled if it finds nothing in the first sampleDetectionEvents events
+        All,        // Both scans on every event
+        Signal,     // Only the HH scan
+        TTbar,      // Only the ttbar scan
+        Background  // None
+    };
+
+    // On / off switch of one gen truth scan (HH or ttbar), shared by the threads of an analyzer. In detection
+    // mode, the scan stays on for the first `detection_events` events it sees; if none of them had the
+    // particles it looks for, it is turned off for the rest of the job. The decision is logged
+    class TruthScanSwitch {
+        public:
+            // `detection_events` = 0: no detection, the scan stays as `enabled`
+            TruthScanSwitch(const std::string& name, bool enabled, uint64_t detection_events);
+
+            bool enabled() const {
+                return m_enabled.load(std::memory_order_relaxed);
+            }
+
+            // Outcome of the scan for one event. Only does something during the detection
+            void observe(bool found) {
+                if (m_decided.load(std::memory_order_relaxed))
+                    return;
+                observeSlow(found);
+            }
+
+        private:
+            void observeSlow(bool found);
+
+            std::string m_name;
+            uint64_t m_detection_events;
+
+            std::atomic<bool> m_enabled;
+            std::atomic<bool> m_decided;
+            std::atomic<uint64_t> m_events {0};
+            std::atomic<uint64_t> m_found {0};
+    };
+}
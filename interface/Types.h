@@ -84,10 +84,11 @@ namespace HH {
         float trigger_efficiency_downVariated;
         float trigger_efficiency_upVariated;
     };
+    // One per MET variant, in the order of metProducers: met[i] is read from metProducers[i]
     struct Met {
         LorentzVector p4;
         LorentzVector gen_p4;
-        bool isNoHF;
+        bool isNoHF; // read from nohfMETProducer. Other variants (PUPPI, ...) are only told apart by their index
         bool gen_matched;
         float gen_DR;
         float gen_DPhi;
@@ -97,7 +98,7 @@ namespace HH {
         LorentzVector p4;
         LorentzVector gen_p4;
         int ill; // index in the HH::Dilepton collection
-        int imet; // index in the HH::Met collection
+        int imet; // index in the HH::Met collection, so in metProducers
         float DPhi_ll_met;
         float minDPhi_l_met;
         float maxDPhi_l_met;
@@ -0,0 +1,71 @@
+#include <cp3_llbb/HHAnalysis/interface/Allocations.h>
+
+#include <algorithm>
+#include <iomanip>
+
+namespace {
+    bool s_hook_installed = false;
+}
+
+namespace HH {
+
+    AllocationCount& threadAllocations() {
+        thread_local AllocationCount allocations;
+        return allocations;
+    }
+
+    bool allocationHookInstalled() {
+        return s_hook_installed;
+    }
+
+    void installAllocationHook() {
+        s_hook_installed = true;
+    }
+
+    const std::array<std::string, MemoryStats::CollectionCount> MemoryStats::collection_names = {{ "leptons", "jets", "ll", "jj", "llmetjj" }};
+
+    void MemoryStats::addEvent(const AllocationCount& event) {
+        if (events++ >= WARMUP_EVENTS) {
+            steady_state += event;
+            steady_state_events++;
+        }
+        max_event_allocations = std::max(max_event_allocations, event.allocations);
+    }
+
+    void MemoryStats::observe(const std::vector<Lepton>& leptons, const std::vector<Jet>& jets, const std::vector<Dilepton>& ll, const std::vector<Dijet>& jj, const std::vector<DileptonMetDijet>& llmetjj) {
+        peak_capacity[Leptons] = std::max(peak_capacity[Leptons], leptons.capacity());
+        peak_capacity[Jets] = std::max(peak_capacity[Jets], jets.capacity());
+        peak_capacity[Ll] = std::max(peak_capacity[Ll], ll.capacity());
+        peak_capacity[Jj] = std::max(peak_capacity[Jj], jj.capacity());
+        peak_capacity[Llmetjj] = std::max(peak_capacity[Llmetjj], llmetjj.capacity());
+    }
+
+    MemoryStats& MemoryStats::operator+=(const MemoryStats& other) {
+        events += other.events;
+        steady_state += other.steady_state;
+        steady_state_events += other.steady_state_events;
+        max_event_allocations = std::max(max_event_allocations, other.max_event_allocations);
+        for (size_t i = 0; i < CollectionCount; i++)
+            peak_capacity[i] = std::max(peak_capacity[i], other.peak_capacity[i]);
+
+        return *this;
+    }
+
+    void MemoryStats::report(std::ostream& out) const {
+        if (!allocationHookInstalled())
+            out << "    (allocation hook not installed in this executable: allocations are not counted)" << std::endl;
+
+        out << std::fixed << std::setprecision(2);
+        out << "    events: " << events << " (" << steady_state_events << " after the first " << WARMUP_EVENTS << " of each thread)" << std::endl;
+        if (steady_state_events) {
+            out << "    steady state allocations / event: " << static_cast<double>(steady_state.allocations) / steady_state_events
+                << " (" << static_cast<double>(steady_state.bytes) / steady_state_events << " bytes)" << std::endl;
+        }
+        out << "    max allocations in one event: " << max_event_allocations << std::endl;
+        out << "    peak capacity:";
+        for (size_t i = 0; i < CollectionCount; i++)
+            out << " " << collection_names[i] << "=" << peak_capacity[i];
+        out << std::endl;
+        out << std::defaultfloat;
+    }
+}
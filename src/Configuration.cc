@@ -0,0 +1,189 @@
+#include <cp3_llbb/HHAnalysis/interface/Configuration.h>
+
+#include <cp3_llbb/Framework/interface/BinnedValuesJSONParser.h>
+#include <cp3_llbb/Framework/interface/WeightedBinnedValues.h>
+
+#include <FWCore/ParameterSet/interface/FileInPath.h>
+#include <FWCore/ParameterSet/interface/ParameterSet.h>
+#include <FWCore/Utilities/interface/EDMException.h>
+
+#include <algorithm>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <mutex>
+
+namespace HH {
+
+    std::shared_ptr<const AnalyzerConfiguration> AnalyzerConfiguration::get(const edm::ParameterSet& config) {
+        static std::mutex mutex;
+        static std::map<std::string, std::weak_ptr<const AnalyzerConfiguration>> cache;
+
+        std::lock_guard<std::mutex> lock(mutex);
+
+        std::weak_ptr<const AnalyzerConfiguration>& entry = cache[config.dump()];
+        std::shared_ptr<const AnalyzerConfiguration> result = entry.lock();
+        if (!result) {
+            result = std::make_shared<const AnalyzerConfiguration>(config);
+            entry = result;
+        }
+
+        return result;
+    }
+
+    AnalyzerConfiguration::AnalyzerConfiguration(const edm::ParameterSet& config) {
+        // Not untracked as these parameters are mandatory
+        electrons_producer = config.getParameter<std::string>("electronsProducer");
+        muons_producer = config.getParameter<std::string>("muonsProducer");
+        jets_producer = config.getParameter<std::string>("jetsProducer");
+        met_producer = config.getParameter<std::string>("metProducer");
+        nohf_met_producer = config.getParameter<std::string>("nohfMETProducer");
+        met_producers = config.getUntrackedParameter<std::vector<std::string>>("metProducers", {met_producer});
+        if (met_producers.empty())
+            throw edm::Exception(edm::errors::Configuration, "metProducers must not be empty");
+        // other parameters
+        muonLooseIsoCut = config.getUntrackedParameter<double>("muonLooseIsoCut");
+        muonTightIsoCut = config.getUntrackedParameter<double>("muonTightIsoCut");
+        muonEtaCut = config.getUntrackedParameter<double>("muonEtaCut", 2.4);
+        leadingMuonPtCut = config.getUntrackedParameter<double>("leadingMuonPtCut", 20);
+        subleadingMuonPtCut = config.getUntrackedParameter<double>("subleadingMuonPtCut", 10);
+
+        electronEtaCut = config.getUntrackedParameter<double>("electronEtaCut", 2.5);
+        leadingElectronPtCut = config.getUntrackedParameter<double>("leadingElectronPtCut", 20);
+        subleadingElectronPtCut = config.getUntrackedParameter<double>("subleadingElectronPtCut", 15);
+        electron_loose_wp_name = config.getUntrackedParameter<std::string>("electrons_loose_wp_name");
+        electron_medium_wp_name = config.getUntrackedParameter<std::string>("electrons_medium_wp_name");
+        electron_tight_wp_name = config.getUntrackedParameter<std::string>("electrons_tight_wp_name");
+        electron_hlt_safe_wp_name = config.getUntrackedParameter<std::string>("electrons_hlt_safe_wp_name");
+
+        jetEtaCut = config.getUntrackedParameter<double>("jetEtaCut", 2.4);
+        jetPtCut = config.getUntrackedParameter<double>("jetPtCut", 20);
+        jet_bDiscrName = config.getUntrackedParameter<std::string>("discr_name", "pfCombinedInclusiveSecondaryVertexV2BJetTags");
+        jet_bDiscrCut_loose = config.getUntrackedParameter<double>("discr_cut_loose");
+        jet_bDiscrCut_medium = config.getUntrackedParameter<double>("discr_cut_medium");
+        jet_bDiscrCut_tight = config.getUntrackedParameter<double>("discr_cut_tight");
+        minDR_l_j_Cut = config.getUntrackedParameter<double>("minDR_l_j_Cut", 0.3);
+        applyBJetRegression = config.getUntrackedParameter<bool>("applyBJetRegression", false);
+
+        hltDRCut = config.getUntrackedParameter<double>("hltDRCut", std::numeric_limits<float>::max());
+        hltDPtCut = config.getUntrackedParameter<double>("hltDPtCut", std::numeric_limits<float>::max());
+
+        output_mode = parseOutputMode(config.getUntrackedParameter<std::string>("outputMode", "struct"));
+        output_policy = OutputPolicy(config.getUntrackedParameter<edm::ParameterSet>("outputPolicy", edm::ParameterSet()));
+        if (output_mode != OutputMode::Flat && !output_policy.isDefault())
+            throw edm::Exception(edm::errors::Configuration, "outputPolicy is only supported with outputMode = 'flat'");
+
+        for (const auto& histogram: config.getUntrackedParameter<std::vector<edm::ParameterSet>>("histograms", {}))
+            histograms.emplace_back(histogram);
+        histograms_file = config.getUntrackedParameter<std::string>("histogramsFile", "");
+        if (!histograms.empty() && histograms_file.empty())
+            throw edm::Exception(edm::errors::Configuration, "histograms needs histogramsFile");
+        cut_scan = CutScanGrid(config.getUntrackedParameter<edm::ParameterSet>("cutScan", edm::ParameterSet()), minDR_l_j_Cut, jet_bDiscrCut_medium);
+        skim = SkimConfiguration(config.getUntrackedParameter<edm::ParameterSet>("skim", edm::ParameterSet()));
+        records_file = config.getUntrackedParameter<std::string>("recordsFile", "");
+
+        sparse_gen_deltaR = parseGenDeltaRMode(config.getUntrackedParameter<std::string>("genDeltaRMode", "dense"));
+        gen_deltaR_top_k = config.getUntrackedParameter<unsigned int>("genDeltaRTopK", 1);
+        if (gen_deltaR_top_k == 0)
+            throw edm::Exception(edm::errors::Configuration, "genDeltaRTopK must be at least 1");
+
+        tau_br_weight = parseTauBRCorrection(config.getUntrackedParameter<std::string>("tauBRCorrection", "reject"));
+        tau_br_seed = config.getUntrackedParameter<unsigned int>("tauBRSeed", 42);
+        fill_truth_for_all_events = config.getUntrackedParameter<bool>("fillTruthForAllEvents", false);
+        sample_type = parseSampleType(config.getUntrackedParameter<std::string>("sampleType", "all"));
+        sample_detection_events = config.getUntrackedParameter<unsigned int>("sampleDetectionEvents", 1000);
+        if (sample_type == SampleType::Auto && sample_detection_events == 0)
+            throw edm::Exception(edm::errors::Configuration, "sampleDetectionEvents must be at least 1 with sampleType = 'auto'");
+        max_jets_for_pairing = config.getUntrackedParameter<unsigned int>("maxJetsForPairing", 0);
+        if (max_jets_for_pairing == 1)
+            throw edm::Exception(edm::errors::Configuration, "maxJetsForPairing must be 0 (no cap) or at least 2");
+        dijet_rankings = {DijetRanking::cmva};
+        for (const std::string& name: config.getUntrackedParameter<std::vector<std::string>>("dijetRankings", {"cmva"})) {
+            DijetRanking::DijetRanking ranking = DijetRanking::parse(name);
+            if (std::find(dijet_rankings.begin(), dijet_rankings.end(), ranking) == dijet_rankings.end())
+                dijet_rankings.push_back(ranking);
+        }
+        max_dijets = config.getUntrackedParameter<unsigned int>("maxDijets", 1);
+        stage_timers = config.getUntrackedParameter<bool>("stageTimers", false);
+        memory_report = config.getUntrackedParameter<bool>("memoryReport", false);
+        capture_inputs = config.getUntrackedParameter<std::string>("captureInputs", "");
+        slow_events_file = config.getUntrackedParameter<std::string>("slowEventsFile", "");
+        slow_event_threshold_ns = config.getUntrackedParameter<double>("slowEventThreshold", 0) * 1e6;
+        slow_event_quantile = config.getUntrackedParameter<double>("slowEventQuantile", 0);
+        if (slow_event_quantile < 0 || slow_event_quantile >= 1)
+            throw edm::Exception(edm::errors::Configuration, "slowEventQuantile must be in [0, 1)");
+        if (!slow_events_file.empty() && slow_event_threshold_ns == 0 && slow_event_quantile == 0)
+            throw edm::Exception(edm::errors::Configuration, "slowEventsFile needs slowEventThreshold or slowEventQuantile");
+
+        trace_file = config.getUntrackedParameter<std::string>("traceFile", "");
+        trace_sampling = config.getUntrackedParameter<unsigned int>("traceSampling", 100);
+        trace_buffer_size = config.getUntrackedParameter<unsigned int>("traceBufferSize", 100000);
+        if (trace_sampling == 0)
+            throw edm::Exception(edm::errors::Configuration, "traceSampling must be at least 1");
+
+        const edm::ParameterSet& hlt_efficiencies_pset = config.getUntrackedParameter<edm::ParameterSet>("hlt_efficiencies");
+        std::vector<std::string> hlt_efficiencies_name = hlt_efficiencies_pset.getParameterNames();
+        for (const std::string& hlt_efficiency: hlt_efficiencies_name) {
+            std::cout << "    Registering new HLT efficiency: " << hlt_efficiency;
+            if (hlt_efficiencies_pset.existsAs<edm::FileInPath>(hlt_efficiency, false)) {
+                BinnedValuesJSONParser parser(hlt_efficiencies_pset.getUntrackedParameter<edm::FileInPath>(hlt_efficiency).fullPath());
+                hlt_efficiencies.emplace(hlt_efficiency, std::unique_ptr<BinnedValues>(new BinnedValues(std::move(parser.get_values()))));
+                std::cout << " -> non-weighted. " << std::endl;
+            } else {
+                const auto& parts = hlt_efficiencies_pset.getUntrackedParameter<std::vector<edm::ParameterSet>>(hlt_efficiency);
+                hlt_efficiencies.emplace(hlt_efficiency, std::unique_ptr<BinnedValues>(new WeightedBinnedValues(parts)));
+                std::cout << " -> weighted. " << std::endl;
+            }
+        }
+    }
+
+    std::vector<std::string> AnalyzerConfiguration::outputFiles() const {
+        std::vector<std::string> files;
+        for (const std::string& file: {histograms_file, cut_scan.file, skim.file, skim.enabled() ? skim.index_file : std::string(), records_file, capture_inputs, slow_events_file, trace_file}) {
+            if (!file.empty())
+                files.push_back(file);
+        }
+
+        return files;
+    }
+
+    bool AnalyzerConfiguration::parseGenDeltaRMode(const std::string& mode) {
+        if (mode == "sparse")
+            return true;
+        if (mode != "dense")
+            throw edm::Exception(edm::errors::Configuration, "Unknown genDeltaRMode '" + mode + "'. Valid values are 'dense' and 'sparse'");
+        return false;
+    }
+
+    OutputMode AnalyzerConfiguration::parseOutputMode(const std::string& mode) {
+        if (mode == "struct")
+            return OutputMode::Struct;
+        if (mode == "flat")
+            return OutputMode::Flat;
+        if (mode == "none")
+            return OutputMode::None;
+        throw edm::Exception(edm::errors::Configuration, "Unknown outputMode '" + mode + "'. Valid values are 'struct', 'flat' and 'none'");
+    }
+
+    bool AnalyzerConfiguration::parseTauBRCorrection(const std::string& mode) {
+        if (mode == "weight")
+            return true;
+        if (mode != "reject")
+            throw edm::Exception(edm::errors::Configuration, "Unknown tauBRCorrection '" + mode + "'. Valid values are 'reject' and 'weight'");
+        return false;
+    }
+
+    SampleType AnalyzerConfiguration::parseSampleType(const std::string& type) {
+        if (type == "auto")
+            return SampleType::Auto;
+        if (type == "all")
+            return SampleType::All;
+        if (type == "signal")
+            return SampleType::Signal;
+        if (type == "ttbar")
+            return SampleType::TTbar;
+        if (type == "background")
+            return SampleType::Background;
+        throw edm::Exception(edm::errors::Configuration, "Unknown sampleType '" + type + "'. Valid values are 'auto', 'all', 'signal', 'ttbar' and 'background'");
+    }
+}
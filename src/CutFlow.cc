@@ -0,0 +1,10 @@
+#include <cp3_llbb/HHAnalysis/interface/CutFlow.h>
+
+namespace HH {
+
+    const std::array<std::string, CutFlow::Count> CutFlow::names = {{
+        "has2leptons", "has2leptons_elel", "has2leptons_elmu", "has2leptons_muel", "has2leptons_mumu",
+        "has2leptons_1llmetjj", "has2leptons_elel_1llmetjj", "has2leptons_elmu_1llmetjj", "has2leptons_muel_1llmetjj", "has2leptons_mumu_1llmetjj",
+        "has2leptons_1llmetjj_2btagM", "has2leptons_elel_1llmetjj_2btagM", "has2leptons_elmu_1llmetjj_2btagM", "has2leptons_muel_1llmetjj_2btagM", "has2leptons_mumu_1llmetjj_2btagM"
+    }};
+}
@@ -0,0 +1,170 @@
+#include <cp3_llbb/HHAnalysis/interface/CutScan.h>
+
+#include <FWCore/ParameterSet/interface/ParameterSet.h>
+#include <FWCore/Utilities/interface/EDMException.h>
+
+#include <Math/VectorUtil.h>
+
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <mutex>
+#include <set>
+
+namespace {
+
+    const std::array<std::string, 4> s_flavours = {{ "elel", "elmu", "muel", "mumu" }};
+
+    std::vector<float> parseAxis(const edm::ParameterSet& config, const std::string& name, float default_value) {
+        std::vector<double> values = config.getUntrackedParameter<std::vector<double>>(name, {});
+        if (values.empty())
+            return {default_value};
+
+        if (values.size() > HH::CutScanGrid::MAX_AXIS_SIZE)
+            throw edm::Exception(edm::errors::Configuration, "cutScan." + name + " has more than " + std::to_string(HH::CutScanGrid::MAX_AXIS_SIZE) + " values");
+
+        return std::vector<float>(values.begin(), values.end());
+    }
+
+    // Bit i is set when `value` passes cuts[i]
+    template <typename Pass> uint64_t passMask(const std::vector<float>& cuts, Pass pass) {
+        uint64_t mask = 0;
+        for (size_t i = 0; i < cuts.size(); i++) {
+            if (pass(cuts[i]))
+                mask |= uint64_t(1) << i;
+        }
+        return mask;
+    }
+}
+
+namespace HH {
+
+    CutScanGrid::CutScanGrid(const edm::ParameterSet& config, float min_dr_l_j_cut, float b_discr_cut) {
+        leading_lepton_pt = parseAxis(config, "leadingLeptonPtCuts", 0);
+        subleading_lepton_pt = parseAxis(config, "subleadingLeptonPtCuts", 0);
+        min_dr_l_j = parseAxis(config, "minDRLJCuts", min_dr_l_j_cut);
+        b_discr = parseAxis(config, "bDiscrCuts", b_discr_cut);
+        file = config.getUntrackedParameter<std::string>("file", "");
+
+        for (const char* axis: {"leadingLeptonPtCuts", "subleadingLeptonPtCuts", "minDRLJCuts", "bDiscrCuts"}) {
+            if (file.empty() && config.existsAs<std::vector<double>>(axis, false))
+                throw edm::Exception(edm::errors::Configuration, "cutScan needs a file");
+        }
+    }
+
+    CutScanYields::CutScanYields(const CutScanGrid& grid):
+        m_grid(&grid) {
+        size_t size = s_flavours.size() * grid.points();
+        m_sumw.resize(size);
+        m_sumw2.resize(size);
+        m_entries.resize(size);
+    }
+
+    size_t CutScanYields::index(size_t category, size_t ilead, size_t isublead, size_t idr, size_t ib) const {
+        return (((category * m_grid->leading_lepton_pt.size() + ilead) * m_grid->subleading_lepton_pt.size() + isublead)
+                * m_grid->min_dr_l_j.size() + idr) * m_grid->b_discr.size() + ib;
+    }
+
+    void CutScanYields::fill(size_t category, const Lepton& lep1, const Lepton& lep2, const std::vector<Lepton>& leptons,
+            const std::vector<Jet>& jets, size_t n_pairing_jets, const std::vector<float>& b_discr, float weight) {
+        const size_t n_dr = m_grid->min_dr_l_j.size();
+        const size_t n_b = m_grid->b_discr.size();
+
+        m_jet_counts.assign(n_dr * n_b, 0);
+        bool any = false;
+        for (size_t ijet = 0; ijet < n_pairing_jets; ijet++) {
+            const Jet& jet = jets[ijet];
+
+            float min_dr = std::numeric_limits<float>::max();
+            for (const Lepton& lepton: leptons)
+                min_dr = std::min<float>(min_dr, ROOT::Math::VectorUtil::DeltaR(jet.p4, lepton.p4));
+            float discr = b_discr[jet.idx];
+
+            // Same conventions as the analyzer: jets closer than the cut are removed, b-tagging is a strict inequality
+            uint64_t dr_mask = passMask(m_grid->min_dr_l_j, [min_dr](float cut) { return !(min_dr < cut); });
+            uint64_t b_mask = passMask(m_grid->b_discr, [discr](float cut) { return discr > cut; });
+            if (!dr_mask || !b_mask)
+                continue;
+
+            for (size_t idr = 0; idr < n_dr; idr++) {
+                if (!(dr_mask >> idr & 1))
+                    continue;
+                for (size_t ib = 0; ib < n_b; ib++)
+                    m_jet_counts[idr * n_b + ib] += b_mask >> ib & 1;
+            }
+            any = true;
+        }
+
+        if (!any)
+            return;
+
+        float lead_pt = std::max(lep1.p4.Pt(), lep2.p4.Pt());
+        float sublead_pt = std::min(lep1.p4.Pt(), lep2.p4.Pt());
+        uint64_t lead_mask = passMask(m_grid->leading_lepton_pt, [lead_pt](float cut) { return !(lead_pt < cut); });
+        uint64_t sublead_mask = passMask(m_grid->subleading_lepton_pt, [sublead_pt](float cut) { return !(sublead_pt < cut); });
+
+        for (size_t ilead = 0; ilead < m_grid->leading_lepton_pt.size(); ilead++) {
+            if (!(lead_mask >> ilead & 1))
+                continue;
+            for (size_t isublead = 0; isublead < m_grid->subleading_lepton_pt.size(); isublead++) {
+                if (!(sublead_mask >> isublead & 1))
+                    continue;
+                for (size_t idr = 0; idr < n_dr; idr++) {
+                    for (size_t ib = 0; ib < n_b; ib++) {
+                        if (m_jet_counts[idr * n_b + ib] < 2)
+                            continue;
+                        size_t i = index(category, ilead, isublead, idr, ib);
+                        m_sumw[i] += weight;
+                        m_sumw2[i] += double(weight) * weight;
+                        m_entries[i]++;
+                    }
+                }
+            }
+        }
+    }
+
+    CutScanYields& CutScanYields::operator+=(const CutScanYields& other) {
+        for (size_t i = 0; i < m_sumw.size(); i++) {
+            m_sumw[i] += other.m_sumw[i];
+            m_sumw2[i] += other.m_sumw2[i];
+            m_entries[i] += other.m_entries[i];
+        }
+
+        return *this;
+    }
+
+    void CutScanYields::write(const std::string& path, const std::string& analyzer) const {
+        static std::mutex mutex;
+        static std::set<std::string> created;
+
+        std::lock_guard<std::mutex> lock(mutex);
+
+        bool first = created.insert(path).second;
+        std::ofstream out(path, first ? std::ios::trunc : std::ios::app);
+        if (!out)
+            throw edm::Exception(edm::errors::Configuration, "Cannot write the cut scan yields to '" + path + "'");
+
+        if (first)
+            out << "analyzer\tflavour\tleadingLeptonPt\tsubleadingLeptonPt\tminDRLJ\tbDiscr\tsumw\tsumw2\tentries\n";
+
+        for (size_t category = 0; category < s_flavours.size(); category++) {
+            for (size_t ilead = 0; ilead < m_grid->leading_lepton_pt.size(); ilead++) {
+                for (size_t isublead = 0; isublead < m_grid->subleading_lepton_pt.size(); isublead++) {
+                    for (size_t idr = 0; idr < m_grid->min_dr_l_j.size(); idr++) {
+                        for (size_t ib = 0; ib < m_grid->b_discr.size(); ib++) {
+                            size_t i = index(category, ilead, isublead, idr, ib);
+                            out << analyzer << '\t' << s_flavours[category]
+                                << '\t' << m_grid->leading_lepton_pt[ilead] << '\t' << m_grid->subleading_lepton_pt[isublead]
+                                << '\t' << m_grid->min_dr_l_j[idr] << '\t' << m_grid->b_discr[ib]
+                                << '\t' << m_sumw[i] << '\t' << m_sumw2[i] << '\t' << m_entries[i] << '\n';
+                        }
+                    }
+                }
+            }
+        }
+
+        std::cout << "Cut scan of " << analyzer << " (" << m_grid->points() << " points) written to '" << path << "'" << std::endl;
+    }
+}
@@ -0,0 +1,97 @@
+#include <cp3_llbb/HHAnalysis/interface/Dijets.h>
+
+#include <FWCore/Utilities/interface/EDMException.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+    // Higher is better
+    float score(HH::DijetRanking::DijetRanking ranking, const HH::Jet& jet1, const HH::Jet& jet2, const HH::LorentzVector& p4) {
+        switch (ranking) {
+            case HH::DijetRanking::ht:
+                return jet1.p4.Pt() + jet2.p4.Pt();
+            case HH::DijetRanking::mh:
+                return -std::abs(p4.M() - 125.f);
+            case HH::DijetRanking::pt:
+                return p4.Pt();
+            case HH::DijetRanking::csv:
+                return jet1.CSV + jet2.CSV;
+            case HH::DijetRanking::cmva:
+                return jet1.CMVAv2 + jet2.CMVAv2;
+            case HH::DijetRanking::ptOverM:
+                return p4.Pt() / p4.M();
+            case HH::DijetRanking::Count:
+                break;
+        }
+
+        return 0;
+    }
+
+    // Only the orderings on the pair four-vector need the sum
+    bool needsP4(HH::DijetRanking::DijetRanking ranking) {
+        return ranking == HH::DijetRanking::mh || ranking == HH::DijetRanking::pt || ranking == HH::DijetRanking::ptOverM;
+    }
+
+    // Best first; the first pair of the loop wins a tie
+    bool better(const HH::DijetRanker::Pair& a, const HH::DijetRanker::Pair& b) {
+        if (a.score != b.score)
+            return a.score > b.score;
+        return a.order < b.order;
+    }
+}
+
+namespace HH {
+
+    namespace DijetRanking {
+        DijetRanking parse(const std::string& name) {
+            auto it = std::find(names.begin(), names.end(), name);
+            if (it == names.end())
+                throw edm::Exception(edm::errors::Configuration, "Unknown jet pair ranking '" + name + "'. Valid values are 'ht', 'mh', 'pt', 'csv', 'cmva' and 'ptOverM'");
+            return static_cast<DijetRanking>(it - names.begin());
+        }
+    }
+
+    void DijetRanker::rank(const std::vector<Jet>& jets, size_t n_jets, const std::vector<DijetRanking::DijetRanking>& rankings, size_t k) {
+        m_best.resize(rankings.size());
+        for (auto& best: m_best)
+            best.clear();
+
+        bool needs_p4 = std::any_of(rankings.begin(), rankings.end(), needsP4);
+
+        // Each heap has its worst pair on top (`better` is its "less than"), so that it is the one replaced
+        uint32_t order = 0;
+        LorentzVector p4;
+        for (uint32_t ijet1 = 0; ijet1 < n_jets; ijet1++) {
+            for (uint32_t ijet2 = ijet1 + 1; ijet2 < n_jets; ijet2++, order++) {
+                if (needs_p4)
+                    p4 = jets[ijet1].p4 + jets[ijet2].p4;
+
+                for (size_t i = 0; i < rankings.size(); i++) {
+                    std::vector<Pair>& heap = m_best[i];
+                    // A NaN score (ptOverM of a massless pair, ...) would break the ordering `better` needs: rank them last
+                    float value = score(rankings[i], jets[ijet1], jets[ijet2], p4);
+                    if (!std::isfinite(value))
+                        value = -std::numeric_limits<float>::infinity();
+                    Pair pair = {ijet1, ijet2, value, order};
+                    if (k == 0) {
+                        heap.push_back(pair);
+                    } else if (heap.size() < k) {
+                        heap.push_back(pair);
+                        std::push_heap(heap.begin(), heap.end(), better);
+                    } else if (better(pair, heap.front())) {
+                        std::pop_heap(heap.begin(), heap.end(), better);
+                        heap.back() = pair;
+                        std::push_heap(heap.begin(), heap.end(), better);
+                    }
+                }
+            }
+        }
+        m_pairs = order;
+
+        for (auto& best: m_best)
+            std::sort(best.begin(), best.end(), better);
+    }
+}
@@ -0,0 +1,66 @@
+#include <cp3_llbb/HHAnalysis/interface/Dileptons.h>
+
+#include <algorithm>
+
+namespace HH {
+
+    void DileptonCandidates::build(const std::vector<Lepton>& leptons, float leading_electron_pt_cut, float leading_muon_pt_cut) {
+        auto passes_leading_cut = [&](size_t i) {
+            return !(leptons[i].p4.Pt() < (leptons[i].isMu ? leading_muon_pt_cut : leading_electron_pt_cut));
+        };
+
+        for (auto& partition: m_partitions)
+            partition.clear();
+        for (size_t i = 0; i < leptons.size(); i++) {
+            const Lepton& lepton = leptons[i];
+            if (lepton.charge == 0)
+                continue;
+            if (lepton.isMu)
+                m_partitions[lepton.charge > 0 ? MuPlus : MuMinus].push_back(i);
+            else
+                m_partitions[lepton.charge > 0 ? ElPlus : ElMinus].push_back(i);
+        }
+
+        m_candidates.clear();
+        auto add_pairs = [&](Partition plus, Partition minus) {
+            for (uint32_t a: m_partitions[plus]) {
+                for (uint32_t b: m_partitions[minus]) {
+                    uint32_t ilep1 = std::min(a, b);
+                    uint32_t ilep2 = std::max(a, b);
+                    if (!passes_leading_cut(ilep1))
+                        continue;
+                    // Same expression as Dilepton::ht_l_l
+                    m_candidates.push_back({ilep1, ilep2, leptons[ilep1].p4.Pt() + leptons[ilep2].p4.Pt(), 0});
+                }
+            }
+        };
+        add_pairs(ElPlus, ElMinus);
+        add_pairs(MuPlus, MuMinus);
+        add_pairs(ElPlus, MuMinus);
+        add_pairs(MuPlus, ElMinus);
+
+        // Ties are broken by the position in the pair loop, so that the ranking does not depend on the partitioning
+        std::sort(m_candidates.begin(), m_candidates.end(), [](const DileptonCandidate& a, const DileptonCandidate& b) {
+            if (a.ht != b.ht)
+                return a.ht > b.ht;
+            return std::make_pair(a.ilep1, a.ilep2) < std::make_pair(b.ilep1, b.ilep2);
+        });
+
+        // Same-sign pairs are only indices: the HLT matching of a lepton depends on all the pairs matched before
+        m_order.clear();
+        for (uint32_t ilep1 = 0; ilep1 < leptons.size(); ilep1++) {
+            if (!passes_leading_cut(ilep1))
+                continue;
+            for (uint32_t ilep2 = ilep1 + 1; ilep2 < leptons.size(); ilep2++)
+                m_order.push_back({ilep1, ilep2, -1});
+        }
+        for (size_t i = 0; i < m_candidates.size(); i++) {
+            // Position of (ilep1, ilep2) in the loop: pairs of the harder leading leptons come first
+            DileptonCandidate& candidate = m_candidates[i];
+            auto it = std::lower_bound(m_order.begin(), m_order.end(), std::make_pair(candidate.ilep1, candidate.ilep2),
+                    [](const Pair& pair, const std::pair<uint32_t, uint32_t>& value) { return std::make_pair(pair.ilep1, pair.ilep2) < value; });
+            candidate.order = it - m_order.begin();
+            it->candidate = i;
+        }
+    }
+}
@@ -0,0 +1,152 @@
+#include <cp3_llbb/HHAnalysis/interface/EventRecords.h>
+
+#include <FWCore/Utilities/interface/EDMException.h>
+
+#include <cstring>
+#include <iostream>
+#include <map>
+
+namespace {
+
+    bool isLittleEndian() {
+        uint32_t mark = HH::EventRecordFormat::BYTE_ORDER_MARK;
+        unsigned char first;
+        std::memcpy(&first, &mark, 1);
+        return first == 0x04;
+    }
+
+#define HH_RECORD_FILL(TYPE, NAME, GETTER) record.NAME = static_cast<TYPE>(GETTER);
+
+    HH::LeptonRecord makeRecord(const HH::Lepton& o) {
+        HH::LeptonRecord record;
+        HH_LEPTON_RECORD_FIELDS(HH_RECORD_FILL)
+        return record;
+    }
+
+    HH::JetRecord makeRecord(const HH::Jet& o) {
+        HH::JetRecord record;
+        HH_JET_RECORD_FIELDS(HH_RECORD_FILL)
+        return record;
+    }
+
+    HH::MetRecord makeRecord(const HH::Met& o) {
+        HH::MetRecord record;
+        HH_MET_RECORD_FIELDS(HH_RECORD_FILL)
+        return record;
+    }
+
+    HH::CandidateRecord makeRecord(const HH::DileptonMetDijet& o) {
+        HH::CandidateRecord record;
+        HH_CANDIDATE_RECORD_FIELDS(HH_RECORD_FILL)
+        return record;
+    }
+
+#undef HH_RECORD_FILL
+}
+
+namespace HH {
+
+    std::shared_ptr<EventRecordWriter> EventRecordWriter::get(const std::string& path) {
+        static std::mutex mutex;
+        static std::map<std::string, std::weak_ptr<EventRecordWriter>> writers;
+
+        std::lock_guard<std::mutex> lock(mutex);
+
+        std::weak_ptr<EventRecordWriter>& entry = writers[path];
+        std::shared_ptr<EventRecordWriter> result = entry.lock();
+        if (!result) {
+            result = std::make_shared<EventRecordWriter>(path);
+            entry = result;
+        }
+
+        return result;
+    }
+
+    EventRecordWriter::EventRecordWriter(const std::string& path):
+        m_path(path), m_file(path, std::ios::binary | std::ios::trunc) {
+        if (!isLittleEndian())
+            throw edm::Exception(edm::errors::Configuration, "recordsFile is only supported on little-endian machines");
+        if (!m_file)
+            throw edm::Exception(edm::errors::Configuration, "Cannot create the records file '" + path + "'");
+
+        const std::string schema = EventRecordFormat::schema();
+        m_file.write(EventRecordFormat::MAGIC, sizeof(EventRecordFormat::MAGIC));
+        writeValue(EventRecordFormat::VERSION);
+        writeValue(EventRecordFormat::BYTE_ORDER_MARK);
+        writeValue(static_cast<uint32_t>(schema.size()));
+        m_file.write(schema.data(), schema.size());
+        m_offset = sizeof(EventRecordFormat::MAGIC) + 3 * sizeof(uint32_t) + schema.size();
+        writePadding();
+    }
+
+    EventRecordWriter::~EventRecordWriter() {
+        uint64_t trailer = m_offset;
+        writeValue(static_cast<uint32_t>(m_analyzers.size()));
+        m_offset += sizeof(uint32_t);
+        for (const std::string& name: m_analyzers) {
+            writeValue(static_cast<uint32_t>(name.size()));
+            m_file.write(name.data(), name.size());
+            m_offset += sizeof(uint32_t) + name.size();
+        }
+        writePadding();
+
+        m_file.write(reinterpret_cast<const char*>(m_events.data()), m_events.size() * sizeof(uint64_t));
+        writeValue(trailer);
+        writeValue(static_cast<uint64_t>(m_events.size()));
+        m_file.write(EventRecordFormat::TRAILER_MAGIC, sizeof(EventRecordFormat::TRAILER_MAGIC));
+        m_file.close();
+
+        // No exception from a destructor: report and carry on
+        if (!m_file)
+            std::cout << "Error: the records file '" << m_path << "' could not be written completely" << std::endl;
+        else
+            std::cout << m_events.size() << " events written to the records file '" << m_path << "'" << std::endl;
+    }
+
+    uint32_t EventRecordWriter::addAnalyzer(const std::string& name) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        m_analyzers.push_back(name);
+        return m_analyzers.size() - 1;
+    }
+
+    void EventRecordWriter::write(uint32_t analyzer, uint32_t run, uint32_t lumi, uint64_t event, float weight,
+            const std::vector<Lepton>& leptons, const std::vector<Jet>& jets, const std::vector<Met>& met, const std::vector<DileptonMetDijet>& llmetjj) {
+        EventRecord header;
+        std::memset(&header, 0, sizeof(header));
+        header.analyzer = analyzer;
+        header.run = run;
+        header.lumi = lumi;
+        header.event = event;
+        header.weight = weight;
+        header.n_leptons = leptons.size();
+        header.n_jets = jets.size();
+        header.n_met = met.size();
+        header.n_llmetjj = llmetjj.size();
+        size_t size = sizeof(EventRecord) + leptons.size() * sizeof(LeptonRecord) + jets.size() * sizeof(JetRecord)
+            + met.size() * sizeof(MetRecord) + llmetjj.size() * sizeof(CandidateRecord);
+        header.size = size + EventRecordFormat::padding(size, 8);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        m_events.push_back(m_offset);
+        writeValue(header);
+        for (const Lepton& lepton: leptons)
+            writeValue(makeRecord(lepton));
+        for (const Jet& jet: jets)
+            writeValue(makeRecord(jet));
+        for (const Met& m: met)
+            writeValue(makeRecord(m));
+        for (const DileptonMetDijet& candidate: llmetjj)
+            writeValue(makeRecord(candidate));
+        m_offset += size;
+        writePadding();
+    }
+
+    void EventRecordWriter::writePadding() {
+        static const char zeros[8] = {0};
+        size_t padding = EventRecordFormat::padding(m_offset, 8);
+        m_file.write(zeros, padding);
+        m_offset += padding;
+    }
+}
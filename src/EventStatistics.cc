@@ -0,0 +1,91 @@
+#include <cp3_llbb/HHAnalysis/interface/EventStatistics.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+
+namespace HH {
+
+    CountHistogram& CountHistogram::operator+=(const CountHistogram& other) {
+        for (size_t i = 0; i < N_BINS; i++)
+            m_bins[i] += other.m_bins[i];
+        m_count += other.m_count;
+        m_sum += other.m_sum;
+        if (other.m_max > m_max)
+            m_max = other.m_max;
+
+        return *this;
+    }
+
+    uint64_t CountHistogram::quantile(double q) const {
+        if (m_count == 0)
+            return 0;
+
+        uint64_t rank = std::max<uint64_t>(1, std::ceil(q * m_count));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < N_BINS - 1; i++) {
+            seen += m_bins[i];
+            if (seen >= rank)
+                return i;
+        }
+
+        return m_max;
+    }
+
+    const std::array<std::string, EventStatistics::Count> EventStatistics::names = {{ "leptons", "jets", "ll", "jj", "llmetjj" }};
+
+    EventStatistics& EventStatistics::operator+=(const EventStatistics& other) {
+        for (size_t i = 0; i < Count; i++)
+            multiplicities[i] += other.multiplicities[i];
+        time += other.time;
+        capped_events += other.capped_events;
+        slow_events += other.slow_events;
+        truth_skipped_events += other.truth_skipped_events;
+
+        return *this;
+    }
+
+    void EventStatistics::report(std::ostream& out) const {
+        out << std::left << std::setw(24) << "Multiplicity" << std::right
+            << std::setw(12) << "mean"
+            << std::setw(12) << "p50"
+            << std::setw(12) << "p99"
+            << std::setw(12) << "max" << std::endl;
+
+        out << std::fixed << std::setprecision(2);
+        for (size_t i = 0; i < Count; i++) {
+            const CountHistogram& multiplicity = multiplicities[i];
+            out << std::left << std::setw(24) << names[i] << std::right
+                << std::setw(12) << multiplicity.mean()
+                << std::setw(12) << multiplicity.quantile(0.5)
+                << std::setw(12) << multiplicity.quantile(0.99)
+                << std::setw(12) << multiplicity.max() << std::endl;
+        }
+        out << std::left << std::setw(24) << "time / event [us]" << std::right
+            << std::setw(12) << time.mean() / 1000.
+            << std::setw(12) << time.quantile(0.5) / 1000.
+            << std::setw(12) << time.quantile(0.99) / 1000.
+            << std::setw(12) << time.max() / 1000. << std::endl;
+        out << std::defaultfloat;
+
+        out << "Events with capped jet pairing: " << capped_events << " / " << time.count() << std::endl;
+        out << "Slow events captured: " << slow_events << std::endl;
+        out << "Events with gen truth skipped: " << truth_skipped_events << " / " << time.count() << std::endl;
+    }
+
+    bool SlowEventSelector::isSlow(const EventStatistics& statistics) {
+        if (m_threshold && statistics.last_time > m_threshold)
+            return true;
+
+        if (m_quantile == 0 || statistics.time.count() < WARMUP_EVENTS)
+            return false;
+
+        if (m_quantile_threshold == 0 || ++m_events_since_refresh >= REFRESH_EVENTS) {
+            // Upper edge of the bin: only events certainly above the quantile are selected
+            m_quantile_threshold = statistics.time.quantile(m_quantile) * 9 / 8 + 1;
+            m_events_since_refresh = 0;
+        }
+
+        return statistics.last_time > m_quantile_threshold;
+    }
+}
@@ -0,0 +1,255 @@
+#include <cp3_llbb/HHAnalysis/interface/FlatOutput.h>
+
+#include <FWCore/ParameterSet/interface/ParameterSet.h>
+#include <FWCore/Utilities/interface/EDMException.h>
+
+#include <cstring>
+#include <iomanip>
+
+namespace {
+    bool match_any(const std::vector<std::string>& patterns, const std::string& name) {
+        for (const auto& pattern: patterns) {
+            if (HH::wildcardMatch(pattern, name))
+                return true;
+        }
+        return false;
+    }
+
+    // llmetjj four-vectors which are copies, or sums, of the four-vectors of the objects referenced by ilep1, ilep2, ijet1, ijet2 and imet
+    const std::vector<std::string> s_redundant_llmetjj_columns = {
+        "llmetjj_ll_*", "llmetjj_jj_*", "llmetjj_lljj_*",
+        "llmetjj_gen_lep1_*", "llmetjj_gen_lep2_*", "llmetjj_gen_jet1_*", "llmetjj_gen_jet2_*", "llmetjj_gen_met_*",
+        "llmetjj_gen_ll_*", "llmetjj_gen_jj_*", "llmetjj_gen_lljj_*"
+    };
+}
+
+namespace HH {
+
+    namespace {
+        bool wildcard_match(const char* pattern, const char* str) {
+            if (*pattern == '\0')
+                return *str == '\0';
+            if (*pattern == '*')
+                return wildcard_match(pattern + 1, str) || (*str != '\0' && wildcard_match(pattern, str + 1));
+            return *str == *pattern && wildcard_match(pattern + 1, str + 1);
+        }
+    }
+
+    bool wildcardMatch(const std::string& pattern, const std::string& name) {
+        return wildcard_match(pattern.c_str(), name.c_str());
+    }
+
+    float reduceMantissa(float value, unsigned int bits) {
+        if (bits >= 23)
+            return value;
+
+        uint32_t i;
+        std::memcpy(&i, &value, sizeof(i));
+
+        // Round to nearest, unless the value is already Inf or NaN
+        uint32_t shift = 23 - bits;
+        if ((i & 0x7f800000) != 0x7f800000)
+            i += 1u << (shift - 1);
+        i &= ~((1u << shift) - 1);
+
+        std::memcpy(&value, &i, sizeof(i));
+        return value;
+    }
+
+    OutputPolicy::OutputPolicy(const edm::ParameterSet& config) {
+        drop = config.getUntrackedParameter<std::vector<std::string>>("drop", {});
+        deduplicate = config.getUntrackedParameter<bool>("deduplicate", false);
+        reducedPrecision = config.getUntrackedParameter<std::vector<std::string>>("reducedPrecision", {});
+        mantissaBits = config.getUntrackedParameter<unsigned int>("mantissaBits", 10);
+        fixedPointAngles = config.getUntrackedParameter<bool>("fixedPointAngles", false);
+
+        if (mantissaBits < 1 || mantissaBits > 23)
+            throw edm::Exception(edm::errors::Configuration, "outputPolicy.mantissaBits must be between 1 and 23");
+    }
+
+    bool OutputPolicy::isDefault() const {
+        return drop.empty() && !deduplicate && reducedPrecision.empty() && !fixedPointAngles;
+    }
+
+    bool OutputPolicy::isDropped(const std::string& column) const {
+        return match_any(drop, column) || (deduplicate && match_any(s_redundant_llmetjj_columns, column));
+    }
+
+    bool OutputPolicy::isReducedPrecision(const std::string& column) const {
+        return match_any(reducedPrecision, column);
+    }
+
+    FlatOutput::FlatOutput(ROOT::TreeGroup& tree, const OutputPolicy& policy):
+        m_policy(policy),
+        m_leptons(tree, "leptons", m_policy), m_jets(tree, "jets", m_policy), m_met(tree, "met", m_policy), m_llmetjj(tree, "llmetjj", m_policy) {
+
+        // Transient members (see src/classes_def.xml) are not written
+        m_leptons
+            .p4("", &Lepton::p4)
+            .p4("gen", &Lepton::gen_p4)
+            .column("charge", &Lepton::charge)
+            .column("idx", &Lepton::idx)
+            .column("hlt_idx", &Lepton::hlt_idx)
+            .column("hlt_DR_matchedObject", &Lepton::hlt_DR_matchedObject)
+            .column("hlt_DPtOverPt_matchedObject", &Lepton::hlt_DPtOverPt_matchedObject)
+            .column("hlt_leg1", &Lepton::hlt_leg1)
+            .column("hlt_leg2", &Lepton::hlt_leg2)
+            .column("isMu", &Lepton::isMu)
+            .column("isEl", &Lepton::isEl)
+            .column("ele_hlt_id", &Lepton::ele_hlt_id)
+            .column("gen_matched", &Lepton::gen_matched)
+            .column("gen_DR", &Lepton::gen_DR)
+            .column("gen_DPtOverPt", &Lepton::gen_DPtOverPt);
+
+        m_jets
+            .p4("", &Jet::p4)
+            .p4("gen", &Jet::gen_p4)
+            .column("idx", &Jet::idx)
+            .column("btag_M", &Jet::btag_M)
+            .column("CSV", &Jet::CSV)
+            .column("CMVAv2", &Jet::CMVAv2)
+            .column("gen_matched_bParton", &Jet::gen_matched_bParton)
+            .column("gen_matched_bHadron", &Jet::gen_matched_bHadron)
+            .column("gen_matched", &Jet::gen_matched)
+            .column("gen_DR", &Jet::gen_DR)
+            .column("gen_DPtOverPt", &Jet::gen_DPtOverPt)
+            .column("gen_b", &Jet::gen_b)
+            .column("gen_c", &Jet::gen_c)
+            .column("gen_l", &Jet::gen_l);
+
+        m_met
+            .p4("", &Met::p4)
+            .p4("gen", &Met::gen_p4)
+            .column("isNoHF", &Met::isNoHF)
+            .column("gen_matched", &Met::gen_matched)
+            .column("gen_DR", &Met::gen_DR)
+            .column("gen_DPhi", &Met::gen_DPhi)
+            .column("gen_DPtOverPt", &Met::gen_DPtOverPt);
+
+        // Only the members actually filled for a llmetjj candidate: the shadowed p4 and gen
+        // information of the base classes are never set and thus not written
+        m_llmetjj
+            .p4("", &DileptonMetDijet::p4)
+            .p4("ll", &DileptonMetDijet::ll_p4)
+            .p4("jj", &DileptonMetDijet::jj_p4)
+            .p4("lljj", &DileptonMetDijet::lljj_p4)
+            .p4("gen", &DileptonMetDijet::gen_p4)
+            .p4("gen_lep1", &DileptonMetDijet::gen_lep1_p4)
+            .p4("gen_lep2", &DileptonMetDijet::gen_lep2_p4)
+            .p4("gen_jet1", &DileptonMetDijet::gen_jet1_p4)
+            .p4("gen_jet2", &DileptonMetDijet::gen_jet2_p4)
+            .p4("gen_met", &DileptonMetDijet::gen_met_p4)
+            .p4("gen_ll", &DileptonMetDijet::gen_ll_p4)
+            .p4("gen_jj", &DileptonMetDijet::gen_jj_p4)
+            .p4("gen_lljj", &DileptonMetDijet::gen_lljj_p4)
+            // Dilepton
+            .column("ilep1", &DileptonMetDijet::ilep1)
+            .column("ilep2", &DileptonMetDijet::ilep2)
+            .column("isOS", &DileptonMetDijet::isOS)
+            .column("isPlusMinus", &DileptonMetDijet::isPlusMinus)
+            .column("isMinusPlus", &DileptonMetDijet::isMinusPlus)
+            .column("isMuMu", &DileptonMetDijet::isMuMu)
+            .column("isElEl", &DileptonMetDijet::isElEl)
+            .column("isElMu", &DileptonMetDijet::isElMu)
+            .column("isMuEl", &DileptonMetDijet::isMuEl)
+            .column("isSF", &DileptonMetDijet::isSF)
+            .column("DR_l_l", &DileptonMetDijet::DR_l_l)
+            .column("DPhi_l_l", &DileptonMetDijet::DPhi_l_l)
+            .column("ht_l_l", &DileptonMetDijet::ht_l_l)
+            .column("trigger_efficiency", &DileptonMetDijet::trigger_efficiency)
+            .column("trigger_efficiency_downVariated", &DileptonMetDijet::trigger_efficiency_downVariated)
+            .column("trigger_efficiency_upVariated", &DileptonMetDijet::trigger_efficiency_upVariated)
+            // Met & DileptonMet
+            .column("isNoHF", &DileptonMetDijet::isNoHF)
+            .column("imet", &DileptonMetDijet::imet)
+            .column("DPhi_ll_met", &DileptonMetDijet::DPhi_ll_met)
+            .column("minDPhi_l_met", &DileptonMetDijet::minDPhi_l_met)
+            .column("maxDPhi_l_met", &DileptonMetDijet::maxDPhi_l_met)
+            .column("MT", &DileptonMetDijet::MT)
+            .column("MT_formula", &DileptonMetDijet::MT_formula)
+            .column("projectedMet", &DileptonMetDijet::projectedMet)
+            // Dijet
+            .column("ijet1", &DileptonMetDijet::ijet1)
+            .column("ijet2", &DileptonMetDijet::ijet2)
+            .column("btag_MM", &DileptonMetDijet::btag_MM)
+            .column("sumCSV", &DileptonMetDijet::sumCSV)
+            .column("sumCMVAv2", &DileptonMetDijet::sumCMVAv2)
+            .column("DR_j_j", &DileptonMetDijet::DR_j_j)
+            .column("DPhi_j_j", &DileptonMetDijet::DPhi_j_j)
+            .column("ht_j_j", &DileptonMetDijet::ht_j_j)
+            .column("gen_matched_bbPartons", &DileptonMetDijet::gen_matched_bbPartons)
+            .column("gen_matched_bbHadrons", &DileptonMetDijet::gen_matched_bbHadrons)
+            .column("gen_bb", &DileptonMetDijet::gen_bb)
+            .column("gen_bc", &DileptonMetDijet::gen_bc)
+            .column("gen_bl", &DileptonMetDijet::gen_bl)
+            .column("gen_cc", &DileptonMetDijet::gen_cc)
+            .column("gen_cl", &DileptonMetDijet::gen_cl)
+            .column("gen_ll", &DileptonMetDijet::gen_ll)
+            // DileptonMetDijet
+            .column("DPhi_jj_met", &DileptonMetDijet::DPhi_jj_met)
+            .column("minDPhi_j_met", &DileptonMetDijet::minDPhi_j_met)
+            .column("maxDPhi_j_met", &DileptonMetDijet::maxDPhi_j_met)
+            .column("maxDR_l_j", &DileptonMetDijet::maxDR_l_j)
+            .column("minDR_l_j", &DileptonMetDijet::minDR_l_j)
+            .column("DR_ll_jj", &DileptonMetDijet::DR_ll_jj)
+            .column("DPhi_ll_jj", &DileptonMetDijet::DPhi_ll_jj)
+            .column("DR_llmet_jj", &DileptonMetDijet::DR_llmet_jj)
+            .column("DPhi_llmet_jj", &DileptonMetDijet::DPhi_llmet_jj)
+            .column("cosThetaStar_CS", &DileptonMetDijet::cosThetaStar_CS)
+            .column("MT_fullsystem", &DileptonMetDijet::MT_fullsystem)
+            .column("gen_matched", &DileptonMetDijet::gen_matched)
+            .column("gen_DR", &DileptonMetDijet::gen_DR)
+            .column("gen_DPhi", &DileptonMetDijet::gen_DPhi)
+            .column("gen_DPtOverPt", &DileptonMetDijet::gen_DPtOverPt)
+            .column<float>("melaAngles_theta1", [](const DileptonMetDijet& c) { return c.melaAngles.theta1; })
+            .column<float>("melaAngles_theta2", [](const DileptonMetDijet& c) { return c.melaAngles.theta2; })
+            .column<float>("melaAngles_thetaStar", [](const DileptonMetDijet& c) { return c.melaAngles.thetaStar; })
+            .column<float>("melaAngles_phi", [](const DileptonMetDijet& c) { return c.melaAngles.phi; })
+            .column<float>("melaAngles_psi", [](const DileptonMetDijet& c) { return c.melaAngles.psi; })
+            .column<float>("visMelaAngles_theta1", [](const DileptonMetDijet& c) { return c.visMelaAngles.theta1; })
+            .column<float>("visMelaAngles_theta2", [](const DileptonMetDijet& c) { return c.visMelaAngles.theta2; })
+            .column<float>("visMelaAngles_thetaStar", [](const DileptonMetDijet& c) { return c.visMelaAngles.thetaStar; })
+            .column<float>("visMelaAngles_phi", [](const DileptonMetDijet& c) { return c.visMelaAngles.phi; })
+            .column<float>("visMelaAngles_psi", [](const DileptonMetDijet& c) { return c.visMelaAngles.psi; })
+            .column("MT2", &DileptonMetDijet::MT2);
+    }
+
+    void FlatOutput::fill(const std::vector<Lepton>& leptons, const std::vector<Jet>& jets, const std::vector<Met>& met, const std::vector<DileptonMetDijet>& llmetjj) const {
+        m_leptons.fill(leptons);
+        m_jets.fill(jets);
+        m_met.fill(met);
+        m_llmetjj.fill(llmetjj);
+    }
+
+    uint64_t FlatOutput::bytesBefore() const {
+        uint64_t bytes = 0;
+        forEachColumn([&bytes](const ColumnStats& stats) { bytes += stats.bytes_before; });
+        return bytes;
+    }
+
+    uint64_t FlatOutput::bytesAfter() const {
+        uint64_t bytes = 0;
+        forEachColumn([&bytes](const ColumnStats& stats) { bytes += stats.bytes_after; });
+        return bytes;
+    }
+
+    uint64_t FlatOutput::estimatedBytes() const {
+        uint64_t bytes = 0;
+        forEachColumn([&bytes](const ColumnStats& stats) { bytes += stats.estimated_bytes; });
+        return bytes;
+    }
+
+    void FlatOutput::report(std::ostream& out) const {
+        out << std::left << std::setw(50) << "Branch" << std::right << std::setw(14) << "Bytes before" << std::setw(14) << "Bytes after"
+            << std::setw(14) << "Estimate" << std::endl;
+        forEachColumn([&out](const ColumnStats& stats) {
+            out << std::left << std::setw(50) << stats.name << std::right << std::setw(14) << stats.bytes_before << std::setw(14) << stats.bytes_after
+                << std::setw(14) << stats.estimated_bytes;
+            if (stats.dropped)
+                out << "  (dropped)";
+            out << std::endl;
+        });
+        out << std::left << std::setw(50) << "Total" << std::right << std::setw(14) << bytesBefore() << std::setw(14) << bytesAfter()
+            << std::setw(14) << estimatedBytes() << std::endl;
+    }
+}
@@ -0,0 +1,1574 @@
+#include <cp3_llbb/HHAnalysis/interface/HHAnalyzer.h>
+#include <cp3_llbb/Framework/interface/BTagsAnalyzer.h>
+#include <cp3_llbb/HHAnalysis/interface/Categories.h>
+#include <cp3_llbb/HHAnalysis/interface/GenStatusFlags.h>
+
+#include <cp3_llbb/Framework/interface/EventProducer.h>
+#include <cp3_llbb/Framework/interface/GenParticlesProducer.h>
+#include <cp3_llbb/Framework/interface/JetsProducer.h>
+#include <cp3_llbb/Framework/interface/LeptonsProducer.h>
+#include <cp3_llbb/Framework/interface/ElectronsProducer.h>
+#include <cp3_llbb/Framework/interface/MuonsProducer.h>
+#include <cp3_llbb/Framework/interface/METProducer.h>
+#include <cp3_llbb/Framework/interface/HLTProducer.h>
+
+#include <cmath>
+
+#define HH_GEN_DEBUG (false)
+#define TT_GEN_DEBUG (false)
+
+void HHAnalyzer::registerCategories(CategoryManager& manager, const edm::ParameterSet& config) {
+    edm::ParameterSet newconfig = edm::ParameterSet(config);
+    newconfig.addUntrackedParameter("m_analyzer_name", this->m_name);
+    manager.new_category<MuMuCategory>("mumu", "Category with leading leptons as two muons", newconfig);
+    manager.new_category<ElElCategory>("elel", "Category with leading leptons as two electrons", newconfig);
+    manager.new_category<ElMuCategory>("elmu", "Category with leading leptons as electron, subleading as muon", newconfig);
+    manager.new_category<MuElCategory>("muel", "Category with leading leptons as muon, subleading as electron", newconfig);
+
+    // The histograms and the skim apply the same selection as the categories (see selectedCategory)
+    for (size_t category = 0; category < m_category_pt_cuts.size(); category++) {
+        const std::string& name = HH::SkimConfiguration::categories[category];
+        m_category_pt_cuts[category] = std::make_pair(config.getUntrackedParameter<double>(name + "_leadingLeptonPtCut"),
+                config.getUntrackedParameter<double>(name + "_subleadingLeptonPtCut"));
+    }
+}
+
+size_t HHAnalyzer::selectedCategory() const {
+    if (ll.empty() || llmetjj.empty())
+        return NO_CATEGORY;
+
+    // The flavours are exclusive, so an event is in one category at most
+    size_t category = ll[0].isElEl ? 0 : ll[0].isElMu ? 1 : ll[0].isMuEl ? 2 : 3;
+    if (leptons[ll[0].ilep1].p4.Pt() > m_category_pt_cuts[category].first &&
+            leptons[ll[0].ilep2].p4.Pt() > m_category_pt_cuts[category].second)
+        return category;
+
+    return NO_CATEGORY;
+}
+
+
+void HHAnalyzer::analyze(const edm::Event& event, const edm::EventSetup&, const ProducersManager& producers, const AnalyzersManager&, const CategoryManager&) {
+
+    HH::StageTimer inputs_timer(stageTimings(event.id().event()), HH::Stage::Inputs);
+    HH::EventInputs& inputs = m_inputs;
+    inputs.fill(event, producers, *m_config);
+    if (m_inputs_writer)
+        m_inputs_writer->write(inputs);
+    inputs_timer.stop();
+
+    analyze(inputs);
+
+    if (m_slow_events_writer) {
+        if (m_slow_event_selector.isSlow(m_event_statistics)) {
+            m_slow_events_writer->write(inputs);
+            m_event_statistics.slow_events++;
+        }
+    }
+}
+
+void HHAnalyzer::analyze(const HH::EventInputs& inputs) {
+
+    // Reset event
+    leptons.clear();
+    ll.clear();
+    met.clear();
+    llmet.clear();
+    jj.clear();
+    //llmetjj.clear();
+    //llmetjj_cmva.clear();
+
+    const HH::EventInputs::Jets& alljets = inputs.jets;
+    const HH::EventInputs::Electrons& allelectrons = inputs.electrons;
+    const HH::EventInputs::Muons& allmuons = inputs.muons;
+    const HH::EventInputs::Event& fwevent = inputs.fwevent;
+    const HH::EventInputs::HLT& hlt = inputs.hlt;
+    const HH::EventInputs::MET& met_inputs = inputs.met;
+
+    // Null when the timers are off: StageTimer then does nothing
+    HH::StageTimings* timings = stageTimings(inputs.event);
+    HH::TraceScope event_trace(timings ? timings->trace : nullptr, "event");
+    // Same for the allocations of the whole event
+    HH::MemoryStats* memory = m_config->memory_report ? &m_memory_stats : nullptr;
+    HH::EventAllocationCounter event_allocations(memory);
+
+    HH::EventStatistics& event_statistics = m_event_statistics;
+    HH::EventTimer event_timer(event_statistics);
+
+    HH::StageTimer selection_timer(timings, HH::Stage::Selection);
+    HH::ObjectSelection& selection = m_selection;
+    selection.select(inputs, *m_config);
+    selection_timer.stop();
+
+    gen_tau_br_weight = 1;
+
+    // Events without any possible `ll` never enter a category: their truth would never be written
+    bool fill_truth = !inputs.isRealData && !doingSystematics();
+    if (fill_truth && !m_config->fill_truth_for_all_events && !canBuildDilepton(selection)) {
+        fill_truth = false;
+        event_statistics.truth_skipped_events++;
+    }
+
+    if (fill_truth) {
+        HH::StageTimer gen_truth_timer(timings, HH::Stage::GenTruth);
+
+        // FIXME Moriond 2017
+        // BR for taus included in HH sample is not correct (BR is tau -> all instead of tau -> e / mu)
+        // If we run over a signal sample, randomly throw events according to BR(tau -> e / mu)
+
+// ***** ***** *****
+// Get the MC truth information on the hard process
+// ***** ***** *****
+// from https://github.com/cms-sw/cmssw/blob/CMSSW_7_4_X/DataFormats/HepMCCandidate/interface/GenStatusFlags.h
+//    enum StatusBits {
+//0      kIsPrompt = 0,
+//1      kIsDecayedLeptonHadron,
+//2      kIsTauDecayProduct,
+//3      kIsPromptTauDecayProduct,
+//4      kIsDirectTauDecayProduct,
+//5      kIsDirectPromptTauDecayProduct,
+//6      kIsDirectHadronDecayProduct,
+//7      kIsHardProcess,
+//8      kFromHardProcess,
+//9      kIsHardProcessTauDecayProduct,
+//10      kIsDirectHardProcessTauDecayProduct,
+//11      kFromHardProcessBeforeFSR,
+//12      kIsFirstCopy,
+//13      kIsLastCopy,
+//14      kIsLastCopyBeforeFSR
+//    };
+
+
+        constexpr double BR_tau_e_mu = 0.3524;
+        size_t n_taus = 0;
+        bool is_signal = false;
+
+        const HH::EventInputs::GenParticles& gp = inputs.gen_particles;
+
+#if HH_GEN_DEBUG
+    std::function<void(size_t)> print_mother_chain = [&gp, &print_mother_chain](size_t p) {
+
+        if (gp.pruned_mothers_index[p].empty()) {
+            std::cout << std::endl;
+            return;
+        }
+
+        size_t index = gp.pruned_mothers_index[p][0];
+            std::cout << " <- #" << index << "(" << gp.pruned_pdg_id[index] << ")";
+            print_mother_chain(index);
+    };
+#endif
+
+        std::function<bool(size_t, size_t)> pruned_decays_from = [&pruned_decays_from, &gp](size_t particle_index, size_t mother_index) -> bool {
+            // Iterator over all pruned particles to find if the particle `particle_index` has `mother_index` in its decay history
+            if (gp.pruned_mothers_index[particle_index].empty())
+                return false;
+
+            size_t index = gp.pruned_mothers_index[particle_index][0];
+
+            if (index == mother_index) {
+                return true;
+            }
+
+            if (pruned_decays_from(index, mother_index))
+                return true;
+
+            return false;
+        };
+
+        std::function<bool(size_t, size_t, bool)> pruned_decays_from_pdg_id = [&pruned_decays_from_pdg_id, &gp](size_t particle_index, uint64_t pdg_id, bool direct) -> bool {
+            // Iterator over all pruned particles to find if the particle `particle_index` decays from a particle with pdg id == pdg_id
+            if (gp.pruned_mothers_index[particle_index].empty())
+                return false;
+
+            size_t index = gp.pruned_mothers_index[particle_index][0];
+
+            if (std::abs(gp.pruned_pdg_id[index]) == pdg_id) {
+                return true;
+            }
+
+            if (!direct && pruned_decays_from_pdg_id(index, pdg_id, direct))
+                return true;
+
+            return false;
+        };
+
+        // Construct signal gen info
+
+        gen_iX = -1;
+        gen_iH1 = gen_iH2 = -1;
+        gen_iH1_afterFSR = gen_iH2_afterFSR = -1;
+        gen_iB = gen_iBbar = -1;
+        gen_iB_afterFSR = gen_iBbar_afterFSR = -1;
+        gen_iV2 = gen_iV1 = -1;
+        gen_iV2_afterFSR = gen_iV1_afterFSR = -1;
+        gen_iLminus = gen_iLplus = -1;
+        gen_iLminus_afterFSR = gen_iLplus_afterFSR = -1;
+        gen_iNu1 = gen_iNu2 = -1;
+
+        if (m_hh_truth_scan->enabled()) {
+            for (unsigned int ip = 0; ip < gp.pruned_p4.size(); ip++) {
+                std::bitset<15> flags (gp.pruned_status_flags[ip]);
+
+                if (!flags.test(8))
+                    continue;
+
+                int64_t pdg_id = gp.pruned_pdg_id[ip];
+
+#if HH_GEN_DEBUG
+                std::cout << "[" << ip << "] pdg id: " << pdg_id << "  flags: " << flags << "  p = " << gp.pruned_p4[ip] << std::endl;
+                print_mother_chain(ip);
+#endif
+
+                auto p4 = gp.pruned_p4[ip];
+
+                if (std::abs(pdg_id) == 35 || std::abs(pdg_id) == 39) {
+                    ASSIGN_HH_GEN_INFO_NO_FSR(X, "X");
+                } else if (pdg_id == 25) {
+                    ASSIGN_HH_GEN_INFO_2(H1, H2, "Higgs");
+                }
+
+                // Only look for Higgs decays if we have found the two Higgs
+                if ((gen_iH1 == -1) || (gen_iH2 == -1))
+                    continue;
+
+                is_signal = true;
+
+                // And if the particle actually come directly from a Higgs
+                bool from_h1_decay = pruned_decays_from(ip, gen_iH1);
+                bool from_h2_decay = pruned_decays_from(ip, gen_iH2);
+
+                // Only keep particles coming from the Higgs decay
+                if (! from_h1_decay && ! from_h2_decay)
+                    continue;
+
+                if (pdg_id == 5) {
+                    ASSIGN_HH_GEN_INFO(B, "B");
+                } else if (pdg_id == -5) {
+                    ASSIGN_HH_GEN_INFO(Bbar, "Bbar");
+                }
+
+                // Ignore B decays
+                if (pruned_decays_from_pdg_id(ip, 5, false))
+                    continue;
+
+                // Count the number of tau coming directly from a W or a Z
+                if ((std::abs(pdg_id) == 15) && (pruned_decays_from_pdg_id(ip, 24, true) || pruned_decays_from_pdg_id(ip, 23, true))) {
+                    n_taus++;
+                }
+
+                if ((pdg_id == 11) || (pdg_id == 13) || (pdg_id == 15)) {
+                    ASSIGN_HH_GEN_INFO(Lminus, "L-");
+                } else if ((pdg_id == -11) || (pdg_id == -13) || (pdg_id == -15)) {
+                    ASSIGN_HH_GEN_INFO(Lplus, "L+");
+                } else if ((pdg_id == 23) || (std::abs(pdg_id) == 24)) {
+                    ASSIGN_HH_GEN_INFO_2(V1, V2, "W/Z bosons");
+                } else if ((std::abs(pdg_id) == 12) || (std::abs(pdg_id) == 14) || (std::abs(pdg_id) == 16)) {
+                    ASSIGN_HH_GEN_INFO_2_NO_FSR(Nu1, Nu2, "neutrinos");
+                }
+            }
+
+            m_hh_truth_scan->observe(gen_iX != -1 || gen_iH1 != -1);
+        }
+
+        if (is_signal) {
+            // FIXME Moriond 2017
+            if (n_taus > 2) {
+                std::cout << "ERROR: More than two taus coming from Higgs decays. There's something wrong!" << std::endl;
+            }
+
+            double factor = std::pow(BR_tau_e_mu, n_taus);
+            if (m_config->tau_br_weight) {
+                gen_tau_br_weight = factor;
+            } else {
+                // Keyed on the event id, so the same events are kept whatever the job splitting or the processing order
+                double random = HH::eventUniform(m_config->tau_br_seed, 0, inputs.run, inputs.lumi, inputs.event);
+                if (random > factor)
+                    return;
+            }
+        }
+
+        // Swap neutrinos if needed
+        if ((gen_iNu1 != -1) && (gen_iNu2 != -1)) {
+            if (gp.pruned_pdg_id[gen_iNu1] > 0) {
+                std::swap(gen_iNu1, gen_iNu2);
+                std::swap(gen_Nu1, gen_Nu2);
+            }
+        }
+
+        if ((gen_iH1 != -1) && (gen_iH2 != -1)) {
+            gen_mHH = (gen_H1 + gen_H2).M();
+            gen_costhetastar = getCosThetaStar_CS(gen_H1, gen_H2);
+        }
+
+#if HH_GEN_DEBUG
+        PRINT_PARTICULE(X);
+        PRINT_RESONANCE(H1, H2);
+        PRINT_RESONANCE(B, Bbar);
+        PRINT_RESONANCE(V1, V2);
+        PRINT_RESONANCE(Lminus, Lplus);
+        PRINT_RESONANCE_NO_FSR(Nu1, Nu2);
+
+        // Rebuild resonances for consistency checks
+        auto LminusNu1 = gen_Lminus + gen_Nu1;
+        std::cout << "    gen_(L- Nu1).M() = " << LminusNu1.M() << std::endl;
+
+        auto LplusNu2 = gen_Lplus + gen_Nu2;
+        std::cout << "    gen_(L+ Nu2).M() = " << LplusNu2.M() << std::endl;
+
+        auto LminusNu1_afterFSR = gen_Lminus_afterFSR + gen_Nu1;
+        std::cout << "    gen_(L- Nu1)_afterFSR.M() = " << LminusNu1_afterFSR.M() << std::endl;
+
+        auto LplusNu2_afterFSR = gen_Lplus_afterFSR + gen_Nu2;
+        std::cout << "    gen_(L+ Nu2)_afterFSR.M() = " << LplusNu2_afterFSR.M() << std::endl;
+        
+        auto LLNuNu = gen_Lplus + gen_Lminus + gen_Nu1 + gen_Nu2;
+        std::cout << "    gen_(LL NuNu).M() = " << LLNuNu.M() << std::endl;
+
+        auto LLNuNu_afterFSR = gen_Lplus_afterFSR + gen_Lminus_afterFSR + gen_Nu1 + gen_Nu2;
+        std::cout << "    gen_(LL NuNu)_afterFSR.M() = " << LLNuNu_afterFSR.M() << std::endl;
+
+        auto LLNuNuBB = gen_Lplus + gen_Lminus + gen_Nu1 + gen_Nu2 + gen_B + gen_Bbar;
+        std::cout << "    gen_(LL NuNu BB).M() = " << LLNuNuBB.M() << std::endl;
+
+        auto LLNuNuBB_afterFSR = gen_Lplus_afterFSR + gen_Lminus_afterFSR + gen_Nu1 + gen_Nu2 + gen_B_afterFSR + gen_Bbar_afterFSR;
+        std::cout << "    gen_(LL NuNu BB)_afterFSR.M() = " << LLNuNuBB_afterFSR.M() << std::endl;
+#endif
+
+        // ***** ***** *****
+        // Matching
+        // ***** ***** *****
+        if (m_config->sparse_gen_deltaR) {
+            FILL_GEN_MATCHES(alljets, jet, B);
+            FILL_GEN_MATCHES(alljets, jet, Bbar);
+            FILL_GEN_MATCHES(alljets, jet, B_afterFSR);
+            FILL_GEN_MATCHES(alljets, jet, Bbar_afterFSR);
+            FILL_GEN_MATCHES(allelectrons, electron, Lminus);
+            FILL_GEN_MATCHES(allelectrons, electron, Lplus);
+            FILL_GEN_MATCHES(allelectrons, electron, Lminus_afterFSR);
+            FILL_GEN_MATCHES(allelectrons, electron, Lplus_afterFSR);
+            FILL_GEN_MATCHES(allmuons, muon, Lminus);
+            FILL_GEN_MATCHES(allmuons, muon, Lplus);
+            FILL_GEN_MATCHES(allmuons, muon, Lminus_afterFSR);
+            FILL_GEN_MATCHES(allmuons, muon, Lplus_afterFSR);
+        } else {
+            for (auto p4: alljets.gen_p4) {
+                gen_deltaR_jet_B.push_back(deltaR(p4, gen_B));
+                gen_deltaR_jet_Bbar.push_back(deltaR(p4, gen_Bbar));
+                gen_deltaR_jet_B_afterFSR.push_back(deltaR(p4, gen_B_afterFSR));
+                gen_deltaR_jet_Bbar_afterFSR.push_back(deltaR(p4, gen_Bbar_afterFSR));
+            }
+            for (auto p4: allelectrons.gen_p4) {
+                gen_deltaR_electron_L1.push_back(deltaR(p4, gen_Lminus));
+                gen_deltaR_electron_L2.push_back(deltaR(p4, gen_Lplus));
+                gen_deltaR_electron_L1_afterFSR.push_back(deltaR(p4, gen_Lminus_afterFSR));
+                gen_deltaR_electron_L2_afterFSR.push_back(deltaR(p4, gen_Lplus_afterFSR));
+            }
+            for (auto p4: allmuons.gen_p4) {
+                gen_deltaR_muon_L1.push_back(deltaR(p4, gen_Lminus));
+                gen_deltaR_muon_L2.push_back(deltaR(p4, gen_Lplus));
+                gen_deltaR_muon_L1_afterFSR.push_back(deltaR(p4, gen_Lminus_afterFSR));
+                gen_deltaR_muon_L2_afterFSR.push_back(deltaR(p4, gen_Lplus_afterFSR));
+            }
+        }
+    }
+
+    //float mh = inputs.isRealData ? 125.09 : 125.0;
+    LorentzVector null_p4(0., 0., 0., 0.);
+    // Includes the tau BR correction when applied as a weight, so that the counters stay comparable with the 'reject' mode
+    float event_weight = fwevent.weight * gen_tau_br_weight;
+    HH::CutFlow tmp_cutflow;
+
+    // ***** ***** *****
+    // Trigger Matching
+    // ***** ***** *****
+
+    // the actual trigger matching to dilepton HLT paths happens only once we have a dilepton candidate to consider in the event
+
+    // ********** 
+    // Leptons and dileptons
+    // ********** 
+    HH::StageTimer leptons_timer(timings, HH::Stage::Leptons);
+
+    auto electron_pass_HLT_ID = [&allelectrons](size_t index) {
+        // Use POG HLT-safe id
+
+        bool result = allelectrons.hlt_safe_id[index];
+
+        // Add dxy and dz cuts described at https://twiki.cern.ch/twiki/bin/view/CMS/CutBasedElectronIdentificationRun2#Offline_selection_criteria
+        if (allelectrons.isEB[index]) {
+            result &= std::abs(allelectrons.dz[index]) < 0.1;
+            result &= std::abs(allelectrons.dxy[index]) < 0.05;
+        } else {
+            result &= std::abs(allelectrons.dz[index]) < 0.2;
+            result &= std::abs(allelectrons.dxy[index]) < 0.1;
+        }
+
+        return result;
+    };
+
+    // Fill lepton structures from the objects passing the selection (see Selection.h)
+    // Electrons: pt, eta and medium ID
+    for (uint32_t ielectron: selection.electrons.indices)
+    {
+        HH::Lepton ele;
+        ele.p4 = allelectrons.p4[ielectron];
+        ele.charge = allelectrons.charge[ielectron];
+        ele.idx = ielectron;
+        ele.isMu = false;
+        ele.isEl = true;
+        ele.ele_hlt_id = electron_pass_HLT_ID(ielectron);
+
+        ele.gen_matched = allelectrons.matched[ielectron];
+        ele.gen_p4 = ele.gen_matched ? allelectrons.gen_p4[ielectron] : null_p4;
+        ele.gen_DR = ele.gen_matched ? ROOT::Math::VectorUtil::DeltaR(ele.p4, ele.gen_p4): -1.;
+        ele.gen_DPtOverPt = ele.gen_matched ? (ele.p4.Pt() - ele.gen_p4.Pt()) / ele.p4.Pt() : -10.;
+        ele.hlt_leg1 = false;
+        ele.hlt_leg2 = false;
+
+        ele.sc_eta = allelectrons.sc_eta[ielectron];
+
+        leptons.push_back(ele);
+    }//end of loop on electrons
+
+    // Muons: pt, eta, tight ID and tight isolation
+    for (uint32_t imuon: selection.muons.indices)
+    {
+        HH::Lepton mu;
+        mu.p4 = allmuons.p4[imuon];
+        mu.charge = allmuons.charge[imuon];
+        mu.idx = imuon;
+        mu.isMu = true;
+        mu.isEl = false;
+        mu.gen_matched = allmuons.matched[imuon];
+        mu.gen_p4 = mu.gen_matched ? allmuons.gen_p4[imuon] : null_p4;
+        mu.gen_DR = mu.gen_matched ? ROOT::Math::VectorUtil::DeltaR(mu.p4, mu.gen_p4) : -1.;
+        mu.gen_DPtOverPt = mu.gen_matched ? (mu.p4.Pt() - mu.gen_p4.Pt()) / mu.p4.Pt() : -10.;
+        mu.hlt_leg1 = false;
+        mu.hlt_leg2 = false;
+
+        leptons.push_back(mu);
+    }//end of loop on muons
+
+    // sort leptons by pt (ignoring flavour, id and iso)
+    std::sort(leptons.begin(), leptons.end(), [](const HH::Lepton& lep1, const HH::Lepton& lep2) { return lep1.p4.Pt() > lep2.p4.Pt(); });
+
+    // Only opposite-sign pairs are built, ranked by ht like `ll`, of which only the first candidate is kept. The
+    // trigger efficiencies only run on the one kept
+    HH::DileptonCandidates& dilepton_candidates = m_dilepton_candidates;
+    dilepton_candidates.build(leptons, m_config->leadingElectronPtCut, m_config->leadingMuonPtCut);
+    std::vector<HH::DileptonCandidate>& candidates = dilepton_candidates.candidates();
+
+    // The HLT matching of a lepton depends on the pairs matched before it (see matchOfflineLepton): the pairs
+    // are matched in the order of the loop over all the pairs, same-sign ones included, as the selection needs
+    // them. The remaining ones are matched after the selection, so that the HLT fields of `leptons` are filled
+    size_t n_matched_pairs = 0;
+    auto match_pairs_until = [&](uint32_t order) {
+        if (hlt.paths.empty() || order < n_matched_pairs)
+            return;
+
+        HH::StageTimer hlt_matching_timer(timings, HH::Stage::HLTMatching);
+        for (; n_matched_pairs <= order; n_matched_pairs++) {
+            const HH::DileptonCandidates::Pair& pair = dilepton_candidates.order()[n_matched_pairs];
+            HH::Dilepton dilep;
+            dilep.ilep1 = pair.ilep1;
+            dilep.ilep2 = pair.ilep2;
+            matchOfflineLepton(hlt, dilep);
+
+            if (pair.candidate < 0)
+                continue;
+
+            const HH::Lepton& lep1 = leptons[pair.ilep1];
+            const HH::Lepton& lep2 = leptons[pair.ilep2];
+            HH::DileptonCandidate& candidate = candidates[pair.candidate];
+            candidate.hlt_idxs = std::make_pair(lep1.hlt_idx, lep2.hlt_idx);
+            candidate.hlt_legs = (lep1.hlt_leg1 && lep2.hlt_leg2) || (lep1.hlt_leg2 && lep2.hlt_leg1);
+        }
+    };
+
+    auto pass_selection = [&](const HH::DileptonCandidate& candidate) {
+        if (!inputs.isRealData)
+            return true;
+
+        // FIXME L1 EMTF bug mitigation -- cut the overlap on data if it's a run affected by the bug
+        const HH::Lepton& lep1 = leptons[candidate.ilep1];
+        const HH::Lepton& lep2 = leptons[candidate.ilep2];
+        if (lep1.isMu && lep2.isMu && fwevent.run < 278167 && isCSCWithOverlap(lep1, lep2))
+            return false;
+
+        // Throw event if there is no matched dilepton trigger path (only on data)
+        match_pairs_until(candidate.order);
+        return candidate.hlt_legs;
+    };
+
+    // Flavours (elel, elmu, muel, mumu) with a pair passing the selection, for the counters
+    std::array<bool, 4> flavour_found {};
+    size_t n_flavours_found = 0;
+    for (const HH::DileptonCandidate& candidate: candidates)
+    {
+        const HH::Lepton& lep1 = leptons[candidate.ilep1];
+        const HH::Lepton& lep2 = leptons[candidate.ilep2];
+        size_t flavour = 2 * lep1.isMu + lep2.isMu;
+        // A harder pair of this flavour already passed: this one can neither be kept nor change the counters
+        if (flavour_found[flavour] || !pass_selection(candidate))
+            continue;
+
+        flavour_found[flavour] = true;
+        n_flavours_found++;
+
+        // Counters
+        tmp_cutflow[HH::CutFlow::has2leptons] = event_weight;
+        tmp_cutflow[static_cast<HH::CutFlow::Step>(HH::CutFlow::has2leptons_elel + flavour)] = event_weight;
+
+        if (ll.empty()) {
+            HH::Dilepton dilep;
+            dilep.p4 = lep1.p4 + lep2.p4;
+            dilep.idxs = std::make_pair(lep1.idx, lep2.idx);
+            dilep.ilep1 = candidate.ilep1;
+            dilep.ilep2 = candidate.ilep2;
+            dilep.isOS = lep1.charge * lep2.charge < 0;
+            dilep.isPlusMinus = lep1.charge > 0 && lep2.charge < 0;
+            dilep.isMinusPlus = lep1.charge < 0 && lep2.charge > 0;
+            dilep.isMuMu = lep1.isMu && lep2.isMu;
+            dilep.isElEl = lep1.isEl && lep2.isEl;
+            dilep.isElMu = lep1.isEl && lep2.isMu;
+            dilep.isMuEl = lep1.isMu && lep2.isEl;
+            dilep.isSF = dilep.isMuMu || dilep.isElEl;
+            //dilep.id_LL = lep1.id_L && lep2.id_L;
+            //dilep.id_LM = (lep1.id_L && lep2.id_M) || (lep2.id_L && lep1.id_M);
+            //dilep.id_LT = (lep1.id_L && lep2.id_T) || (lep2.id_L && lep1.id_T);
+            //dilep.id_LHWW = (lep1.id_L && lep2.id_HWW) || (lep2.id_L && lep1.id_HWW);
+            //dilep.id_ML = (lep1.id_M && lep2.id_L) || (lep2.id_M && lep1.id_L);
+            //dilep.id_MM = lep1.id_M && lep2.id_M;
+            //dilep.id_MT = (lep1.id_T && lep2.id_M) || (lep2.id_T && lep1.id_M);
+            //dilep.id_MHWW = (lep1.id_M && lep2.id_HWW) || (lep2.id_M && lep1.id_HWW);
+            //dilep.id_TL = (lep1.id_T && lep2.id_L) || (lep2.id_T && lep1.id_L);
+            //dilep.id_TM = (lep1.id_T && lep2.id_M) || (lep2.id_T && lep1.id_M);
+            //dilep.id_TT = lep1.id_T && lep2.id_T;
+            //dilep.id_THWW = (lep1.id_T && lep2.id_HWW) || (lep2.id_T && lep1.id_HWW);
+            //dilep.id_HWWL = (lep1.id_HWW && lep2.id_L) || (lep2.id_HWW && lep1.id_L);
+            //dilep.id_HWWM = (lep1.id_HWW && lep2.id_M) || (lep2.id_HWW && lep1.id_M);
+            //dilep.id_HWWT = (lep1.id_HWW && lep2.id_T) || (lep2.id_HWW && lep1.id_T);
+            //dilep.id_HWWHWW = lep1.id_HWW && lep2.id_HWW;
+            //dilep.iso_LL = lep1.iso_L && lep2.iso_L;
+            //dilep.iso_LT = (lep1.iso_L && lep2.iso_T) || (lep2.iso_L && lep1.iso_T);
+            //dilep.iso_LHWW = (lep1.iso_L && lep2.iso_HWW) || (lep2.iso_L && lep1.iso_HWW);
+            //dilep.iso_TL = (lep1.iso_T && lep2.iso_L) || (lep2.iso_T && lep1.iso_L);
+            //dilep.iso_TT = lep1.iso_T && lep2.iso_T;
+            //dilep.iso_THWW = (lep1.iso_T && lep2.iso_HWW) || (lep2.iso_T && lep1.iso_HWW);
+            //dilep.iso_HWWL = (lep1.iso_HWW && lep2.iso_L) || (lep2.iso_HWW && lep1.iso_L);
+            //dilep.iso_HWWT = (lep1.iso_HWW && lep2.iso_T) || (lep2.iso_HWW && lep1.iso_T);
+            //dilep.iso_HWWHWW = lep1.iso_HWW && lep2.iso_HWW;
+            dilep.DR_l_l = ROOT::Math::VectorUtil::DeltaR(lep1.p4, lep2.p4);
+            dilep.DPhi_l_l = fabs(ROOT::Math::VectorUtil::DeltaPhi(lep1.p4, lep2.p4));
+            dilep.ht_l_l = lep1.p4.Pt() + lep2.p4.Pt();
+            dilep.gen_matched = lep1.gen_matched && lep2.gen_matched;
+            dilep.gen_p4 = dilep.gen_matched ? lep1.gen_p4 + lep2.gen_p4 : null_p4;
+            dilep.gen_DR = dilep.gen_matched ? ROOT::Math::VectorUtil::DeltaR(dilep.p4, dilep.gen_p4) : -1.;
+            dilep.gen_DPtOverPt = dilep.gen_matched ? (dilep.p4.Pt() - dilep.gen_p4.Pt()) / dilep.p4.Pt() : -10.;
+
+            match_pairs_until(candidate.order);
+            dilep.hlt_idxs = candidate.hlt_idxs;
+
+            if (inputs.isRealData) {
+               dilep.trigger_efficiency = 1.;
+               dilep.trigger_efficiency_downVariated = 1.;
+               dilep.trigger_efficiency_upVariated = 1.;
+            } else {
+               HH::StageTimer trigger_efficiencies_timer(timings, HH::Stage::TriggerEfficiencies);
+               fillTriggerEfficiencies(lep1, lep2, dilep);
+
+               // FIXME L1 EMTF bug mitigation -- on MC, apply the fraction of lumi the bug was not present
+               if (dilep.isMuMu && isCSCWithOverlap(lep1, lep2)) {
+                   dilep.trigger_efficiency *= 0.5265;
+                   dilep.trigger_efficiency_downVariated *= 0.5265;
+                   dilep.trigger_efficiency_upVariated *= 0.5265;
+               }
+            }
+
+            // Fill: only the first ll candidate is kept
+            ll.push_back(dilep);
+        }
+
+        if (n_flavours_found == flavour_found.size())
+            break;
+    }
+    // Leptons matched in earlier pairs are skipped by matchOfflineLepton, so this is cheap
+    if (!dilepton_candidates.order().empty())
+        match_pairs_until(dilepton_candidates.order().size() - 1);
+    leptons_timer.stop();
+
+    // ***** 
+    // Adding MET(s)
+    // ***** 
+    HH::StageTimer met_timer(timings, HH::Stage::Met);
+    // genMet is not constructed in the framework, so construct it manually out of the neutrinos hanging around the mc particles.
+    // Shared by all the MET variants
+    bool gen_met_matched = false;
+    LorentzVector gen_met_p4 = null_p4;
+    if (!inputs.isRealData)
+    {
+        const HH::EventInputs::GenParticles& gp = inputs.gen_particles;
+        for (unsigned int ip = 0; ip < gp.pruned_p4.size(); ip++) {
+            std::bitset<15> flags (gp.pruned_status_flags[ip]);
+            if (!flags.test(13)) continue; // take the last copies
+            if (abs(gp.pruned_pdg_id[ip]) == 12 || abs(gp.pruned_pdg_id[ip]) == 14 || abs(gp.pruned_pdg_id[ip]) == 16)
+            {
+                gen_met_matched = true;
+                gen_met_p4 += gp.pruned_p4[ip];
+            }
+        }
+    }
+
+    for (size_t ivariant = 0; ivariant < met_inputs.p4.size(); ivariant++)
+    {
+        HH::Met mymet;
+        mymet.p4 = met_inputs.p4[ivariant];
+        mymet.isNoHF = m_config->met_producers[ivariant] == m_config->nohf_met_producer;
+        mymet.gen_matched = gen_met_matched;
+        mymet.gen_p4 = gen_met_p4;
+        mymet.gen_DR = mymet.gen_matched ? ROOT::Math::VectorUtil::DeltaR(mymet.p4, mymet.gen_p4) : -1.;
+        mymet.gen_DPhi = mymet.gen_matched ? fabs(ROOT::Math::VectorUtil::DeltaPhi(mymet.p4, mymet.gen_p4)) : -1.;
+        mymet.gen_DPtOverPt = mymet.gen_matched ? (mymet.p4.Pt() - mymet.gen_p4.Pt()) / mymet.p4.Pt() : -10.;
+        met.push_back(mymet);
+    }
+
+    for (unsigned int imet = 0; imet < met.size(); imet++)
+    {
+        for (unsigned int ill = 0; ill < ll.size(); ill++)
+        {
+            HH::DileptonMet myllmet;
+// DileptonMet inherits from Dilepton struct, initalize everything properly
+// FIXME: there is very probably a cleaner way to do
+            myllmet.p4 = ll[ill].p4 + met[imet].p4;
+            // blind copy of the ll content
+            myllmet.idxs = std::make_pair(ll[ill].idxs.first, ll[ill].idxs.second);
+            myllmet.ilep1 = ll[ill].ilep1;
+            myllmet.ilep2 = ll[ill].ilep2;
+            myllmet.isOS = ll[ill].isOS;
+            myllmet.isPlusMinus = ll[ill].isPlusMinus;
+            myllmet.isMinusPlus = ll[ill].isMinusPlus;
+            myllmet.isMuMu = ll[ill].isMuMu;
+            myllmet.isElEl = ll[ill].isElEl;
+            myllmet.isElMu = ll[ill].isElMu;
+            myllmet.isMuEl = ll[ill].isMuEl;
+            myllmet.isSF = ll[ill].isSF;
+            //myllmet.id_LL = ll[ill].id_LL;
+            //myllmet.id_LM = ll[ill].id_LM;
+            //myllmet.id_LT = ll[ill].id_LT;
+            //myllmet.id_LHWW = ll[ill].id_LHWW;
+            //myllmet.id_ML = ll[ill].id_ML;
+            //myllmet.id_MM = ll[ill].id_MM;
+            //myllmet.id_MT = ll[ill].id_MT;
+            //myllmet.id_MHWW = ll[ill].id_MHWW;
+            //myllmet.id_TL = ll[ill].id_TL;
+            //myllmet.id_TM = ll[ill].id_TM;
+            //myllmet.id_TT = ll[ill].id_TT;
+            //myllmet.id_THWW = ll[ill].id_THWW;
+            //myllmet.id_HWWL = ll[ill].id_HWWL;
+            //myllmet.id_HWWM = ll[ill].id_HWWM;
+            //myllmet.id_HWWT = ll[ill].id_HWWT;
+            //myllmet.id_HWWHWW = ll[ill].id_HWWHWW;
+            //myllmet.iso_LL = ll[ill].iso_LL;
+            //myllmet.iso_LT = ll[ill].iso_LT;
+            //myllmet.iso_LHWW = ll[ill].iso_LHWW;
+            //myllmet.iso_TL = ll[ill].iso_TL;
+            //myllmet.iso_TT = ll[ill].iso_TT;
+            //myllmet.iso_THWW = ll[ill].iso_THWW;
+            //myllmet.iso_HWWL = ll[ill].iso_HWWL;
+            //myllmet.iso_HWWT = ll[ill].iso_HWWT;
+            //myllmet.iso_HWWHWW = ll[ill].iso_HWWHWW;
+            myllmet.DR_l_l = ll[ill].DR_l_l;
+            myllmet.DPhi_l_l = ll[ill].DPhi_l_l;
+            myllmet.ht_l_l = ll[ill].ht_l_l;
+            // content specific to HH:DileptonMet
+            myllmet.ill = ill;
+            myllmet.imet = imet;
+            myllmet.isNoHF = met[imet].isNoHF;
+            float dphi = fabs(ROOT::Math::VectorUtil::DeltaPhi(ll[ill].p4, met[imet].p4));
+            myllmet.DPhi_ll_met = dphi;
+            float mindphi = std::min(fabs(ROOT::Math::VectorUtil::DeltaPhi(leptons[ll[ill].ilep1].p4, met[imet].p4)), fabs(ROOT::Math::VectorUtil::DeltaPhi(leptons[ll[ill].ilep2].p4, met[imet].p4)));
+            myllmet.minDPhi_l_met = mindphi; 
+            float maxdphi = std::max(fabs(ROOT::Math::VectorUtil::DeltaPhi(leptons[ll[ill].ilep1].p4, met[imet].p4)), fabs(ROOT::Math::VectorUtil::DeltaPhi(leptons[ll[ill].ilep2].p4, met[imet].p4)));
+            myllmet.maxDPhi_l_met = maxdphi;
+            myllmet.MT = (ll[ill].p4 + met[imet].p4).M();
+            myllmet.MT_formula = std::sqrt(2 * ll[ill].p4.Pt() * met[imet].p4.Pt() * (1-std::cos(dphi)));
+            myllmet.projectedMet = mindphi >= M_PI ? met[imet].p4.Pt() : met[imet].p4.Pt() * std::sin(mindphi);
+            myllmet.gen_matched = ll[ill].gen_matched && met[imet].gen_matched;
+            myllmet.gen_p4 = myllmet.gen_matched ? ll[ill].gen_p4 + met[imet].gen_p4 : null_p4;
+            myllmet.gen_DR = myllmet.gen_matched ? ROOT::Math::VectorUtil::DeltaR(myllmet.p4, myllmet.gen_p4) : -1.;
+            myllmet.gen_DPhi = myllmet.gen_matched ? fabs(ROOT::Math::VectorUtil::DeltaPhi(myllmet.p4, myllmet.gen_p4)) : -1.;
+            myllmet.gen_DPtOverPt = myllmet.gen_matched ? (myllmet.p4.Pt() - myllmet.gen_p4.Pt()) / myllmet.p4.Pt() : -10.;
+            llmet.push_back(myllmet);
+        }
+    }
+
+    met_timer.stop();
+
+    // ***** 
+    // Jets and dijets 
+    // ***** 
+    HH::StageTimer jets_timer(timings, HH::Stage::Jets);
+
+    // Jets passing pt, eta and loose ID (see Selection.h)
+    for (uint32_t ijet: selection.jets.indices)
+    {
+        float correctionFactor = m_config->applyBJetRegression ? alljets.regPt[ijet] / alljets.p4[ijet].Pt() : 1.;
+/*
+        std::cout << "m_config->jets_producer= " << m_config->jets_producer
+            << "\tm_applyBJetRegression= " << m_config->applyBJetRegression
+            << "\talljets.p4[" << ijet << "].Pt()= " << alljets.p4[ijet].Pt()
+            << "\talljets.regPt[" << ijet << "]= " << alljets.regPt[ijet]
+            << "\tcorrectionFactor= " << correctionFactor
+            << std::endl;
+*/
+        HH::Jet myjet;
+        myjet.p4 = alljets.p4[ijet] * correctionFactor;
+        myjet.idx = ijet;
+
+        myjet.CSV = alljets.CSV[ijet];
+        myjet.CMVAv2 = alljets.CMVAv2[ijet];
+        float mybtag = alljets.bDiscr[ijet];
+        //myjet.btag_L = mybtag > m_config->jet_bDiscrCut_loose;
+        myjet.btag_M = mybtag > m_config->jet_bDiscrCut_medium;
+        //myjet.btag_T = mybtag > m_config->jet_bDiscrCut_tight;
+        myjet.gen_matched_bParton = (std::abs(alljets.partonFlavor[ijet]) == 5);
+        myjet.gen_matched_bHadron = (alljets.hadronFlavor[ijet]) == 5;
+        myjet.gen_matched = alljets.matched[ijet];
+        myjet.gen_p4 = myjet.gen_matched ? alljets.gen_p4[ijet] : null_p4;
+        myjet.gen_DR = myjet.gen_matched ? ROOT::Math::VectorUtil::DeltaR(myjet.p4, myjet.gen_p4) : -1.;
+        myjet.gen_DPtOverPt = myjet.gen_matched ? (myjet.p4.Pt() - myjet.gen_p4.Pt()) / myjet.p4.Pt() : -10.;
+        myjet.gen_b = (alljets.hadronFlavor[ijet]) == 5; // redundant with gen_matched_bHadron defined above
+        myjet.gen_c = (alljets.hadronFlavor[ijet]) == 4;
+        myjet.gen_l = (alljets.hadronFlavor[ijet]) < 4;
+
+        bool isThereACloseSelectedLepton = false;
+        for (auto& mylepton: leptons) {
+            if (ROOT::Math::VectorUtil::DeltaR(myjet.p4, mylepton.p4) < m_config->minDR_l_j_Cut) {
+                isThereACloseSelectedLepton = true;
+                break;
+            }
+        }
+
+        if (isThereACloseSelectedLepton)
+            continue;
+
+        jets.push_back(myjet);
+    }
+
+    jets_timer.stop();
+
+    HH::StageTimer dijets_timer(timings, HH::Stage::Dijets);
+    // With maxJetsForPairing, only the leading jets are paired: this bounds the size of jj (quadratic in
+    // the number of jets) and of llmetjj. Capped events are flagged and counted
+    size_t n_pairing_jets = jets.size();
+    jets_pairing_capped = m_config->max_jets_for_pairing && n_pairing_jets > m_config->max_jets_for_pairing;
+    if (jets_pairing_capped) {
+        n_pairing_jets = m_config->max_jets_for_pairing;
+        event_statistics.capped_events++;
+    }
+
+    // Only the best maxDijets pairs under cmva are kept, best first, followed by the best pair of each other
+    // ordering of dijetRankings if it is not already there: the pairs are ranked on cheap keys (sums of
+    // discriminants, pair pt or mass) and the other fields are only computed for the survivors
+    const std::vector<HH::DijetRanking::DijetRanking>& dijet_rankings = m_config->dijet_rankings;
+    HH::DijetRanker& dijet_ranker = m_dijet_ranker;
+    dijet_ranker.rank(jets, n_pairing_jets, dijet_rankings, m_config->max_dijets);
+    auto add_dijet = [&](unsigned int ijet1, unsigned int ijet2)
+    {
+        HH::Dijet myjj;
+        myjj.p4 = jets[ijet1].p4 + jets[ijet2].p4;
+        myjj.idxs = std::make_pair(jets[ijet1].idx, jets[ijet2].idx);
+        myjj.ijet1 = ijet1;
+        myjj.ijet2 = ijet2;
+        //myjj.jid_LL = jets[ijet1].id_L && jets[ijet2].id_L;
+        //myjj.jid_TT = jets[ijet1].id_T && jets[ijet2].id_T;
+        //myjj.jid_TLVTLV = jets[ijet1].id_TLV && jets[ijet2].id_TLV;
+        //myjj.btag_LL = jets[ijet1].btag_L && jets[ijet2].btag_L;
+        //myjj.btag_LM = (jets[ijet1].btag_L && jets[ijet2].btag_M) || (jets[ijet2].btag_L && jets[ijet1].btag_M);
+        //myjj.btag_LT = (jets[ijet1].btag_L && jets[ijet2].btag_T) || (jets[ijet2].btag_L && jets[ijet1].btag_T);
+        //myjj.btag_ML = (jets[ijet1].btag_M && jets[ijet2].btag_L) || (jets[ijet2].btag_M && jets[ijet1].btag_L);
+        myjj.btag_MM = jets[ijet1].btag_M && jets[ijet2].btag_M;
+        //myjj.btag_MT = (jets[ijet1].btag_M && jets[ijet2].btag_T) || (jets[ijet2].btag_M && jets[ijet1].btag_T);
+        //myjj.btag_TL = (jets[ijet1].btag_T && jets[ijet2].btag_L) || (jets[ijet2].btag_T && jets[ijet1].btag_L);
+        //myjj.btag_TM = (jets[ijet1].btag_T && jets[ijet2].btag_M) || (jets[ijet2].btag_T && jets[ijet1].btag_M);
+        //myjj.btag_TT = jets[ijet1].btag_T && jets[ijet2].btag_T;
+        myjj.sumCSV = jets[ijet1].CSV + jets[ijet2].CSV;
+        myjj.sumCMVAv2 = jets[ijet1].CMVAv2 + jets[ijet2].CMVAv2;
+        myjj.DR_j_j = ROOT::Math::VectorUtil::DeltaR(jets[ijet1].p4, jets[ijet2].p4);
+        myjj.DPhi_j_j = fabs(ROOT::Math::VectorUtil::DeltaPhi(jets[ijet1].p4, jets[ijet2].p4));
+        myjj.ht_j_j = jets[ijet1].p4.Pt() + jets[ijet2].p4.Pt();
+        myjj.gen_matched_bbPartons = jets[ijet1].gen_matched_bParton && jets[ijet2].gen_matched_bParton; 
+        myjj.gen_matched_bbHadrons = jets[ijet1].gen_matched_bHadron && jets[ijet2].gen_matched_bHadron; 
+        myjj.gen_matched = jets[ijet1].gen_matched && jets[ijet2].gen_matched;
+        myjj.gen_p4 = myjj.gen_matched ? jets[ijet1].gen_p4 + jets[ijet2].gen_p4 : null_p4;
+        myjj.gen_DR = myjj.gen_matched ? ROOT::Math::VectorUtil::DeltaR(myjj.p4, myjj.gen_p4) : -1.;
+        myjj.gen_DPtOverPt = myjj.gen_matched ? (myjj.p4.Pt() - myjj.gen_p4.Pt()) / myjj.p4.Pt() : -10.;
+        myjj.gen_bb = (jets[ijet1].gen_b && jets[ijet2].gen_b);
+        myjj.gen_bc = (jets[ijet1].gen_b && jets[ijet2].gen_c) || (jets[ijet1].gen_c && jets[ijet2].gen_b);
+        myjj.gen_bl = (jets[ijet1].gen_b && jets[ijet2].gen_l) || (jets[ijet1].gen_l && jets[ijet2].gen_b);
+        myjj.gen_cc = (jets[ijet1].gen_c && jets[ijet2].gen_c);
+        myjj.gen_cl = (jets[ijet1].gen_c && jets[ijet2].gen_l) || (jets[ijet1].gen_l && jets[ijet2].gen_c);
+        myjj.gen_ll = (jets[ijet1].gen_l && jets[ijet2].gen_l);
+        jj.push_back(myjj);
+    };
+    for (const auto& pair: dijet_ranker.best(0))
+        add_dijet(pair.ijet1, pair.ijet2);
+    // Index in jj of the best pair of each ordering
+    std::array<size_t, HH::DijetRanking::Count> ranking_jj;
+    ranking_jj[0] = 0;
+    for (size_t i = 1; i < dijet_rankings.size() && !jj.empty(); i++) {
+        const HH::DijetRanker::Pair& best = dijet_ranker.best(i)[0];
+        auto it = std::find_if(jj.begin(), jj.end(), [&best](const HH::Dijet& dijet) { return static_cast<uint32_t>(dijet.ijet1) == best.ijet1 && static_cast<uint32_t>(dijet.ijet2) == best.ijet2; });
+        ranking_jj[i] = it - jj.begin();
+        if (it == jj.end())
+            add_dijet(best.ijet1, best.ijet2);
+    }
+
+    // At least one pair of b-tagged jets among the paired ones, whether it is kept or not
+    size_t n_pairing_btagM = std::count_if(jets.begin(), jets.begin() + n_pairing_jets, [](const HH::Jet& jet) { return jet.btag_M; });
+    bool has_btagMM_pair = n_pairing_btagM >= 2;
+    dijets_timer.stop();
+
+    // ********** 
+    // lljj, llbb, +met (each MET variant)
+    // ********** 
+    HH::StageTimer llmetjj_timer(timings, HH::Stage::Llmetjj);
+    for (unsigned int ill = 0; ill < ll.size(); ill++)
+    {
+        for (unsigned int ijj = 0; ijj < jj.size(); ijj++)
+        {
+            unsigned int ijet1 = jj[ijj].ijet1;
+            unsigned int ijet2 = jj[ijj].ijet2;
+            unsigned int ilep1 = ll[ill].ilep1;
+            unsigned int ilep2 = ll[ill].ilep2;
+            // Everything not depending on the MET, computed once and shared by the MET variants
+            HH::DileptonMetDijet mylljj;
+            mylljj.lep1_p4 = leptons[ilep1].p4;
+            mylljj.lep2_p4 = leptons[ilep2].p4;
+            mylljj.jet1_p4 = jets[ijet1].p4;
+            mylljj.jet2_p4 = jets[ijet2].p4;
+            mylljj.ll_p4 = ll[ill].p4;
+            mylljj.jj_p4 = jj[ijj].p4;
+            mylljj.lljj_p4 = ll[ill].p4 + jj[ijj].p4;
+            // gen info
+            mylljj.gen_lep1_p4 = leptons[ilep1].gen_p4;
+            mylljj.gen_lep2_p4 = leptons[ilep2].gen_p4;
+            mylljj.gen_jet1_p4 = jets[ijet1].gen_p4;
+            mylljj.gen_jet2_p4 = jets[ijet2].gen_p4;
+            mylljj.gen_ll_p4 = ll[ill].gen_p4;
+            mylljj.gen_jj_p4 = jj[ijj].gen_p4;
+            mylljj.gen_lljj_p4 = ll[ill].gen_p4 + jj[ijj].gen_p4;
+            // blind copy of the jj content
+            mylljj.ijet1 = jj[ijj].ijet1;
+            mylljj.ijet2 = jj[ijj].ijet2;
+            //mylljj.jid_LL = jj[ijj].jid_LL;
+            //mylljj.jid_TT = jj[ijj].jid_TT;
+            //mylljj.jid_TLVTLV = jj[ijj].jid_TLVTLV;
+            //mylljj.btag_LL = jj[ijj].btag_LL;
+            //mylljj.btag_LM = jj[ijj].btag_LM;
+            //mylljj.btag_LT = jj[ijj].btag_LT;
+            //mylljj.btag_ML = jj[ijj].btag_ML;
+            mylljj.btag_MM = jj[ijj].btag_MM;
+            //mylljj.btag_MT = jj[ijj].btag_MT;
+            //mylljj.btag_TL = jj[ijj].btag_TL;
+            //mylljj.btag_TM = jj[ijj].btag_TM;
+            //mylljj.btag_TT = jj[ijj].btag_TT;
+            mylljj.sumCSV = jj[ijj].sumCSV;
+            mylljj.sumCMVAv2 = jj[ijj].sumCMVAv2;
+            mylljj.DR_j_j = jj[ijj].DR_j_j;
+            mylljj.DPhi_j_j = jj[ijj].DPhi_j_j;
+            mylljj.ht_j_j = jj[ijj].ht_j_j;
+            mylljj.gen_matched_bbPartons = jj[ijj].gen_matched_bbPartons;
+            mylljj.gen_matched_bbHadrons = jj[ijj].gen_matched_bbHadrons;
+            mylljj.gen_bb = jj[ijj].gen_bb;
+            mylljj.gen_bc = jj[ijj].gen_bc;
+            mylljj.gen_bl = jj[ijj].gen_bl;
+            mylljj.gen_cc = jj[ijj].gen_cc;
+            mylljj.gen_cl = jj[ijj].gen_cl;
+            mylljj.gen_ll = jj[ijj].gen_ll;
+            // blind copy of the llmet content
+            mylljj.ilep1 = ll[ill].ilep1;
+            mylljj.ilep2 = ll[ill].ilep2;
+            mylljj.isOS = ll[ill].isOS;
+            mylljj.isPlusMinus = ll[ill].isPlusMinus;
+            mylljj.isMinusPlus = ll[ill].isMinusPlus;
+            mylljj.isMuMu = ll[ill].isMuMu;
+            mylljj.isElEl = ll[ill].isElEl;
+            mylljj.isElMu = ll[ill].isElMu;
+            mylljj.isMuEl = ll[ill].isMuEl;
+            mylljj.isSF = ll[ill].isSF;
+            //mylljj.id_LL = ll[ill].id_LL;
+            //mylljj.id_LM = ll[ill].id_LM;
+            //mylljj.id_LT = ll[ill].id_LT;
+            //mylljj.id_LHWW = ll[ill].id_LHWW;
+            //mylljj.id_ML = ll[ill].id_ML;
+            //mylljj.id_MM = ll[ill].id_MM;
+            //mylljj.id_MT = ll[ill].id_MT;
+            //mylljj.id_MHWW = ll[ill].id_MHWW;
+            //mylljj.id_TL = ll[ill].id_TL;
+            //mylljj.id_TM = ll[ill].id_TM;
+            //mylljj.id_TT = ll[ill].id_TT;
+            //mylljj.id_THWW = ll[ill].id_THWW;
+            //mylljj.id_HWWL = ll[ill].id_HWWL;
+            //mylljj.id_HWWM = ll[ill].id_HWWM;
+            //mylljj.id_HWWT = ll[ill].id_HWWT;
+            //mylljj.id_HWWHWW = ll[ill].id_HWWHWW;
+            //mylljj.iso_LL = ll[ill].iso_LL;
+            //mylljj.iso_LT = ll[ill].iso_LT;
+            //mylljj.iso_LHWW = ll[ill].iso_LHWW;
+            //mylljj.iso_TL = ll[ill].iso_TL;
+            //mylljj.iso_TT = ll[ill].iso_TT;
+            //mylljj.iso_THWW = ll[ill].iso_THWW;
+            //mylljj.iso_HWWL = ll[ill].iso_HWWL;
+            //mylljj.iso_HWWT = ll[ill].iso_HWWT;
+            //mylljj.iso_HWWHWW = ll[ill].iso_HWWHWW;
+            mylljj.DR_l_l = ll[ill].DR_l_l;
+            mylljj.DPhi_l_l = ll[ill].DPhi_l_l;
+            mylljj.ht_l_l = ll[ill].ht_l_l;
+            mylljj.trigger_efficiency = ll[ill].trigger_efficiency;
+            mylljj.trigger_efficiency_downVariated = ll[ill].trigger_efficiency_downVariated;
+            mylljj.trigger_efficiency_upVariated = ll[ill].trigger_efficiency_upVariated;
+            //mylljj.ill = ill;
+            // content specific to HH::DileptonMetDijet
+            //mylljj.illmet = illmet;
+            //mylljj.ijj = ijj;
+            float DR_j1l1, DR_j1l2, DR_j2l1, DR_j2l2;
+            DR_j1l1 = ROOT::Math::VectorUtil::DeltaR(jets[ijet1].p4, leptons[ilep1].p4);
+            DR_j1l2 = ROOT::Math::VectorUtil::DeltaR(jets[ijet1].p4, leptons[ilep2].p4);
+            DR_j2l1 = ROOT::Math::VectorUtil::DeltaR(jets[ijet2].p4, leptons[ilep1].p4);
+            DR_j2l2 = ROOT::Math::VectorUtil::DeltaR(jets[ijet2].p4, leptons[ilep2].p4);
+            mylljj.maxDR_l_j = std::max({DR_j1l1, DR_j1l2, DR_j2l1, DR_j2l2});
+            mylljj.minDR_l_j = std::min({DR_j1l1, DR_j1l2, DR_j2l1, DR_j2l2});
+            mylljj.DR_ll_jj = ROOT::Math::VectorUtil::DeltaR(ll[ill].p4, jj[ijj].p4);
+            mylljj.DPhi_ll_jj = fabs(ROOT::Math::VectorUtil::DeltaPhi(ll[ill].p4, jj[ijj].p4));
+            mylljj.visMelaAngles = getMELAAngles(ll[ill].p4, jj[ijj].p4, leptons[ilep1].p4, leptons[ilep2].p4, jets[ijet1].p4, jets[ijet2].p4); // only take the visible part of the H(ww) candidate
+
+            // Counters
+            tmp_cutflow[HH::CutFlow::has2leptons_1llmetjj] = event_weight;
+            if (mylljj.isElEl)
+                tmp_cutflow[HH::CutFlow::has2leptons_elel_1llmetjj] = event_weight;
+            if (mylljj.isElMu)
+                tmp_cutflow[HH::CutFlow::has2leptons_elmu_1llmetjj] = event_weight;
+            if (mylljj.isMuEl)
+                tmp_cutflow[HH::CutFlow::has2leptons_muel_1llmetjj] = event_weight;
+            if (mylljj.isMuMu)
+                tmp_cutflow[HH::CutFlow::has2leptons_mumu_1llmetjj] = event_weight;
+            if (has_btagMM_pair)
+            {
+                tmp_cutflow[HH::CutFlow::has2leptons_1llmetjj_2btagM] = event_weight;
+                if (mylljj.isElEl)
+                    tmp_cutflow[HH::CutFlow::has2leptons_elel_1llmetjj_2btagM] = event_weight;
+                if (mylljj.isElMu)
+                    tmp_cutflow[HH::CutFlow::has2leptons_elmu_1llmetjj_2btagM] = event_weight;
+                if (mylljj.isMuEl)
+                    tmp_cutflow[HH::CutFlow::has2leptons_muel_1llmetjj_2btagM] = event_weight;
+                if (mylljj.isMuMu)
+                    tmp_cutflow[HH::CutFlow::has2leptons_mumu_1llmetjj_2btagM] = event_weight;
+            }
+
+            for (unsigned int imet = 0; imet < met.size(); imet++)
+            {
+                // llmet holds the dileptons of each MET variant in turn
+                unsigned int illmet = imet * ll.size() + ill;
+                HH::DileptonMetDijet myllmetjj = mylljj;
+                myllmetjj.p4 = ll[ill].p4 + jj[ijj].p4 + met[imet].p4;
+                myllmetjj.met_p4 = met[imet].p4;
+                myllmetjj.gen_matched = ll[ill].gen_matched && jj[ijj].gen_matched && met[imet].gen_matched;
+                myllmetjj.gen_p4 = myllmetjj.gen_matched ? ll[ill].gen_p4 + jj[ijj].gen_p4 + met[imet].gen_p4 : null_p4;
+                myllmetjj.gen_DR = myllmetjj.gen_matched ? ROOT::Math::VectorUtil::DeltaR(myllmetjj.p4, myllmetjj.gen_p4) : -1.;
+                myllmetjj.gen_DPhi = myllmetjj.gen_matched ? fabs(ROOT::Math::VectorUtil::DeltaPhi(myllmetjj.p4, myllmetjj.gen_p4)) : -1.;
+                myllmetjj.gen_DPtOverPt = myllmetjj.gen_matched ? (myllmetjj.p4.Pt() - myllmetjj.gen_p4.Pt()) / myllmetjj.p4.Pt() : -10.;
+                myllmetjj.gen_met_p4 = met[imet].gen_p4;
+                myllmetjj.imet = imet;
+                myllmetjj.isNoHF = met[imet].isNoHF;
+                myllmetjj.DPhi_ll_met = llmet[illmet].DPhi_ll_met;
+                myllmetjj.minDPhi_l_met = llmet[illmet].minDPhi_l_met; 
+                myllmetjj.maxDPhi_l_met = llmet[illmet].maxDPhi_l_met;
+                myllmetjj.MT = llmet[illmet].MT;
+                myllmetjj.MT_formula = llmet[illmet].MT_formula;
+                myllmetjj.projectedMet = llmet[illmet].projectedMet;
+                // content specific to HH::DijetMet
+                // NB: computed for the first time here, no intermediate jjmet collection
+                myllmetjj.DPhi_jj_met = fabs(ROOT::Math::VectorUtil::DeltaPhi(jj[ijj].p4, met[imet].p4));
+                myllmetjj.minDPhi_j_met = std::min(fabs(ROOT::Math::VectorUtil::DeltaPhi(jets[jj[ijj].ijet1].p4, met[imet].p4)), fabs(ROOT::Math::VectorUtil::DeltaPhi(jets[jj[ijj].ijet2].p4, met[imet].p4)));
+                myllmetjj.maxDPhi_j_met = std::max(fabs(ROOT::Math::VectorUtil::DeltaPhi(jets[jj[ijj].ijet1].p4, met[imet].p4)), fabs(ROOT::Math::VectorUtil::DeltaPhi(jets[jj[ijj].ijet2].p4, met[imet].p4)));
+                myllmetjj.DR_llmet_jj = ROOT::Math::VectorUtil::DeltaR(llmet[illmet].p4, jj[ijj].p4);
+                myllmetjj.DPhi_llmet_jj = fabs(ROOT::Math::VectorUtil::DeltaPhi(llmet[illmet].p4, jj[ijj].p4));
+                myllmetjj.cosThetaStar_CS = fabs(getCosThetaStar_CS(llmet[illmet].p4, jj[ijj].p4));
+                myllmetjj.MT_fullsystem = myllmetjj.p4.Mt();
+                myllmetjj.melaAngles = getMELAAngles(llmet[illmet].p4, jj[ijj].p4, leptons[ilep1].p4, leptons[ilep2].p4, jets[ijet1].p4, jets[ijet2].p4);
+                // Compute MT2. See https://arxiv.org/pdf/1309.6318v1.pdf and https://arxiv.org/pdf/1411.4312v5.pdf
+                double px_invisible = myllmetjj.lep1_p4.px() + myllmetjj.lep2_p4.px() + myllmetjj.met_p4.px();
+                double py_invisible = myllmetjj.lep1_p4.py() + myllmetjj.lep2_p4.py() + myllmetjj.met_p4.py();
+                myllmetjj.MT2 = asymm_mt2_lester_bisect::get_mT2(
+                        myllmetjj.jet1_p4.M(), myllmetjj.jet1_p4.px(), myllmetjj.jet1_p4.py(),
+                        myllmetjj.jet2_p4.M(), myllmetjj.jet2_p4.px(), myllmetjj.jet2_p4.py(),
+                        px_invisible, py_invisible,
+                        myllmetjj.lep1_p4.M(), myllmetjj.lep2_p4.M(),
+                        0.5 // Absolute precision
+                        );
+                // Fill
+                llmetjj.push_back(myllmetjj);
+            }
+        }
+    }
+
+    // Keep, for each ordering, the candidates of ll[0] and of its best pair with each MET variant: llmetjj[0, met.size())
+    // use the best cmva pair, jj[0], then come those of the other dijetRankings. The candidates are built for each ll,
+    // then each jj, then each MET, so the one of (ll[0], jj[ijj], met[imet]) is llmetjj[ijj * met.size() + imet]
+    llmetjj_ranking.clear();
+    if (!llmetjj.empty()) {
+        size_t n_met = met.size();
+        size_t n_candidates = llmetjj.size();
+        llmetjj.reserve(n_candidates + (dijet_rankings.size() - 1) * n_met);
+        for (size_t i = 1; i < dijet_rankings.size(); i++) {
+            for (size_t imet = 0; imet < n_met; imet++)
+                llmetjj.push_back(llmetjj[ranking_jj[i] * n_met + imet]);
+        }
+        std::move(llmetjj.begin() + n_candidates, llmetjj.end(), llmetjj.begin() + n_met);
+        llmetjj.resize(dijet_rankings.size() * n_met);
+
+        for (size_t i = 0; i < dijet_rankings.size(); i++)
+            llmetjj_ranking.insert(llmetjj_ranking.end(), n_met, dijet_rankings[i]);
+    }
+    llmetjj_timer.stop();
+
+    // ***** ***** *****
+    // Event variables
+    // ***** ***** *****
+
+    // HT: the two selected leptons - if present - plus all selected jets
+    HT = 0;
+    if (llmetjj.size() > 0)
+        HT += llmetjj[0].lep1_p4.Pt() + llmetjj[0].lep2_p4.Pt();
+    for (unsigned int ijet = 0; ijet < jets.size(); ijet++) {
+        HT += jets[ijet].p4.Pt();
+    }
+
+    nJetsL = jets.size();
+    if (! doingSystematics()) {
+        nBJetsM = 0;
+        for (unsigned int ijet = 0; ijet < jets.size(); ijet++) {
+            if (jets[ijet].btag_M)
+                nBJetsM++;
+        }
+
+        nMuonsT = 0;
+        nElectronsM = 0;
+        for (unsigned int ilepton = 0; ilepton < leptons.size(); ilepton++)
+        {
+            if (leptons[ilepton].isMu) {
+                nMuonsT++;
+            }
+
+            if (leptons[ilepton].isEl) {
+                nElectronsM++;
+            }
+        }
+
+        m_cutflow += tmp_cutflow;
+    }
+
+    event_statistics.multiplicities[HH::EventStatistics::Leptons].add(leptons.size());
+    event_statistics.multiplicities[HH::EventStatistics::Jets].add(jets.size());
+    event_statistics.multiplicities[HH::EventStatistics::Ll].add(ll.size());
+    event_statistics.multiplicities[HH::EventStatistics::Jj].add(dijet_ranker.pairs());
+    event_statistics.multiplicities[HH::EventStatistics::Llmetjj].add(llmetjj.size());
+
+    if (memory)
+        memory->observe(leptons, jets, ll, jj, llmetjj);
+
+    if (m_config->output_mode == HH::OutputMode::Flat)
+        m_flat_writer->fill(leptons, jets, met, llmetjj);
+
+    size_t category = (!m_config->histograms.empty() || m_skim_writer) ? selectedCategory() : NO_CATEGORY;
+
+    if (!m_config->histograms.empty() && category != NO_CATEGORY)
+        m_histograms.fill(category, llmetjj[0], event_weight);
+
+    if (m_config->cut_scan.enabled() && !ll.empty()) {
+        size_t flavour = ll[0].isElEl ? 0 : ll[0].isElMu ? 1 : ll[0].isMuEl ? 2 : 3;
+        m_cut_scan.fill(flavour, leptons[ll[0].ilep1], leptons[ll[0].ilep2], leptons, jets, n_pairing_jets, alljets.bDiscr, event_weight * ll[0].trigger_efficiency);
+    }
+
+    if (m_skim_writer && category != NO_CATEGORY && m_skim_streams[category] != NO_SKIM_STREAM)
+        m_skim_writer->fill(m_skim_streams[category], inputs.run, inputs.lumi, inputs.event, event_weight, leptons, jets, met, llmetjj);
+
+    if (m_records_writer && !llmetjj.empty())
+        m_records_writer->write(m_records_analyzer, inputs.run, inputs.lumi, inputs.event, event_weight, leptons, jets, met, llmetjj);
+
+
+    if (fill_truth)
+    {
+// ***** ***** *****
+// Get the MC truth information on the hard process
+// ***** ***** *****
+// from https://github.com/cms-sw/cmssw/blob/CMSSW_7_4_X/DataFormats/HepMCCandidate/interface/GenStatusFlags.h
+//    enum StatusBits {
+//0      kIsPrompt = 0,
+//1      kIsDecayedLeptonHadron,
+//2      kIsTauDecayProduct,
+//3      kIsPromptTauDecayProduct,
+//4      kIsDirectTauDecayProduct,
+//5      kIsDirectPromptTauDecayProduct,
+//6      kIsDirectHadronDecayProduct,
+//7      kIsHardProcess,
+//8      kFromHardProcess,
+//9      kIsHardProcessTauDecayProduct,
+//10      kIsDirectHardProcessTauDecayProduct,
+//11      kFromHardProcessBeforeFSR,
+//12      kIsFirstCopy,
+//13      kIsLastCopy,
+//14      kIsLastCopyBeforeFSR
+//    };
+
+
+    // TTBAR MC TRUTH
+    HH::StageTimer ttbar_truth_timer(timings, HH::Stage::TTbarTruth);
+    const HH::EventInputs::GenParticles& gen_particles = inputs.gen_particles;
+
+    // 'Pruned' particles are from the hard process
+    // 'Packed' particles are stable particles
+
+#if TT_GEN_DEBUG
+    std::function<void(size_t)> print_mother_chain = [&gen_particles, &print_mother_chain](size_t p) {
+
+        if (gen_particles.pruned_mothers_index[p].empty()) {
+            std::cout << std::endl;
+            return;
+        }
+
+        size_t index = gen_particles.pruned_mothers_index[p][0];
+            std::cout << " <- #" << index << "(" << gen_particles.pruned_pdg_id[index] << ")";
+            print_mother_chain(index);
+    };
+#endif
+
+        std::function<bool(size_t, size_t)> pruned_decays_from = [&pruned_decays_from, &gen_particles](size_t particle_index, size_t mother_index) -> bool {
+            // Iterator over all pruned particles to find if the particle `particle_index` has `mother_index` in its decay history
+            if (gen_particles.pruned_mothers_index[particle_index].empty())
+                return false;
+
+            size_t index = gen_particles.pruned_mothers_index[particle_index][0];
+
+            if (index == mother_index) {
+                return true;
+            }
+
+            if (pruned_decays_from(index, mother_index))
+                return true;
+
+            return false;
+        };
+
+#define ASSIGN_INDEX( X ) \
+    if (flags.isLastCopy()) { \
+        gen_##X = i; \
+    }\
+    if (flags.isFirstCopy()) { \
+        gen_##X##_beforeFSR = i; \
+    }
+
+// Assign index to X if it's empty, or Y if not
+#define ASSIGN_INDEX2(X, Y, ERROR) \
+    if (flags.isLastCopy()) { \
+        if (gen_##X == 0) \
+            gen_##X = i; \
+        else if (gen_##Y == 0)\
+            gen_##Y = i; \
+        else \
+            std::cout << ERROR << std::endl; \
+    } \
+    if (flags.isFirstCopy()) { \
+        if (gen_##X##_beforeFSR == 0) \
+            gen_##X##_beforeFSR = i; \
+        else if (gen_##Y##_beforeFSR == 0)\
+            gen_##Y##_beforeFSR = i; \
+        else \
+            std::cout << ERROR << std::endl; \
+    }
+
+    gen_t = 0; // Index of the top quark
+    gen_t_beforeFSR = 0; // Index of the top quark, before any FSR
+    gen_tbar = 0; // Index of the anti-top quark
+    gen_tbar_beforeFSR = 0; // Index of the anti-top quark, before any FSR
+
+    gen_b = 0; // Index of the b quark coming from the top decay
+    gen_b_beforeFSR = 0; // Index of the b quark coming from the top decay, before any FSR
+    gen_bbar = 0; // Index of the anti-b quark coming from the anti-top decay
+    gen_bbar_beforeFSR = 0; // Index of the anti-b quark coming from the anti-top decay, before any FSR
+
+    gen_jet1_t = 0; // Index of the first jet from the top decay chain
+    gen_jet1_t_beforeFSR = 0; // Index of the first jet from the top decay chain, before any FSR
+    gen_jet2_t = 0; // Index of the second jet from the top decay chain
+    gen_jet2_t_beforeFSR = 0; // Index of the second jet from the top decay chain, before any FSR
+
+    gen_jet1_tbar = 0; // Index of the first jet from the anti-top decay chain
+    gen_jet1_tbar_beforeFSR = 0; // Index of the first jet from the anti-top decay chain, before any FSR
+    gen_jet2_tbar = 0; // Index of the second jet from the anti-top decay chain
+    gen_jet2_tbar_beforeFSR = 0; // Index of the second jet from the anti-top decay chain, before any FSR
+
+    gen_lepton_t = 0; // Index of the lepton from the top decay chain
+    gen_lepton_t_beforeFSR = 0; // Index of the lepton from the top decay chain, before any FSR
+    gen_neutrino_t = 0; // Index of the neutrino from the top decay chain
+    gen_neutrino_t_beforeFSR = 0; // Index of the neutrino from the top decay chain, before any FSR
+
+    gen_lepton_tbar = 0; // Index of the lepton from the anti-top decay chain
+    gen_lepton_tbar_beforeFSR = 0; // Index of the lepton from the anti-top decay chain, before any FSR
+    gen_neutrino_tbar = 0; // Index of the neutrino from the anti-top decay chain
+    gen_neutrino_tbar_beforeFSR = 0; // Index of the neutrino from the anti-top decay chain, before any FSR
+    if (m_ttbar_truth_scan->enabled()) {
+        for (size_t i = 0; i < gen_particles.pruned_pdg_id.size(); i++) {
+
+            int16_t pdg_id = gen_particles.pruned_pdg_id[i];
+            uint16_t a_pdg_id = std::abs(pdg_id);
+
+            // We only care of particles with PDG id <= 16 (16 is neutrino tau)
+            if (a_pdg_id > 16)
+                continue;
+
+            GenStatusFlags flags(gen_particles.pruned_status_flags[i]);
+
+            if (! flags.isLastCopy() && ! flags.isFirstCopy())
+                continue;
+
+            if (! flags.fromHardProcess())
+                continue;
+
+#if TT_GEN_DEBUG
+            std::cout << "---" << std::endl;
+            std::cout << "Gen particle #" << i << ": PDG id: " << gen_particles.pruned_pdg_id[i];
+            print_mother_chain(i);
+            flags.dump();
+#endif
+
+            if (pdg_id == 6) {
+                ASSIGN_INDEX(t);
+                continue;
+            } else if (pdg_id == -6) {
+                ASSIGN_INDEX(tbar);
+                continue;
+            }
+
+            if (gen_t == 0 || gen_tbar == 0) {
+                // Don't bother if we don't have found the tops
+                continue;
+            }
+
+            bool from_t_decay = pruned_decays_from(i, gen_t);
+            bool from_tbar_decay = pruned_decays_from(i, gen_tbar);
+
+            // Only keep particles coming from the tops decay
+            if (! from_t_decay && ! from_tbar_decay)
+                continue;
+
+            if (pdg_id == 5) {
+                // Maybe it's a b coming from the W decay
+                if (!flags.isFirstCopy() && flags.isLastCopy() && gen_b == 0) {
+
+                    // This can be a B decaying from a W
+                    // However, we can't rely on the presence of the W in the decay chain, as it may be generator specific
+                    // Since it's the last copy (ie, after FSR), we can check if this B comes from the B assigned to the W decay (ie, gen_jet1_t_beforeFSR, gen_jet2_t_beforeFSR)
+                    // If yes, then it's not the B coming directly from the top decay
+                    if ((gen_jet1_t_beforeFSR != 0 && std::abs(gen_particles.pruned_pdg_id[gen_jet1_t_beforeFSR]) == 5) ||
+                        (gen_jet2_t_beforeFSR != 0 && std::abs(gen_particles.pruned_pdg_id[gen_jet2_t_beforeFSR]) == 5) ||
+                        (gen_jet1_tbar_beforeFSR != 0 && std::abs(gen_particles.pruned_pdg_id[gen_jet1_tbar_beforeFSR]) == 5) ||
+                        (gen_jet2_tbar_beforeFSR != 0 && std::abs(gen_particles.pruned_pdg_id[gen_jet2_tbar_beforeFSR]) == 5)) {
+
+#if TT_GEN_DEBUG
+                        std::cout << "A quark coming from W decay is a b" << std::endl;
+#endif
+
+                        if (! (gen_jet1_tbar_beforeFSR != 0 && pruned_decays_from(i, gen_jet1_tbar_beforeFSR)) &&
+                            ! (gen_jet2_tbar_beforeFSR != 0 && pruned_decays_from(i, gen_jet2_tbar_beforeFSR)) &&
+                            ! (gen_jet1_t_beforeFSR != 0 && pruned_decays_from(i, gen_jet1_t_beforeFSR)) &&
+                            ! (gen_jet2_t_beforeFSR != 0 && pruned_decays_from(i, gen_jet2_t_beforeFSR))) {
+#if TT_GEN_DEBUG
+                            std::cout << "This after-FSR b quark is not coming from a W decay" << std::endl;
+#endif
+                            gen_b = i;
+                            continue;
+                        }
+#if TT_GEN_DEBUG
+                        else {
+                            std::cout << "This after-FSR b quark comes from a W decay" << std::endl;
+                        }
+#endif
+                    } else {
+#if TT_GEN_DEBUG
+                        std::cout << "Assigning gen_b" << std::endl;
+#endif
+                        gen_b = i;
+                        continue;
+                    }
+                } else if (flags.isFirstCopy() && gen_b_beforeFSR == 0) {
+                    gen_b_beforeFSR = i;
+                    continue;
+                } else {
+#if TT_GEN_DEBUG
+                    std::cout << "This should not happen!" << std::endl;
+#endif
+                }
+            } else if (pdg_id == -5) {
+                if (!flags.isFirstCopy() && flags.isLastCopy() && gen_bbar == 0) {
+
+                    // This can be a B decaying from a W
+                    // However, we can't rely on the presence of the W in the decay chain, as it may be generator specific
+                    // Since it's the last copy (ie, after FSR), we can check if this B comes from the B assigned to the W decay (ie, gen_jet1_t_beforeFSR, gen_jet2_t_beforeFSR)
+                    // If yes, then it's not the B coming directly from the top decay
+                    if ((gen_jet1_t_beforeFSR != 0 && std::abs(gen_particles.pruned_pdg_id[gen_jet1_t_beforeFSR]) == 5) ||
+                        (gen_jet2_t_beforeFSR != 0 && std::abs(gen_particles.pruned_pdg_id[gen_jet2_t_beforeFSR]) == 5) ||
+                        (gen_jet1_tbar_beforeFSR != 0 && std::abs(gen_particles.pruned_pdg_id[gen_jet1_tbar_beforeFSR]) == 5) ||
+                        (gen_jet2_tbar_beforeFSR != 0 && std::abs(gen_particles.pruned_pdg_id[gen_jet2_tbar_beforeFSR]) == 5)) {
+
+#if TT_GEN_DEBUG
+                        std::cout << "A quark coming from W decay is a bbar" << std::endl;
+#endif
+
+                        if (! (gen_jet1_tbar_beforeFSR != 0 && pruned_decays_from(i, gen_jet1_tbar_beforeFSR)) &&
+                            ! (gen_jet2_tbar_beforeFSR != 0 && pruned_decays_from(i, gen_jet2_tbar_beforeFSR)) &&
+                            ! (gen_jet1_t_beforeFSR != 0 && pruned_decays_from(i, gen_jet1_t_beforeFSR)) &&
+                            ! (gen_jet2_t_beforeFSR != 0 && pruned_decays_from(i, gen_jet2_t_beforeFSR))) {
+#if TT_GEN_DEBUG
+                            std::cout << "This after-fsr b anti-quark is not coming from a W decay" << std::endl;
+#endif
+                            gen_bbar = i;
+                            continue;
+                        }
+#if TT_GEN_DEBUG
+                        else {
+                            std::cout << "This after-fsr b anti-quark comes from a W decay" << std::endl;
+                        }
+#endif
+                    } else {
+#if TT_GEN_DEBUG
+                        std::cout << "Assigning gen_bbar" << std::endl;
+#endif
+                        gen_bbar = i;
+                        continue;
+                    }
+                } else if (flags.isFirstCopy() && gen_bbar_beforeFSR == 0) {
+                    gen_bbar_beforeFSR = i;
+                    continue;
+                }
+            }
+
+            if ((gen_tbar == 0) || (gen_t == 0))
+                continue;
+
+            if (gen_t != 0 && from_t_decay) {
+#if TT_GEN_DEBUG
+            std::cout << "Coming from the top chain decay" << std::endl;
+#endif
+                if (a_pdg_id >= 1 && a_pdg_id <= 5) {
+                    ASSIGN_INDEX2(jet1_t, jet2_t, "Error: more than two quarks coming from top decay");
+                } else if (a_pdg_id == 11 || a_pdg_id == 13 || a_pdg_id == 15) {
+                    ASSIGN_INDEX(lepton_t);
+                } else if (a_pdg_id == 12 || a_pdg_id == 14 || a_pdg_id == 16) {
+                    ASSIGN_INDEX(neutrino_t);
+                } else {
+                    std::cout << "Error: unknown particle coming from top decay - #" << i << " ; PDG Id: " << pdg_id << std::endl;
+                }
+            } else if (gen_tbar != 0 && from_tbar_decay) {
+#if TT_GEN_DEBUG
+            std::cout << "Coming from the anti-top chain decay" << std::endl;
+#endif
+                if (a_pdg_id >= 1 && a_pdg_id <= 5) {
+                    ASSIGN_INDEX2(jet1_tbar, jet2_tbar, "Error: more than two quarks coming from anti-top decay");
+                } else if (a_pdg_id == 11 || a_pdg_id == 13 || a_pdg_id == 15) {
+                    ASSIGN_INDEX(lepton_tbar);
+                } else if (a_pdg_id == 12 || a_pdg_id == 14 || a_pdg_id == 16) {
+                    ASSIGN_INDEX(neutrino_tbar);
+                } else {
+                    std::cout << "Error: unknown particle coming from anti-top decay - #" << i << " ; PDG Id: " << pdg_id << std::endl;
+                }
+            }
+        }
+
+        m_ttbar_truth_scan->observe(gen_t && gen_tbar);
+    }
+
+    if (!gen_t || !gen_tbar) {
+#if TT_GEN_DEBUG
+        std::cout << "This is not a ttbar event" << std::endl;
+#endif
+        gen_ttbar_decay_type = NotTT;
+        return;
+    }
+
+    if ((gen_jet1_t != 0) && (gen_jet2_t != 0) && (gen_jet1_tbar != 0) && (gen_jet2_tbar != 0)) {
+#if TT_GEN_DEBUG
+        std::cout << "Hadronic ttbar decay" << std::endl;
+#endif
+        gen_ttbar_decay_type = Hadronic;
+    } else if (
+            ((gen_lepton_t != 0) && (gen_lepton_tbar == 0)) ||
+            ((gen_lepton_t == 0) && (gen_lepton_tbar != 0))
+            ) {
+
+#if TT_GEN_DEBUG
+        std::cout << "Semileptonic ttbar decay" << std::endl;
+#endif
+
+        uint16_t lepton_pdg_id;
+        if (gen_lepton_t != 0)
+            lepton_pdg_id = std::abs(gen_particles.pruned_pdg_id[gen_lepton_t]);
+        else
+            lepton_pdg_id = std::abs(gen_particles.pruned_pdg_id[gen_lepton_tbar]);
+
+        if (lepton_pdg_id == 11)
+            gen_ttbar_decay_type = Semileptonic_e;
+        else if (lepton_pdg_id == 13)
+            gen_ttbar_decay_type = Semileptonic_mu;
+        else
+            gen_ttbar_decay_type = Semileptonic_tau;
+    } else if (gen_lepton_t != 0 && gen_lepton_tbar != 0) {
+        uint16_t lepton_t_pdg_id = std::abs(gen_particles.pruned_pdg_id[gen_lepton_t]);
+        uint16_t lepton_tbar_pdg_id = std::abs(gen_particles.pruned_pdg_id[gen_lepton_tbar]);
+
+#if TT_GEN_DEBUG
+        std::cout << "Dileptonic ttbar decay" << std::endl;
+#endif
+
+        if (lepton_t_pdg_id == 11 && lepton_tbar_pdg_id == 11)
+            gen_ttbar_decay_type = Dileptonic_ee;
+        else if (lepton_t_pdg_id == 13 && lepton_tbar_pdg_id == 13)
+            gen_ttbar_decay_type = Dileptonic_mumu;
+        else if (lepton_t_pdg_id == 15 && lepton_tbar_pdg_id == 15)
+            gen_ttbar_decay_type = Dileptonic_tautau;
+        else if (
+                (lepton_t_pdg_id == 11 && lepton_tbar_pdg_id == 13) ||
+                (lepton_t_pdg_id == 13 && lepton_tbar_pdg_id == 11)
+                ) {
+            gen_ttbar_decay_type = Dileptonic_mue;
+        }
+        else if (
+                (lepton_t_pdg_id == 11 && lepton_tbar_pdg_id == 15) ||
+                (lepton_t_pdg_id == 15 && lepton_tbar_pdg_id == 11)
+                ) {
+            gen_ttbar_decay_type = Dileptonic_etau;
+        }
+        else if (
+                (lepton_t_pdg_id == 13 && lepton_tbar_pdg_id == 15) ||
+                (lepton_t_pdg_id == 15 && lepton_tbar_pdg_id == 13)
+                ) {
+            gen_ttbar_decay_type = Dileptonic_mutau;
+        } else {
+            std::cout << "Error: unknown dileptonic ttbar decay." << std::endl;
+            gen_ttbar_decay_type = NotTT;
+            return;
+        }
+    } else {
+        std::cout << "Error: unknown ttbar decay." << std::endl;
+        gen_ttbar_decay_type = UnknownTT;
+    }
+    } // end of if !inputs.isRealData
+
+}
+
+HH::StageTimings* HHAnalyzer::stageTimings(uint64_t event) {
+    if (!m_config->stageInstrumentation())
+        return nullptr;
+
+    m_stage_timings.trace = nullptr;
+    if (m_trace_track && event % m_config->trace_sampling == 0) {
+        m_stage_timings.trace = m_trace_track.get();
+        m_stage_timings.trace->event = event;
+    }
+
+    return &m_stage_timings;
+}
+
+HH::StageTimings HHAnalyzer::stageTimings() const {
+    return m_stage_timings;
+}
+
+HH::MemoryStats HHAnalyzer::memoryStats() const {
+    return m_memory_stats;
+}
+
+void HHAnalyzer::endJob(MetadataManager& metadata) {
+
+    if (! doingSystematics()) {
+        for (size_t step = 0; step < HH::CutFlow::Count; step++)
+            metadata.add(this->m_name + "_count_" + HH::CutFlow::names[step], m_cutflow.counts[step]);
+    }
+
+    const HH::EventStatistics& event_statistics = m_event_statistics;
+
+    std::cout << "Combinatorics and time per event of " << this->m_name << ":" << std::endl;
+    event_statistics.report(std::cout);
+
+    for (size_t i = 0; i < HH::EventStatistics::Count; i++) {
+        const std::string prefix = this->m_name + "_n_" + HH::EventStatistics::names[i];
+        metadata.add(prefix + "_p99", static_cast<float>(event_statistics.multiplicities[i].quantile(0.99)));
+        metadata.add(prefix + "_max", static_cast<float>(event_statistics.multiplicities[i].max()));
+    }
+    metadata.add(this->m_name + "_event_time_p99_ns", static_cast<float>(event_statistics.time.quantile(0.99)));
+    metadata.add(this->m_name + "_event_time_max_ns", static_cast<float>(event_statistics.time.max()));
+    metadata.add(this->m_name + "_jets_pairing_capped_events", static_cast<float>(event_statistics.capped_events));
+    metadata.add(this->m_name + "_truth_skipped_events", static_cast<float>(event_statistics.truth_skipped_events));
+    if (m_slow_events_writer)
+        metadata.add(this->m_name + "_slow_events", static_cast<float>(event_statistics.slow_events));
+
+    if (m_config->stage_timers) {
+        HH::StageTimings stage_timings = stageTimings();
+
+        std::cout << "Time spent in the stages of " << this->m_name << ":" << std::endl;
+        stage_timings.report(std::cout);
+
+        for (size_t i = 0; i < HH::Stage::Count; i++) {
+            const HH::DurationHistogram& stage = stage_timings.stages[i];
+            const std::string prefix = this->m_name + "_time_" + HH::Stage::names[i];
+            metadata.add(prefix + "_count", static_cast<float>(stage.count()));
+            metadata.add(prefix + "_mean_ns", static_cast<float>(stage.mean()));
+            metadata.add(prefix + "_p50_ns", static_cast<float>(stage.quantile(0.5)));
+            metadata.add(prefix + "_p99_ns", static_cast<float>(stage.quantile(0.99)));
+            metadata.add(prefix + "_max_ns", static_cast<float>(stage.max()));
+        }
+    }
+
+    if (m_config->memory_report) {
+        HH::StageTimings stage_timings = stageTimings();
+        HH::MemoryStats memory_stats = memoryStats();
+
+        std::cout << "Heap allocations in the stages of " << this->m_name << ":" << std::endl;
+        stage_timings.reportAllocations(std::cout);
+        memory_stats.report(std::cout);
+
+        for (size_t i = 0; i < HH::Stage::Count; i++) {
+            uint64_t count = stage_timings.stages[i].count();
+            metadata.add(this->m_name + "_allocations_" + HH::Stage::names[i], count ? static_cast<float>(stage_timings.allocations[i].allocations) / count : 0.f);
+        }
+        if (memory_stats.steady_state_events) {
+            metadata.add(this->m_name + "_allocations_per_event", static_cast<float>(memory_stats.steady_state.allocations) / memory_stats.steady_state_events);
+            metadata.add(this->m_name + "_allocated_bytes_per_event", static_cast<float>(memory_stats.steady_state.bytes) / memory_stats.steady_state_events);
+        }
+        for (size_t i = 0; i < HH::MemoryStats::CollectionCount; i++)
+            metadata.add(this->m_name + "_peak_capacity_" + HH::MemoryStats::collection_names[i], static_cast<float>(memory_stats.peak_capacity[i]));
+    }
+
+    if (m_config->cut_scan.enabled()) {
+        m_cut_scan.write(m_config->cut_scan.file, this->m_name);
+    }
+
+    if (!m_config->histograms.empty()) {
+        m_histograms.write(m_config->histograms_file, this->m_name);
+    }
+
+    if (m_skim_writer) {
+        for (size_t category = 0; category < m_skim_streams.size(); category++) {
+            if (m_skim_streams[category] != NO_SKIM_STREAM)
+                metadata.add(this->m_name + "_skim_" + HH::SkimConfiguration::categories[category] + "_events", static_cast<float>(m_skim_writer->entries(m_skim_streams[category])));
+        }
+    }
+
+    if (m_config->output_mode == HH::OutputMode::Flat) {
+        std::cout << "Flat output of " << this->m_name << ", uncompressed bytes per branch before and after the output policy, and estimate"
+            << " with the reduced-precision floats at their significant bits (not measured: see hhReplay --memory for the compressed bytes):" << std::endl;
+        m_flat_writer->report(std::cout);
+        metadata.add(this->m_name + "_output_bytes_before_policy", static_cast<float>(m_flat_writer->bytesBefore()));
+        metadata.add(this->m_name + "_output_bytes_after_policy", static_cast<float>(m_flat_writer->bytesAfter()));
+        metadata.add(this->m_name + "_output_estimated_bytes_after_policy", static_cast<float>(m_flat_writer->estimatedBytes()));
+    }
+}
@@ -0,0 +1,181 @@
+#include <cp3_llbb/HHAnalysis/interface/Histograms.h>
+
+#include <FWCore/ParameterSet/interface/ParameterSet.h>
+#include <FWCore/Utilities/interface/EDMException.h>
+
+#include <TFile.h>
+#include <TH1D.h>
+#include <TH2D.h>
+
+#include <cmath>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+
+namespace {
+
+#define HH_P4_VARIABLES(NAME, FIELD) \
+    {NAME "pt", [](const HH::DileptonMetDijet& c) -> float { return c.FIELD.Pt(); }}, \
+    {NAME "eta", [](const HH::DileptonMetDijet& c) -> float { return c.FIELD.Eta(); }}, \
+    {NAME "phi", [](const HH::DileptonMetDijet& c) -> float { return c.FIELD.Phi(); }}, \
+    {NAME "M", [](const HH::DileptonMetDijet& c) -> float { return c.FIELD.M(); }}
+
+#define HH_VARIABLE(FIELD) \
+    {#FIELD, [](const HH::DileptonMetDijet& c) -> float { return c.FIELD; }}
+
+    const std::map<std::string, HH::CandidateVariable> s_variables = {
+        HH_P4_VARIABLES("", p4),
+        HH_P4_VARIABLES("lep1_", lep1_p4),
+        HH_P4_VARIABLES("lep2_", lep2_p4),
+        HH_P4_VARIABLES("jet1_", jet1_p4),
+        HH_P4_VARIABLES("jet2_", jet2_p4),
+        HH_P4_VARIABLES("met_", met_p4),
+        HH_P4_VARIABLES("ll_", ll_p4),
+        HH_P4_VARIABLES("jj_", jj_p4),
+        HH_P4_VARIABLES("lljj_", lljj_p4),
+        HH_VARIABLE(DR_l_l), HH_VARIABLE(DPhi_l_l), HH_VARIABLE(ht_l_l),
+        HH_VARIABLE(DR_j_j), HH_VARIABLE(DPhi_j_j), HH_VARIABLE(ht_j_j),
+        HH_VARIABLE(sumCSV), HH_VARIABLE(sumCMVAv2),
+        HH_VARIABLE(DPhi_ll_met), HH_VARIABLE(minDPhi_l_met), HH_VARIABLE(maxDPhi_l_met),
+        HH_VARIABLE(MT), HH_VARIABLE(MT_formula), HH_VARIABLE(projectedMet),
+        HH_VARIABLE(DPhi_jj_met), HH_VARIABLE(minDPhi_j_met), HH_VARIABLE(maxDPhi_j_met),
+        HH_VARIABLE(minDR_l_j), HH_VARIABLE(maxDR_l_j),
+        HH_VARIABLE(DR_ll_jj), HH_VARIABLE(DPhi_ll_jj), HH_VARIABLE(DR_llmet_jj), HH_VARIABLE(DPhi_llmet_jj),
+        HH_VARIABLE(cosThetaStar_CS), HH_VARIABLE(MT_fullsystem), HH_VARIABLE(MT2),
+        HH_VARIABLE(trigger_efficiency)
+    };
+
+#undef HH_VARIABLE
+#undef HH_P4_VARIABLES
+
+    // `axis` is "x" or "y": the parameters are <axis>, nBins<AXIS>, <axis>Min and <axis>Max
+    HH::HistogramAxis parseAxis(const edm::ParameterSet& config, const std::string& axis, const std::string& histogram) {
+        const std::string nbins = axis == "x" ? "nBinsX" : "nBinsY";
+        HH::HistogramAxis result;
+        result.variable = config.getUntrackedParameter<std::string>(axis);
+        result.getter = HH::candidateVariable(result.variable);
+        result.bins = config.getUntrackedParameter<unsigned int>(nbins);
+        result.min = config.getUntrackedParameter<double>(axis + "Min");
+        result.max = config.getUntrackedParameter<double>(axis + "Max");
+
+        if (result.bins == 0 || !(result.min < result.max))
+            throw edm::Exception(edm::errors::Configuration, "Histogram '" + histogram + "' needs " + nbins + " > 0 and " + axis + "Min < " + axis + "Max");
+
+        return result;
+    }
+}
+
+namespace HH {
+
+    CandidateVariable candidateVariable(const std::string& name) {
+        auto it = s_variables.find(name);
+        if (it == s_variables.end()) {
+            std::string names;
+            for (const auto& variable: s_variables)
+                names += (names.empty() ? "'" : ", '") + variable.first + "'";
+            throw edm::Exception(edm::errors::Configuration, "Unknown histogram variable '" + name + "'. Valid values are " + names);
+        }
+
+        return it->second;
+    }
+
+    size_t HistogramAxis::find(float value) const {
+        // NaN goes to the underflow
+        if (!(value >= min))
+            return 0;
+        if (value >= max)
+            return bins + 1;
+        return std::min<size_t>(1 + static_cast<size_t>((value - min) / (max - min) * bins), bins);
+    }
+
+    HistogramDefinition::HistogramDefinition(const edm::ParameterSet& config) {
+        name = config.getUntrackedParameter<std::string>("name");
+        x = parseAxis(config, "x", name);
+        if (config.existsAs<std::string>("y", false))
+            y = parseAxis(config, "y", name);
+        trigger_efficiency = config.getUntrackedParameter<bool>("triggerEfficiency", true);
+    }
+
+    const std::array<std::string, 4> HistogramSet::categories = {{ "elel", "elmu", "muel", "mumu" }};
+
+    HistogramSet::HistogramSet(const std::vector<HistogramDefinition>& definitions):
+        m_definitions(&definitions) {
+        for (const auto& definition: definitions) {
+            m_offsets.push_back(m_category_size);
+            m_category_size += definition.cells();
+        }
+
+        m_sumw.resize(m_category_size * categories.size());
+        m_sumw2.resize(m_category_size * categories.size());
+        m_entries.resize(definitions.size() * categories.size());
+    }
+
+    void HistogramSet::fill(size_t category, const DileptonMetDijet& candidate, float event_weight) {
+        for (size_t i = 0; i < m_definitions->size(); i++) {
+            const HistogramDefinition& definition = (*m_definitions)[i];
+
+            size_t cell = definition.x.find(definition.x.getter(candidate));
+            if (definition.is2D())
+                cell += (definition.x.bins + 2) * definition.y.find(definition.y.getter(candidate));
+
+            double weight = definition.trigger_efficiency ? event_weight * candidate.trigger_efficiency : event_weight;
+            size_t index = category * m_category_size + m_offsets[i] + cell;
+            m_sumw[index] += weight;
+            m_sumw2[index] += weight * weight;
+            m_entries[category * m_definitions->size() + i]++;
+        }
+    }
+
+    HistogramSet& HistogramSet::operator+=(const HistogramSet& other) {
+        for (size_t i = 0; i < m_sumw.size(); i++) {
+            m_sumw[i] += other.m_sumw[i];
+            m_sumw2[i] += other.m_sumw2[i];
+        }
+        for (size_t i = 0; i < m_entries.size(); i++)
+            m_entries[i] += other.m_entries[i];
+
+        return *this;
+    }
+
+    void HistogramSet::write(const std::string& path, const std::string& prefix) const {
+        static std::mutex mutex;
+        static std::set<std::string> created;
+
+        std::lock_guard<std::mutex> lock(mutex);
+
+        bool first = created.insert(path).second;
+        std::unique_ptr<TFile> file(TFile::Open(path.c_str(), first ? "recreate" : "update"));
+        if (!file || file->IsZombie())
+            throw edm::Exception(edm::errors::Configuration, "Cannot write the histograms to '" + path + "'");
+        file->cd();
+
+        for (size_t category = 0; category < categories.size(); category++) {
+            for (size_t i = 0; i < m_definitions->size(); i++) {
+                const HistogramDefinition& definition = (*m_definitions)[i];
+                const std::string name = prefix + "_" + definition.name + "_" + categories[category];
+                const size_t offset = category * m_category_size + m_offsets[i];
+
+                std::unique_ptr<TH1> histogram;
+                if (definition.is2D())
+                    histogram.reset(new TH2D(name.c_str(), (definition.y.variable + " vs " + definition.x.variable).c_str(),
+                                definition.x.bins, definition.x.min, definition.x.max, definition.y.bins, definition.y.min, definition.y.max));
+                else
+                    histogram.reset(new TH1D(name.c_str(), definition.x.variable.c_str(), definition.x.bins, definition.x.min, definition.x.max));
+                histogram->SetDirectory(nullptr);
+
+                // Cells are laid out as ROOT global bins: x + (nbinsx + 2) * y
+                for (size_t cell = 0; cell < definition.cells(); cell++) {
+                    histogram->SetBinContent(cell, m_sumw[offset + cell]);
+                    histogram->SetBinError(cell, std::sqrt(m_sumw2[offset + cell]));
+                }
+                histogram->SetEntries(m_entries[category * m_definitions->size() + i]);
+
+                histogram->Write();
+            }
+        }
+
+        std::cout << "Histograms of " << prefix << " written to '" << path << "'" << std::endl;
+    }
+}
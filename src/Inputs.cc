@@ -0,0 +1,288 @@
+#include <cp3_llbb/HHAnalysis/interface/Inputs.h>
+#include <cp3_llbb/HHAnalysis/interface/Configuration.h>
+#include <cp3_llbb/HHAnalysis/interface/Selection.h>
+
+#include <cp3_llbb/Framework/interface/ProducersManager.h>
+
+#include <FWCore/Framework/interface/Event.h>
+#include <FWCore/Utilities/interface/EDMException.h>
+
+#include <algorithm>
+#include <sstream>
+
+namespace {
+
+    const std::string CSV_NAME = "pfCombinedInclusiveSecondaryVertexV2BJetTags";
+    const std::string CMVAV2_NAME = "pfCombinedMVAV2BJetTags";
+
+    // The IDs are a map per electron, so the name is looked up in each of them. Throws if `ids` has no `name` key
+    template <typename Map> typename Map::mapped_type electronId(const Map& ids, const std::string& name) {
+        auto it = ids.find(name);
+        if (it == ids.end()) {
+            std::string keys;
+            for (const auto& entry: ids)
+                keys += (keys.empty() ? "'" : ", '") + entry.first + "'";
+            throw edm::Exception(edm::errors::Configuration, "Unknown electron ID '" + name + "'. Valid values are " + keys);
+        }
+
+        return it->second;
+    }
+
+    const char MAGIC[8] = {'H', 'H', 'I', 'N', 'P', 'U', 'T', 'S'};
+    const uint32_t VERSION = 2;
+
+    // Serialization of the input members. Everything is written in native byte order: files are meant to be
+    // replayed on the kind of machine that captured them
+    template <typename T> typename std::enable_if<std::is_arithmetic<T>::value>::type serialize(std::ostream& out, const T& value);
+    void serialize(std::ostream& out, const std::string& value);
+    template <typename C> void serialize(std::ostream& out, const ROOT::Math::LorentzVector<C>& value);
+    void serialize(std::ostream& out, const std::vector<bool>& value);
+    template <typename T> void serialize(std::ostream& out, const std::vector<T>& value);
+    template <typename T> void serialize(std::ostream& out, const HH::InputView<T>& value);
+
+    template <typename T> typename std::enable_if<std::is_arithmetic<T>::value>::type deserialize(std::istream& in, T& value);
+    void deserialize(std::istream& in, std::string& value);
+    template <typename C> void deserialize(std::istream& in, ROOT::Math::LorentzVector<C>& value);
+    void deserialize(std::istream& in, std::vector<bool>& value);
+    template <typename T> void deserialize(std::istream& in, std::vector<T>& value);
+    template <typename T> void deserialize(std::istream& in, HH::InputView<T>& value);
+
+    template <typename T> typename std::enable_if<std::is_arithmetic<T>::value>::type serialize(std::ostream& out, const T& value) {
+        out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    void serialize(std::ostream& out, const std::string& value) {
+        serialize(out, static_cast<uint32_t>(value.size()));
+        out.write(value.data(), value.size());
+    }
+
+    template <typename C> void serialize(std::ostream& out, const ROOT::Math::LorentzVector<C>& value) {
+        typename ROOT::Math::LorentzVector<C>::Scalar coordinates[4];
+        value.GetCoordinates(coordinates);
+        out.write(reinterpret_cast<const char*>(coordinates), sizeof(coordinates));
+    }
+
+    void serialize(std::ostream& out, const std::vector<bool>& value) {
+        serialize(out, static_cast<uint32_t>(value.size()));
+        for (bool b: value)
+            serialize(out, static_cast<uint8_t>(b));
+    }
+
+    template <typename T> void serialize(std::ostream& out, const std::vector<T>& value) {
+        serialize(out, static_cast<uint32_t>(value.size()));
+        for (const T& element: value)
+            serialize(out, element);
+    }
+
+    template <typename T> void serialize(std::ostream& out, const HH::InputView<T>& value) {
+        serialize(out, value.get());
+    }
+
+    template <typename T> typename std::enable_if<std::is_arithmetic<T>::value>::type deserialize(std::istream& in, T& value) {
+        in.read(reinterpret_cast<char*>(&value), sizeof(T));
+    }
+
+    void deserialize(std::istream& in, std::string& value) {
+        uint32_t size = 0;
+        deserialize(in, size);
+        value.resize(size);
+        in.read(&value[0], size);
+    }
+
+    template <typename C> void deserialize(std::istream& in, ROOT::Math::LorentzVector<C>& value) {
+        typename ROOT::Math::LorentzVector<C>::Scalar coordinates[4];
+        in.read(reinterpret_cast<char*>(coordinates), sizeof(coordinates));
+        value.SetCoordinates(coordinates);
+    }
+
+    void deserialize(std::istream& in, std::vector<bool>& value) {
+        uint32_t size = 0;
+        deserialize(in, size);
+        value.resize(size);
+        for (size_t i = 0; i < size; i++) {
+            uint8_t b = 0;
+            deserialize(in, b);
+            value[i] = b;
+        }
+    }
+
+    template <typename T> void deserialize(std::istream& in, std::vector<T>& value) {
+        uint32_t size = 0;
+        deserialize(in, size);
+        value.resize(size);
+        for (T& element: value)
+            deserialize(in, element);
+    }
+
+    // Replayed values are owned by the view
+    template <typename T> void deserialize(std::istream& in, HH::InputView<T>& value) {
+        deserialize(in, value.owned());
+    }
+
+    struct Writer {
+        std::ostream& out;
+        template <typename T> void operator()(const T& value) { serialize(out, value); }
+    };
+
+    struct Reader {
+        std::istream& in;
+        template <typename T> void operator()(T& value) { deserialize(in, value); }
+    };
+}
+
+namespace HH {
+
+    void EventInputs::fill(const edm::Event& edm_event, const ProducersManager& producers, const AnalyzerConfiguration& config) {
+        isRealData = edm_event.isRealData();
+        run = edm_event.id().run();
+        lumi = edm_event.id().luminosityBlock();
+        event = edm_event.id().event();
+
+        const EventProducer& fwevent_producer = producers.get<EventProducer>("event");
+        fwevent.run = fwevent_producer.run;
+        fwevent.weight = fwevent_producer.weight;
+
+        const JetsProducer& jets_producer = producers.get<JetsProducer>(config.jets_producer);
+        jets.p4.bind(jets_producer.p4);
+        jets.gen_p4.bind(jets_producer.gen_p4);
+        jets.matched.bind(jets_producer.matched);
+        jets.passLooseID.bind(jets_producer.passLooseID);
+        jets.regPt.bind(jets_producer.regPt);
+        jets.hadronFlavor.bind(jets_producer.hadronFlavor);
+        jets.partonFlavor.bind(jets_producer.partonFlavor);
+        jets.CSV.resize(jets.p4.size());
+        jets.CMVAv2.resize(jets.p4.size());
+        jets.bDiscr.resize(jets.p4.size());
+        // The discriminants are looked up by name in each jet, so only for the jets passing the selection (see
+        // ObjectSelection::select, same pt after regression); the others keep 0. The names are std::string built
+        // once: a literal would build (and allocate) a temporary string for each jet
+        bool bDiscr_is_CSV = config.jet_bDiscrName == CSV_NAME;
+        bool bDiscr_is_CMVAv2 = config.jet_bDiscrName == CMVAV2_NAME;
+        for (size_t i = 0; i < jets.p4.size(); i++) {
+            float pt = jets.p4[i].Pt();
+            if (config.applyBJetRegression)
+                pt *= jets.regPt[i] / pt;
+            if (!passesKinematicCuts(pt, jets.p4[i].Eta(), config.jetPtCut, config.jetEtaCut) || !jets.passLooseID[i]) {
+                jets.CSV[i] = 0;
+                jets.CMVAv2[i] = 0;
+                jets.bDiscr[i] = 0;
+                continue;
+            }
+
+            jets.CSV[i] = jets_producer.getBTagDiscriminant(i, CSV_NAME);
+            jets.CMVAv2[i] = jets_producer.getBTagDiscriminant(i, CMVAV2_NAME);
+            // discr_name is usually one of the two above: copy instead of looking it up again
+            if (bDiscr_is_CSV)
+                jets.bDiscr[i] = jets.CSV[i];
+            else if (bDiscr_is_CMVAv2)
+                jets.bDiscr[i] = jets.CMVAv2[i];
+            else
+                jets.bDiscr[i] = jets_producer.getBTagDiscriminant(i, config.jet_bDiscrName);
+        }
+
+        const ElectronsProducer& electrons_producer = producers.get<ElectronsProducer>(config.electrons_producer);
+        electrons.p4.bind(electrons_producer.p4);
+        electrons.charge.bind(electrons_producer.charge);
+        electrons.gen_p4.bind(electrons_producer.gen_p4);
+        electrons.matched.bind(electrons_producer.matched);
+        electrons.dxy.bind(electrons_producer.dxy);
+        electrons.dz.bind(electrons_producer.dz);
+        electrons.isEB.resize(electrons.p4.size());
+        electrons.sc_eta.resize(electrons.p4.size());
+        electrons.medium_id.resize(electrons.p4.size());
+        electrons.hlt_safe_id.resize(electrons.p4.size());
+        // As in the selection (see ObjectSelection::select), the medium ID is only looked up for the electrons passing
+        // the kinematic cuts, and the HLT-safe ID and the pat::Electron only for those passing the medium ID too: they
+        // are the only ones whose fields are used
+        for (size_t i = 0; i < electrons.p4.size(); i++) {
+            const LorentzVector& p4 = electrons.p4[i];
+            bool selected = passesKinematicCuts(p4.Pt(), p4.Eta(), config.subleadingElectronPtCut, config.electronEtaCut)
+                && electronId(electrons_producer.ids[i], config.electron_medium_wp_name);
+            electrons.medium_id[i] = selected;
+            electrons.hlt_safe_id[i] = selected && electronId(electrons_producer.ids[i], config.electron_hlt_safe_wp_name);
+            electrons.isEB[i] = selected && electrons_producer.products[i]->isEB();
+            electrons.sc_eta[i] = selected ? electrons_producer.products[i]->superCluster()->eta() : 0;
+        }
+
+        const MuonsProducer& muons_producer = producers.get<MuonsProducer>(config.muons_producer);
+        muons.p4.bind(muons_producer.p4);
+        muons.charge.bind(muons_producer.charge);
+        muons.gen_p4.bind(muons_producer.gen_p4);
+        muons.matched.bind(muons_producer.matched);
+        muons.isTight.bind(muons_producer.isTight);
+        muons.relativeIsoR04_deltaBeta.bind(muons_producer.relativeIsoR04_deltaBeta);
+
+        const HLTProducer& hlt_producer = producers.get<HLTProducer>("hlt");
+        hlt.paths.bind(hlt_producer.paths);
+        hlt.object_p4.bind(hlt_producer.object_p4);
+        hlt.object_pdg_id.bind(hlt_producer.object_pdg_id);
+        hlt.object_paths.bind(hlt_producer.object_paths);
+        hlt.object_filters.bind(hlt_producer.object_filters);
+
+        met.p4.resize(config.met_producers.size());
+        for (size_t i = 0; i < config.met_producers.size(); i++)
+            met.p4[i] = producers.get<METProducer>(config.met_producers[i]).p4;
+
+        if (isRealData) {
+            gen_particles.pruned_p4.clear();
+            gen_particles.pruned_pdg_id.clear();
+            gen_particles.pruned_status_flags.clear();
+            gen_particles.pruned_mothers_index.clear();
+        } else {
+            const GenParticlesProducer& gen_particles_producer = producers.get<GenParticlesProducer>("gen_particles");
+            gen_particles.pruned_p4.bind(gen_particles_producer.pruned_p4);
+            gen_particles.pruned_pdg_id.bind(gen_particles_producer.pruned_pdg_id);
+            gen_particles.pruned_status_flags.bind(gen_particles_producer.pruned_status_flags);
+            gen_particles.pruned_mothers_index.bind(gen_particles_producer.pruned_mothers_index);
+        }
+    }
+
+    InputsWriter::InputsWriter(const std::string& path, const std::string& analyzer_name, const std::string& configuration):
+        m_file(path, std::ios::binary | std::ios::trunc) {
+        if (!m_file)
+            throw edm::Exception(edm::errors::Configuration, "Cannot open '" + path + "' to capture the analyzer inputs");
+
+        m_file.write(MAGIC, sizeof(MAGIC));
+        serialize(m_file, VERSION);
+        serialize(m_file, analyzer_name);
+        serialize(m_file, configuration);
+    }
+
+    void InputsWriter::write(EventInputs& inputs) {
+        std::ostringstream record;
+        Writer writer{record};
+        inputs.visit(writer);
+
+        const std::string& bytes = record.str();
+        std::lock_guard<std::mutex> lock(m_mutex);
+        serialize(m_file, static_cast<uint64_t>(bytes.size()));
+        m_file.write(bytes.data(), bytes.size());
+    }
+
+    InputsReader::InputsReader(const std::string& path):
+        m_file(path, std::ios::binary) {
+        char magic[sizeof(MAGIC)];
+        uint32_t version = 0;
+        m_file.read(magic, sizeof(magic));
+        deserialize(m_file, version);
+        if (!m_file || !std::equal(magic, magic + sizeof(magic), MAGIC))
+            throw edm::Exception(edm::errors::Configuration, "'" + path + "' is not a file of captured HHAnalyzer inputs");
+        if (version != VERSION)
+            throw edm::Exception(edm::errors::Configuration, "'" + path + "' has version " + std::to_string(version) + ", expected " + std::to_string(VERSION));
+
+        deserialize(m_file, m_analyzer_name);
+        deserialize(m_file, m_configuration);
+    }
+
+    bool InputsReader::next(EventInputs& inputs) {
+        uint64_t size = 0;
+        deserialize(m_file, size);
+        if (!m_file)
+            return false;
+
+        Reader reader{m_file};
+        inputs.visit(reader);
+
+        return bool(m_file);
+    }
+}
@@ -0,0 +1,66 @@
+#include <cp3_llbb/HHAnalysis/interface/Selection.h>
+#include <cp3_llbb/HHAnalysis/interface/Configuration.h>
+
+#include <cmath>
+
+namespace HH {
+
+    void CollectionSelection::gather(const std::vector<LorentzVector>& p4) {
+        pt.resize(p4.size());
+        eta.resize(p4.size());
+        mask.resize(p4.size());
+        for (size_t i = 0; i < p4.size(); i++) {
+            pt[i] = p4[i].Pt();
+            eta[i] = p4[i].Eta();
+        }
+    }
+
+    void CollectionSelection::cut(float pt_cut, float eta_cut) {
+        for (size_t i = 0; i < pt.size(); i++)
+            mask[i] = passesKinematicCuts(pt[i], eta[i], pt_cut, eta_cut);
+    }
+
+    void CollectionSelection::require(const std::vector<bool>& flags) {
+        // std::vector<bool> is bit-packed: this one is not vectorized, but stays branch-free
+        for (size_t i = 0; i < mask.size(); i++)
+            mask[i] &= static_cast<uint8_t>(flags[i]);
+    }
+
+    void CollectionSelection::compact() {
+        // Unconditional store, the index only advances for the objects passing
+        indices.resize(mask.size());
+        size_t n = 0;
+        for (size_t i = 0; i < mask.size(); i++) {
+            indices[n] = i;
+            n += mask[i];
+        }
+        indices.resize(n);
+    }
+
+    void ObjectSelection::select(const EventInputs& inputs, const AnalyzerConfiguration& config) {
+        electrons.gather(inputs.electrons.p4);
+        electrons.cut(config.subleadingElectronPtCut, config.electronEtaCut);
+        electrons.require(inputs.electrons.medium_id);
+        electrons.compact();
+
+        const EventInputs::Muons& all_muons = inputs.muons;
+        muons.gather(all_muons.p4);
+        muons.cut(config.subleadingMuonPtCut, config.muonEtaCut);
+        muons.require(all_muons.isTight);
+        // Written as in the muon loop so that a NaN isolation still passes
+        for (size_t i = 0; i < muons.mask.size(); i++)
+            muons.mask[i] &= !(all_muons.relativeIsoR04_deltaBeta[i] >= config.muonTightIsoCut);
+        muons.compact();
+
+        const EventInputs::Jets& all_jets = inputs.jets;
+        jets.gather(all_jets.p4);
+        if (config.applyBJetRegression) {
+            // Same expression as the correction factor applied in the jet loop, so that the cut is identical
+            for (size_t i = 0; i < jets.pt.size(); i++)
+                jets.pt[i] *= all_jets.regPt[i] / jets.pt[i];
+        }
+        jets.cut(config.jetPtCut, config.jetEtaCut);
+        jets.require(all_jets.passLooseID);
+        jets.compact();
+    }
+}
@@ -0,0 +1,289 @@
+#include <cp3_llbb/HHAnalysis/interface/Skim.h>
+
+#include <FWCore/ParameterSet/interface/ParameterSet.h>
+#include <FWCore/Utilities/interface/EDMException.h>
+
+#include <TDirectory.h>
+#include <TFile.h>
+#include <TROOT.h>
+#include <TTree.h>
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <tuple>
+
+namespace {
+    const char MAGIC[8] = {'H', 'H', 'S', 'K', 'I', 'M', 'I', 'X'};
+    const uint32_t VERSION = 1;
+
+    bool recordLess(const HH::SkimIndexRecord& a, const HH::SkimIndexRecord& b) {
+        return std::tie(a.run, a.lumi, a.event, a.tree) < std::tie(b.run, b.lumi, b.event, b.tree);
+    }
+
+    template <typename T> void write(std::ostream& out, const T& value) {
+        out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    template <typename T> void read(std::istream& in, T& value) {
+        in.read(reinterpret_cast<char*>(&value), sizeof(T));
+    }
+}
+
+namespace HH {
+
+    const std::array<std::string, 4> SkimConfiguration::categories = {{ "elel", "elmu", "muel", "mumu" }};
+
+    SkimConfiguration::SkimConfiguration(const edm::ParameterSet& config) {
+        file = config.getUntrackedParameter<std::string>("file", "");
+        index_file = config.getUntrackedParameter<std::string>("indexFile", file.empty() ? "" : file + ".index");
+        std::vector<std::string> names = config.getUntrackedParameter<std::vector<std::string>>("categories", {categories.begin(), categories.end()});
+        asynchronous = config.getUntrackedParameter<bool>("asynchronous", true);
+        buffer_events = config.getUntrackedParameter<unsigned int>("bufferEvents", 1000);
+
+        for (const std::string& name: names) {
+            auto it = std::find(categories.begin(), categories.end(), name);
+            if (it == categories.end())
+                throw edm::Exception(edm::errors::Configuration, "Unknown skim category '" + name + "'. Valid values are 'elel', 'elmu', 'muel' and 'mumu'");
+            enabled_categories[it - categories.begin()] = true;
+        }
+
+        if (!file.empty() && names.empty())
+            throw edm::Exception(edm::errors::Configuration, "skim.categories must not be empty");
+        if (buffer_events == 0)
+            throw edm::Exception(edm::errors::Configuration, "skim.bufferEvents must be at least 1");
+    }
+
+    struct SkimWriter::Stream {
+        std::string name;
+        TTree* tree;
+        ROOT::TreeWrapper wrapper;
+        ROOT::TreeGroup group;
+        FlatOutput flat;
+        uint32_t& run;
+        uint32_t& lumi;
+        uint64_t& event;
+        float& event_weight;
+        uint32_t entries = 0;
+
+        Stream(const std::string& name, TTree* tree, const OutputPolicy& policy):
+            name(name), tree(tree), wrapper(tree), group(wrapper.group("")), flat(group, policy),
+            run(wrapper["run"].write<uint32_t>()), lumi(wrapper["lumi"].write<uint32_t>()),
+            event(wrapper["event"].write<uint64_t>()), event_weight(wrapper["event_weight"].write<float>()) {
+            // Empty
+        }
+    };
+
+    std::shared_ptr<SkimWriter> SkimWriter::get(const SkimConfiguration& config) {
+        static std::mutex mutex;
+        static std::map<std::string, std::weak_ptr<SkimWriter>> writers;
+
+        std::lock_guard<std::mutex> lock(mutex);
+
+        std::weak_ptr<SkimWriter>& entry = writers[config.file];
+        std::shared_ptr<SkimWriter> result = entry.lock();
+        if (!result) {
+            result = std::make_shared<SkimWriter>(config);
+            entry = result;
+        }
+
+        return result;
+    }
+
+    SkimWriter::SkimWriter(const SkimConfiguration& config):
+        m_path(config.file), m_index_path(config.index_file), m_buffer_events(config.buffer_events) {
+        // The background thread fills and compresses the trees while the analyzers use ROOT as well (main tree,
+        // other files): ROOT must be told before any of them is created. Already done by CMSSW, but not by bin/
+        if (config.asynchronous)
+            ROOT::EnableThreadSafety();
+
+        // Opening the file makes it the current directory
+        TDirectory::TContext context;
+        m_file.reset(TFile::Open(m_path.c_str(), "recreate"));
+        if (!m_file || m_file->IsZombie())
+            throw edm::Exception(edm::errors::Configuration, "Cannot create the skim file '" + m_path + "'");
+
+        if (config.asynchronous) {
+            m_front.events.resize(m_buffer_events);
+            m_back.events.resize(m_buffer_events);
+            m_thread = std::thread(&SkimWriter::run, this);
+        }
+    }
+
+    SkimWriter::~SkimWriter() {
+        if (m_thread.joinable()) {
+            {
+                // Hand the last, partial, buffer over
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_back_done.wait(lock, [this]() { return !m_back_busy; });
+                if (m_front.size) {
+                    std::swap(m_front, m_back);
+                    m_front.size = 0;
+                    m_back_busy = true;
+                }
+                m_stop = true;
+            }
+            m_back_ready.notify_one();
+            m_thread.join();
+
+            std::cout << "Skim writer of '" << m_path << "': the analyzers waited " << m_waits << " times for the background thread" << std::endl;
+        }
+
+        {
+            TDirectory::TContext context(m_file.get());
+            for (const auto& stream: m_streams) {
+                stream->tree->Write();
+                std::cout << "Skim tree '" << stream->name << "': " << stream->entries << " events written to '" << m_path << "'" << std::endl;
+            }
+        }
+        writeIndex();
+
+        // The file owns the trees
+        m_streams.clear();
+        m_file.reset();
+    }
+
+    size_t SkimWriter::addStream(const std::string& name, const OutputPolicy& policy) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        TDirectory::TContext context(m_file.get());
+        m_streams.emplace_back(new Stream(name, new TTree(name.c_str(), name.c_str()), policy));
+
+        return m_streams.size() - 1;
+    }
+
+    void SkimWriter::fill(size_t stream, uint32_t run, uint32_t lumi, uint64_t event, float event_weight,
+            const std::vector<Lepton>& leptons, const std::vector<Jet>& jets, const std::vector<Met>& met, const std::vector<DileptonMetDijet>& llmetjj) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+
+        Stream& s = *m_streams[stream];
+        if (!m_thread.joinable()) {
+            writeEvent(s, run, lumi, event, event_weight, leptons, jets, met, llmetjj);
+        } else {
+            while (m_front.size == m_buffer_events) {
+                if (m_back_busy) {
+                    m_waits++;
+                    m_back_done.wait(lock, [this]() { return !m_back_busy; });
+                    // Another analyzer may have swapped the buffers in the meantime
+                    continue;
+                }
+
+                std::swap(m_front, m_back);
+                m_front.size = 0;
+                m_back_busy = true;
+                m_back_ready.notify_one();
+            }
+
+            StagedEvent& staged = m_front.events[m_front.size++];
+            staged.stream = &s;
+            staged.run = run;
+            staged.lumi = lumi;
+            staged.event = event;
+            staged.event_weight = event_weight;
+            staged.leptons = leptons;
+            staged.jets = jets;
+            staged.met = met;
+            staged.llmetjj = llmetjj;
+        }
+
+        // Entries are numbered in the order the events are staged, which is the order they are written in
+        m_index.push_back({run, lumi, event, static_cast<uint32_t>(stream), s.entries++});
+    }
+
+    void SkimWriter::writeEvent(Stream& stream, uint32_t run, uint32_t lumi, uint64_t event, float event_weight,
+            const std::vector<Lepton>& leptons, const std::vector<Jet>& jets, const std::vector<Met>& met, const std::vector<DileptonMetDijet>& llmetjj) {
+        stream.run = run;
+        stream.lumi = lumi;
+        stream.event = event;
+        stream.event_weight = event_weight;
+        stream.flat.fill(leptons, jets, met, llmetjj);
+        stream.wrapper.fill();
+    }
+
+    void SkimWriter::run() {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (true) {
+            m_back_ready.wait(lock, [this]() { return m_back_busy || m_stop; });
+            if (!m_back_busy)
+                return;
+
+            // The back buffer and the trees are only touched by this thread until m_back_busy is reset
+            lock.unlock();
+            for (size_t i = 0; i < m_back.size; i++) {
+                const StagedEvent& staged = m_back.events[i];
+                writeEvent(*staged.stream, staged.run, staged.lumi, staged.event, staged.event_weight, staged.leptons, staged.jets, staged.met, staged.llmetjj);
+            }
+            lock.lock();
+
+            m_back_busy = false;
+            m_back_done.notify_all();
+        }
+    }
+
+    uint64_t SkimWriter::entries(size_t stream) const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_streams[stream]->entries;
+    }
+
+    void SkimWriter::writeIndex() const {
+        // No exception from a destructor: report and carry on
+        std::ofstream out(m_index_path, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            std::cout << "Error: cannot write the skim index to '" << m_index_path << "'" << std::endl;
+            return;
+        }
+
+        std::vector<SkimIndexRecord> records = m_index;
+        std::sort(records.begin(), records.end(), recordLess);
+
+        out.write(MAGIC, sizeof(MAGIC));
+        write(out, VERSION);
+        write(out, static_cast<uint32_t>(m_streams.size()));
+        for (const auto& stream: m_streams) {
+            write(out, static_cast<uint32_t>(stream->name.size()));
+            out.write(stream->name.data(), stream->name.size());
+        }
+        write(out, static_cast<uint64_t>(records.size()));
+        out.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(SkimIndexRecord));
+
+        std::cout << "Skim index of " << records.size() << " events written to '" << m_index_path << "'" << std::endl;
+    }
+
+    SkimIndex::SkimIndex(const std::string& path) {
+        std::ifstream in(path, std::ios::binary);
+        char magic[sizeof(MAGIC)];
+        uint32_t version = 0;
+        in.read(magic, sizeof(magic));
+        read(in, version);
+        if (!in || !std::equal(magic, magic + sizeof(magic), MAGIC))
+            throw edm::Exception(edm::errors::Configuration, "'" + path + "' is not a skim index");
+        if (version != VERSION)
+            throw edm::Exception(edm::errors::Configuration, "'" + path + "' has version " + std::to_string(version) + ", expected " + std::to_string(VERSION));
+
+        uint32_t n_trees = 0;
+        read(in, n_trees);
+        m_trees.resize(n_trees);
+        for (std::string& tree: m_trees) {
+            uint32_t size = 0;
+            read(in, size);
+            tree.resize(size);
+            in.read(&tree[0], size);
+        }
+
+        uint64_t n_records = 0;
+        read(in, n_records);
+        m_records.resize(n_records);
+        in.read(reinterpret_cast<char*>(m_records.data()), n_records * sizeof(SkimIndexRecord));
+        if (!in)
+            throw edm::Exception(edm::errors::Configuration, "'" + path + "' is truncated");
+    }
+
+    std::pair<std::vector<SkimIndexRecord>::const_iterator, std::vector<SkimIndexRecord>::const_iterator> SkimIndex::find(uint32_t run, uint32_t lumi, uint64_t event) const {
+        const uint32_t max = std::numeric_limits<uint32_t>::max();
+        auto first = std::lower_bound(m_records.begin(), m_records.end(), SkimIndexRecord{run, lumi, event, 0, 0}, recordLess);
+        auto last = std::upper_bound(first, m_records.end(), SkimIndexRecord{run, lumi, event, max, max}, recordLess);
+        return {first, last};
+    }
+}
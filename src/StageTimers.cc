@@ -0,0 +1,81 @@
+#include <cp3_llbb/HHAnalysis/interface/StageTimers.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+
+namespace HH {
+
+    DurationHistogram& DurationHistogram::operator+=(const DurationHistogram& other) {
+        for (size_t i = 0; i < N_BINS; i++)
+            m_bins[i] += other.m_bins[i];
+        m_count += other.m_count;
+        m_sum += other.m_sum;
+        if (other.m_max > m_max)
+            m_max = other.m_max;
+
+        return *this;
+    }
+
+    uint64_t DurationHistogram::quantile(double q) const {
+        if (m_count == 0)
+            return 0;
+
+        uint64_t rank = std::max<uint64_t>(1, std::ceil(q * m_count));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < N_BINS; i++) {
+            seen += m_bins[i];
+            if (seen >= rank)
+                return lowerEdge(i);
+        }
+
+        return m_max;
+    }
+
+    StageTimings& StageTimings::operator+=(const StageTimings& other) {
+        for (size_t i = 0; i < Stage::Count; i++) {
+            stages[i] += other.stages[i];
+            allocations[i] += other.allocations[i];
+        }
+
+        return *this;
+    }
+
+    void StageTimings::report(std::ostream& out) const {
+        out << std::left << std::setw(24) << "Stage" << std::right
+            << std::setw(12) << "count"
+            << std::setw(14) << "mean [us]"
+            << std::setw(14) << "p50 [us]"
+            << std::setw(14) << "p99 [us]"
+            << std::setw(14) << "max [us]" << std::endl;
+
+        out << std::fixed << std::setprecision(2);
+        for (size_t i = 0; i < Stage::Count; i++) {
+            const DurationHistogram& stage = stages[i];
+            out << std::left << std::setw(24) << Stage::names[i] << std::right
+                << std::setw(12) << stage.count()
+                << std::setw(14) << stage.mean() / 1000.
+                << std::setw(14) << stage.quantile(0.5) / 1000.
+                << std::setw(14) << stage.quantile(0.99) / 1000.
+                << std::setw(14) << stage.max() / 1000. << std::endl;
+        }
+        out << std::defaultfloat;
+    }
+
+    void StageTimings::reportAllocations(std::ostream& out) const {
+        out << std::left << std::setw(24) << "Stage" << std::right
+            << std::setw(12) << "count"
+            << std::setw(14) << "allocs/call"
+            << std::setw(14) << "bytes/call" << std::endl;
+
+        out << std::fixed << std::setprecision(2);
+        for (size_t i = 0; i < Stage::Count; i++) {
+            uint64_t count = stages[i].count();
+            out << std::left << std::setw(24) << Stage::names[i] << std::right
+                << std::setw(12) << count
+                << std::setw(14) << (count ? static_cast<double>(allocations[i].allocations) / count : 0.)
+                << std::setw(14) << (count ? static_cast<double>(allocations[i].bytes) / count : 0.) << std::endl;
+        }
+        out << std::defaultfloat;
+    }
+}
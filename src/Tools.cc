@@ -2,9 +2,11 @@
 #include <cp3_llbb/HHAnalysis/interface/Types.h>
 #include <Math/Vector3D.h>
 
+#include <algorithm>
+
 #define HH_HLT_DEBUG (false)
 
-float HHAnalyzer::getCosThetaStar_CS(const LorentzVector & h1, const LorentzVector & h2, float ebeam /*= 6500*/) {
+float HHAnalyzer::getCosThetaStar_CS(const LorentzVector & h1, const LorentzVector & h2, float ebeam /*= 6500*/) const {
     // cos theta star angle in the Collins Soper frame
     LorentzVector p1, p2;
     p1.SetPxPyPzE(0, 0,  ebeam, ebeam);
@@ -20,7 +22,7 @@ float HHAnalyzer::getCosThetaStar_CS(const LorentzVector & h1, const LorentzVect
     return cos(ROOT::Math::VectorUtil::Angle(CSaxis.Unit(), newh1.Vect().Unit()));
 }
 
-MELAAngles HHAnalyzer::getMELAAngles(const LorentzVector &q1, const LorentzVector &q2, const LorentzVector &q11, const LorentzVector &q12, const LorentzVector &q21, const LorentzVector &q22, float ebeam /*= 6500*/) {
+MELAAngles HHAnalyzer::getMELAAngles(const LorentzVector &q1, const LorentzVector &q2, const LorentzVector &q11, const LorentzVector &q12, const LorentzVector &q21, const LorentzVector &q22, float ebeam /*= 6500*/) const {
     MELAAngles angles;
     LorentzVector p1, p2;
     p1.SetPxPyPzE(0, 0,  ebeam, ebeam);
@@ -74,7 +76,7 @@ MELAAngles HHAnalyzer::getMELAAngles(const LorentzVector &q1, const LorentzVecto
     return angles;
 }
 
-void HHAnalyzer::matchOfflineLepton(const HLTProducer& hlt, HH::Dilepton& dilepton) {
+void HHAnalyzer::matchOfflineLepton(const HH::EventInputs::HLT& hlt, HH::Dilepton& dilepton) {
 
     if (leptons[dilepton.ilep1].hlt_already_tried_matching && leptons[dilepton.ilep2].hlt_already_tried_matching) {
         if (HH_HLT_DEBUG) std::cout << "The HLT matching for this lepton pair has already been attempted, stopping here" << std::endl;
@@ -124,15 +126,15 @@ void HHAnalyzer::matchOfflineLepton(const HLTProducer& hlt, HH::Dilepton& dilept
                     << " ; ΔPt / Pt: " << l2_dpt_over_pt
                     << std::endl;
         }
-        if (l1_dr < m_hltDRCut
-            && l1_dpt_over_pt < m_hltDPtCut
+        if (l1_dr < m_config->hltDRCut
+            && l1_dpt_over_pt < m_config->hltDPtCut
             && ((fabs(hlt.object_pdg_id[hlt_object]) == 13 && leptons[dilepton.ilep1].isMu)
                 || (fabs(hlt.object_pdg_id[hlt_object]) == 0 && leptons[dilepton.ilep1].isEl)) // It is unfortunate but the PDG ID is not correct in HLT objects
             ) {
             l1_all_indices.push_back(hlt_object);
         }
-        if (l2_dr < m_hltDRCut
-            && l2_dpt_over_pt < m_hltDPtCut
+        if (l2_dr < m_config->hltDRCut
+            && l2_dpt_over_pt < m_config->hltDPtCut
             && ((fabs(hlt.object_pdg_id[hlt_object]) == 13 && leptons[dilepton.ilep2].isMu)
                 || (fabs(hlt.object_pdg_id[hlt_object]) == 0 && leptons[dilepton.ilep2].isEl)) // It is unfortunate but the PDG ID is not correct in HLT objects
             ) {
@@ -199,7 +201,7 @@ void HHAnalyzer::matchOfflineLepton(const HLTProducer& hlt, HH::Dilepton& dilept
         std::vector<std::string> filter_leg1;
         std::vector<std::string> filter_leg2;
 
-        static auto isLegMatched = [&hlt](const std::vector<int8_t> path_indices, const std::vector<std::string>& filters) -> bool {
+        auto isLegMatched = [&hlt](const std::vector<int8_t> path_indices, const std::vector<std::string>& filters) -> bool {
             return
                 std::any_of(path_indices.begin(), path_indices.end(), [&](int8_t index) {
                     for (const auto& filter: filters) {
@@ -339,25 +341,77 @@ void HHAnalyzer::matchOfflineLepton(const HLTProducer& hlt, HH::Dilepton& dilept
     }
 }
 
-float HHAnalyzer::getL1TPhi(int charge, const LorentzVector& p) {
+void HHAnalyzer::fillGenMatches(const std::vector<LorentzVector>& reco_gen_p4, const std::vector<bool>& reco_matched, const LorentzVector& target, std::vector<int>& indices, std::vector<float>& deltaRs) const {
+    // Scratch buffer, kept to avoid reallocating it each call
+    std::vector<std::pair<float, int>>& candidates = m_gen_match_candidates;
+
+    // Reco objects without a gen match have a null gen p4: do not bother computing a ΔR for those
+    candidates.clear();
+    for (size_t i = 0; i < reco_gen_p4.size(); i++) {
+        if (!reco_matched[i])
+            continue;
+        candidates.emplace_back(ROOT::Math::VectorUtil::DeltaR(reco_gen_p4[i], target), i);
+    }
+
+    size_t n = std::min(m_config->gen_deltaR_top_k, candidates.size());
+    std::partial_sort(candidates.begin(), candidates.begin() + n, candidates.end());
+
+    for (size_t i = 0; i < n; i++) {
+        deltaRs.push_back(candidates[i].first);
+        indices.push_back(candidates[i].second);
+    }
+}
+
+bool HHAnalyzer::canBuildDilepton(const HH::ObjectSelection& selection) const {
+    // A pair needs a lepton above its leading pt cut, and a second one not harder than it (the subleading
+    // lepton is the softer one of the pair)
+    const HH::CollectionSelection& electrons = selection.electrons;
+    const HH::CollectionSelection& muons = selection.muons;
+    if (electrons.indices.size() + muons.indices.size() < 2)
+        return false;
+
+    float leading_pt = -1;
+    for (uint32_t i: electrons.indices) {
+        if (electrons.pt[i] >= m_config->leadingElectronPtCut && electrons.pt[i] > leading_pt)
+            leading_pt = electrons.pt[i];
+    }
+    for (uint32_t i: muons.indices) {
+        if (muons.pt[i] >= m_config->leadingMuonPtCut && muons.pt[i] > leading_pt)
+            leading_pt = muons.pt[i];
+    }
+
+    if (leading_pt < 0)
+        return false;
+
+    // The leading lepton itself is counted here
+    size_t n_leptons = 0;
+    for (uint32_t i: electrons.indices)
+        n_leptons += electrons.pt[i] <= leading_pt;
+    for (uint32_t i: muons.indices)
+        n_leptons += muons.pt[i] <= leading_pt;
+
+    return n_leptons >= 2;
+}
+
+float HHAnalyzer::getL1TPhi(int charge, const LorentzVector& p) const {
     float pt = p.Pt();
     float theta = 180 / M_PI * p.Theta();
     theta = ( theta <= 90 ) ? theta : 180 - theta;
     return p.Phi() + M_PI / 180 * charge * (1. / pt) * (10.48 - 5.1412 * theta + 0.02308 * theta * theta);
 }
 
-bool HHAnalyzer::sameEndCap(const LorentzVector& p1, const LorentzVector& p2) {
+bool HHAnalyzer::sameEndCap(const LorentzVector& p1, const LorentzVector& p2) const {
     return p1.Eta() * p2.Eta() > 0 && std::abs(p1.Eta()) > 1.24 && std::abs(p2.Eta()) > 1.24;
 }
 
-float HHAnalyzer::translatePhi(float phi, float translation/*=0*/) {
+float HHAnalyzer::translatePhi(float phi, float translation/*=0*/) const {
     phi += translation; // translate
     phi = std::fmod(phi, 2 * M_PI); // put between -2pi, 2pi
     phi = (phi > 0) ? phi : (2 * M_PI + phi); // put between 0, 2pi
     return phi;
 }
 
-int HHAnalyzer::getPhiSector(float phi, float start, float end) {
+int HHAnalyzer::getPhiSector(float phi, float start, float end) const {
     for (int i = 0; i < 6; i++) {
         if (start + i * M_PI / 3 <= phi && phi < end + i * M_PI / 3)
             return i;
@@ -365,7 +419,7 @@ int HHAnalyzer::getPhiSector(float phi, float start, float end) {
     return -1;
 }
 
-bool HHAnalyzer::isCSCSameSector(const Lepton& lep1, const Lepton& lep2) {
+bool HHAnalyzer::isCSCSameSector(const Lepton& lep1, const Lepton& lep2) const {
     if (!sameEndCap(lep1.p4, lep2.p4))
         return false;
 
@@ -387,7 +441,7 @@ bool HHAnalyzer::isCSCSameSector(const Lepton& lep1, const Lepton& lep2) {
     return false;
 }
 
-bool HHAnalyzer::isCSCWithOverlap(const Lepton& lep1, const Lepton& lep2) {
+bool HHAnalyzer::isCSCWithOverlap(const Lepton& lep1, const Lepton& lep2) const {
     if (!sameEndCap(lep1.p4, lep2.p4))
         return false;
 
@@ -409,7 +463,7 @@ bool HHAnalyzer::isCSCWithOverlap(const Lepton& lep1, const Lepton& lep2) {
     return false;
 }
 
-void HHAnalyzer::fillTriggerEfficiencies(const Lepton & lep1, const Lepton & lep2, Dilepton & dilep) {
+void HHAnalyzer::fillTriggerEfficiencies(const Lepton & lep1, const Lepton & lep2, Dilepton & dilep) const {
 
     float eff_lep1_leg1 = 1.;
     float eff_lep1_leg2 = 1.;
@@ -439,34 +493,34 @@ void HHAnalyzer::fillTriggerEfficiencies(const Lepton & lep1, const Lepton & lep
         p_hlt_lep2.setEta(lep2.sc_eta);
 
     if (lep1.isMu && lep2.isMu) {
-        eff_lep1_leg1 = m_hlt_efficiencies.at("IsoMu17leg")->get(p_hlt_lep1)[0];
-        eff_lep1_leg2 = m_hlt_efficiencies.at("IsoMu8orIsoTkMu8leg")->get(p_hlt_lep1)[0];
-        eff_lep2_leg1 = m_hlt_efficiencies.at("IsoMu17leg")->get(p_hlt_lep2)[0];
-        eff_lep2_leg2 = m_hlt_efficiencies.at("IsoMu8orIsoTkMu8leg")->get(p_hlt_lep2)[0];
+        eff_lep1_leg1 = m_config->hlt_efficiencies.at("IsoMu17leg")->get(p_hlt_lep1)[0];
+        eff_lep1_leg2 = m_config->hlt_efficiencies.at("IsoMu8orIsoTkMu8leg")->get(p_hlt_lep1)[0];
+        eff_lep2_leg1 = m_config->hlt_efficiencies.at("IsoMu17leg")->get(p_hlt_lep2)[0];
+        eff_lep2_leg2 = m_config->hlt_efficiencies.at("IsoMu8orIsoTkMu8leg")->get(p_hlt_lep2)[0];
         DZ_filter_eff = DZ_filter_eff_MuMu;
         // FIXME L1 EMTF bug
         if (isCSCSameSector(lep1, lep2))
             DZ_filter_eff *= L1_EMTF_bug_eff_MuMu;
     }
     else if (lep1.isMu && lep2.isEl) {
-        eff_lep1_leg1 = m_hlt_efficiencies.at("IsoMu23leg")->get(p_hlt_lep1)[0];
-        eff_lep1_leg2 = m_hlt_efficiencies.at("IsoMu8leg")->get(p_hlt_lep1)[0];
-        eff_lep2_leg1 = m_hlt_efficiencies.at("EleMuHighPtleg")->get(p_hlt_lep2)[0];
-        eff_lep2_leg2 = m_hlt_efficiencies.at("MuEleLowPtleg")->get(p_hlt_lep2)[0];
+        eff_lep1_leg1 = m_config->hlt_efficiencies.at("IsoMu23leg")->get(p_hlt_lep1)[0];
+        eff_lep1_leg2 = m_config->hlt_efficiencies.at("IsoMu8leg")->get(p_hlt_lep1)[0];
+        eff_lep2_leg1 = m_config->hlt_efficiencies.at("EleMuHighPtleg")->get(p_hlt_lep2)[0];
+        eff_lep2_leg2 = m_config->hlt_efficiencies.at("MuEleLowPtleg")->get(p_hlt_lep2)[0];
         DZ_filter_eff = DZ_filter_eff_MuEl;
     }
     else if (lep1.isEl && lep2.isMu) {
-        eff_lep1_leg1 = m_hlt_efficiencies.at("EleMuHighPtleg")->get(p_hlt_lep1)[0];
-        eff_lep1_leg2 = m_hlt_efficiencies.at("MuEleLowPtleg")->get(p_hlt_lep1)[0];
-        eff_lep2_leg1 = m_hlt_efficiencies.at("IsoMu23leg")->get(p_hlt_lep2)[0];
-        eff_lep2_leg2 = m_hlt_efficiencies.at("IsoMu8leg")->get(p_hlt_lep2)[0];
+        eff_lep1_leg1 = m_config->hlt_efficiencies.at("EleMuHighPtleg")->get(p_hlt_lep1)[0];
+        eff_lep1_leg2 = m_config->hlt_efficiencies.at("MuEleLowPtleg")->get(p_hlt_lep1)[0];
+        eff_lep2_leg1 = m_config->hlt_efficiencies.at("IsoMu23leg")->get(p_hlt_lep2)[0];
+        eff_lep2_leg2 = m_config->hlt_efficiencies.at("IsoMu8leg")->get(p_hlt_lep2)[0];
         DZ_filter_eff = DZ_filter_eff_ElMu;
     }
     else if (lep1.isEl && lep2.isEl){
-        eff_lep1_leg1 = m_hlt_efficiencies.at("DoubleEleHighPtleg")->get(p_hlt_lep1)[0];
-        eff_lep1_leg2 = m_hlt_efficiencies.at("DoubleEleLowPtleg")->get(p_hlt_lep1)[0];
-        eff_lep2_leg1 = m_hlt_efficiencies.at("DoubleEleHighPtleg")->get(p_hlt_lep2)[0];
-        eff_lep2_leg2 = m_hlt_efficiencies.at("DoubleEleLowPtleg")->get(p_hlt_lep2)[0];
+        eff_lep1_leg1 = m_config->hlt_efficiencies.at("DoubleEleHighPtleg")->get(p_hlt_lep1)[0];
+        eff_lep1_leg2 = m_config->hlt_efficiencies.at("DoubleEleLowPtleg")->get(p_hlt_lep1)[0];
+        eff_lep2_leg1 = m_config->hlt_efficiencies.at("DoubleEleHighPtleg")->get(p_hlt_lep2)[0];
+        eff_lep2_leg2 = m_config->hlt_efficiencies.at("DoubleEleLowPtleg")->get(p_hlt_lep2)[0];
         DZ_filter_eff = DZ_filter_eff_ElEl;
     }
     else 
@@ -478,28 +532,28 @@ void HHAnalyzer::fillTriggerEfficiencies(const Lepton & lep1, const Lepton & lep
     float error_eff_lep2_leg2_up = 0.;
 
     if (lep1.isMu && lep2.isMu) {
-        error_eff_lep1_leg1_up = m_hlt_efficiencies.at("IsoMu17leg")->get(p_hlt_lep1)[2];
-        error_eff_lep1_leg2_up = m_hlt_efficiencies.at("IsoMu8orIsoTkMu8leg")->get(p_hlt_lep1)[2];
-        error_eff_lep2_leg1_up = m_hlt_efficiencies.at("IsoMu17leg")->get(p_hlt_lep2)[2];
-        error_eff_lep2_leg2_up = m_hlt_efficiencies.at("IsoMu8orIsoTkMu8leg")->get(p_hlt_lep2)[2];
+        error_eff_lep1_leg1_up = m_config->hlt_efficiencies.at("IsoMu17leg")->get(p_hlt_lep1)[2];
+        error_eff_lep1_leg2_up = m_config->hlt_efficiencies.at("IsoMu8orIsoTkMu8leg")->get(p_hlt_lep1)[2];
+        error_eff_lep2_leg1_up = m_config->hlt_efficiencies.at("IsoMu17leg")->get(p_hlt_lep2)[2];
+        error_eff_lep2_leg2_up = m_config->hlt_efficiencies.at("IsoMu8orIsoTkMu8leg")->get(p_hlt_lep2)[2];
     }
     else if (lep1.isMu && lep2.isEl) {
-        error_eff_lep1_leg1_up = m_hlt_efficiencies.at("IsoMu23leg")->get(p_hlt_lep1)[2];
-        error_eff_lep1_leg2_up = m_hlt_efficiencies.at("IsoMu8leg")->get(p_hlt_lep1)[2];
-        error_eff_lep2_leg1_up = m_hlt_efficiencies.at("EleMuHighPtleg")->get(p_hlt_lep2)[2];
-        error_eff_lep2_leg2_up = m_hlt_efficiencies.at("MuEleLowPtleg")->get(p_hlt_lep2)[2];
+        error_eff_lep1_leg1_up = m_config->hlt_efficiencies.at("IsoMu23leg")->get(p_hlt_lep1)[2];
+        error_eff_lep1_leg2_up = m_config->hlt_efficiencies.at("IsoMu8leg")->get(p_hlt_lep1)[2];
+        error_eff_lep2_leg1_up = m_config->hlt_efficiencies.at("EleMuHighPtleg")->get(p_hlt_lep2)[2];
+        error_eff_lep2_leg2_up = m_config->hlt_efficiencies.at("MuEleLowPtleg")->get(p_hlt_lep2)[2];
     }
     else if (lep1.isEl && lep2.isMu) {
-        error_eff_lep1_leg1_up = m_hlt_efficiencies.at("EleMuHighPtleg")->get(p_hlt_lep1)[2];
-        error_eff_lep1_leg2_up = m_hlt_efficiencies.at("MuEleLowPtleg")->get(p_hlt_lep1)[2];
-        error_eff_lep2_leg1_up = m_hlt_efficiencies.at("IsoMu23leg")->get(p_hlt_lep2)[2];
-        error_eff_lep2_leg2_up = m_hlt_efficiencies.at("IsoMu8leg")->get(p_hlt_lep2)[2];
+        error_eff_lep1_leg1_up = m_config->hlt_efficiencies.at("EleMuHighPtleg")->get(p_hlt_lep1)[2];
+        error_eff_lep1_leg2_up = m_config->hlt_efficiencies.at("MuEleLowPtleg")->get(p_hlt_lep1)[2];
+        error_eff_lep2_leg1_up = m_config->hlt_efficiencies.at("IsoMu23leg")->get(p_hlt_lep2)[2];
+        error_eff_lep2_leg2_up = m_config->hlt_efficiencies.at("IsoMu8leg")->get(p_hlt_lep2)[2];
     }
     else if (lep1.isEl && lep2.isEl){
-        error_eff_lep1_leg1_up = m_hlt_efficiencies.at("DoubleEleHighPtleg")->get(p_hlt_lep1)[2];
-        error_eff_lep1_leg2_up = m_hlt_efficiencies.at("DoubleEleLowPtleg")->get(p_hlt_lep1)[2];
-        error_eff_lep2_leg1_up = m_hlt_efficiencies.at("DoubleEleHighPtleg")->get(p_hlt_lep2)[2];
-        error_eff_lep2_leg2_up = m_hlt_efficiencies.at("DoubleEleLowPtleg")->get(p_hlt_lep2)[2];
+        error_eff_lep1_leg1_up = m_config->hlt_efficiencies.at("DoubleEleHighPtleg")->get(p_hlt_lep1)[2];
+        error_eff_lep1_leg2_up = m_config->hlt_efficiencies.at("DoubleEleLowPtleg")->get(p_hlt_lep1)[2];
+        error_eff_lep2_leg1_up = m_config->hlt_efficiencies.at("DoubleEleHighPtleg")->get(p_hlt_lep2)[2];
+        error_eff_lep2_leg2_up = m_config->hlt_efficiencies.at("DoubleEleLowPtleg")->get(p_hlt_lep2)[2];
     }
 
     float error_eff_lep1_leg1_down = 0.;
@@ -508,28 +562,28 @@ void HHAnalyzer::fillTriggerEfficiencies(const Lepton & lep1, const Lepton & lep
     float error_eff_lep2_leg2_down = 0.;
 
     if (lep1.isMu && lep2.isMu) {
-        error_eff_lep1_leg1_down = m_hlt_efficiencies.at("IsoMu17leg")->get(p_hlt_lep1)[1];
-        error_eff_lep1_leg2_down = m_hlt_efficiencies.at("IsoMu8orIsoTkMu8leg")->get(p_hlt_lep1)[1];
-        error_eff_lep2_leg1_down = m_hlt_efficiencies.at("IsoMu17leg")->get(p_hlt_lep2)[1];
-        error_eff_lep2_leg2_down = m_hlt_efficiencies.at("IsoMu8orIsoTkMu8leg")->get(p_hlt_lep2)[1];
+        error_eff_lep1_leg1_down = m_config->hlt_efficiencies.at("IsoMu17leg")->get(p_hlt_lep1)[1];
+        error_eff_lep1_leg2_down = m_config->hlt_efficiencies.at("IsoMu8orIsoTkMu8leg")->get(p_hlt_lep1)[1];
+        error_eff_lep2_leg1_down = m_config->hlt_efficiencies.at("IsoMu17leg")->get(p_hlt_lep2)[1];
+        error_eff_lep2_leg2_down = m_config->hlt_efficiencies.at("IsoMu8orIsoTkMu8leg")->get(p_hlt_lep2)[1];
     }
     else if (lep1.isMu && lep2.isEl) {
-        error_eff_lep1_leg1_down = m_hlt_efficiencies.at("IsoMu23leg")->get(p_hlt_lep1)[1];
-        error_eff_lep1_leg2_down = m_hlt_efficiencies.at("IsoMu8leg")->get(p_hlt_lep1)[1];
-        error_eff_lep2_leg1_down = m_hlt_efficiencies.at("EleMuHighPtleg")->get(p_hlt_lep2)[1];
-        error_eff_lep2_leg2_down = m_hlt_efficiencies.at("MuEleLowPtleg")->get(p_hlt_lep2)[1];
+        error_eff_lep1_leg1_down = m_config->hlt_efficiencies.at("IsoMu23leg")->get(p_hlt_lep1)[1];
+        error_eff_lep1_leg2_down = m_config->hlt_efficiencies.at("IsoMu8leg")->get(p_hlt_lep1)[1];
+        error_eff_lep2_leg1_down = m_config->hlt_efficiencies.at("EleMuHighPtleg")->get(p_hlt_lep2)[1];
+        error_eff_lep2_leg2_down = m_config->hlt_efficiencies.at("MuEleLowPtleg")->get(p_hlt_lep2)[1];
     }
     else if (lep1.isEl && lep2.isMu) {
-        error_eff_lep1_leg1_down = m_hlt_efficiencies.at("EleMuHighPtleg")->get(p_hlt_lep1)[1];
-        error_eff_lep1_leg2_down = m_hlt_efficiencies.at("MuEleLowPtleg")->get(p_hlt_lep1)[1];
-        error_eff_lep2_leg1_down = m_hlt_efficiencies.at("IsoMu23leg")->get(p_hlt_lep2)[1];
-        error_eff_lep2_leg2_down = m_hlt_efficiencies.at("IsoMu8leg")->get(p_hlt_lep2)[1];
+        error_eff_lep1_leg1_down = m_config->hlt_efficiencies.at("EleMuHighPtleg")->get(p_hlt_lep1)[1];
+        error_eff_lep1_leg2_down = m_config->hlt_efficiencies.at("MuEleLowPtleg")->get(p_hlt_lep1)[1];
+        error_eff_lep2_leg1_down = m_config->hlt_efficiencies.at("IsoMu23leg")->get(p_hlt_lep2)[1];
+        error_eff_lep2_leg2_down = m_config->hlt_efficiencies.at("IsoMu8leg")->get(p_hlt_lep2)[1];
     }
     else if (lep1.isEl && lep2.isEl){
-        error_eff_lep1_leg1_down = m_hlt_efficiencies.at("DoubleEleHighPtleg")->get(p_hlt_lep1)[1];
-        error_eff_lep1_leg2_down = m_hlt_efficiencies.at("DoubleEleLowPtleg")->get(p_hlt_lep1)[1];
-        error_eff_lep2_leg1_down = m_hlt_efficiencies.at("DoubleEleHighPtleg")->get(p_hlt_lep2)[1];
-        error_eff_lep2_leg2_down = m_hlt_efficiencies.at("DoubleEleLowPtleg")->get(p_hlt_lep2)[1];
+        error_eff_lep1_leg1_down = m_config->hlt_efficiencies.at("DoubleEleHighPtleg")->get(p_hlt_lep1)[1];
+        error_eff_lep1_leg2_down = m_config->hlt_efficiencies.at("DoubleEleLowPtleg")->get(p_hlt_lep1)[1];
+        error_eff_lep2_leg1_down = m_config->hlt_efficiencies.at("DoubleEleHighPtleg")->get(p_hlt_lep2)[1];
+        error_eff_lep2_leg2_down = m_config->hlt_efficiencies.at("DoubleEleLowPtleg")->get(p_hlt_lep2)[1];
     }
 
 
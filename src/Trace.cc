@@ -0,0 +1,96 @@
+#include <cp3_llbb/HHAnalysis/interface/Trace.h>
+
+#include <FWCore/Utilities/interface/EDMException.h>
+
+#include <fstream>
+#include <iostream>
+
+namespace HH {
+
+    std::shared_ptr<TraceRecorder> TraceRecorder::get(const std::string& path, size_t capacity) {
+        static std::mutex mutex;
+        static std::map<std::string, std::weak_ptr<TraceRecorder>> recorders;
+
+        std::lock_guard<std::mutex> lock(mutex);
+
+        std::weak_ptr<TraceRecorder>& entry = recorders[path];
+        std::shared_ptr<TraceRecorder> result = entry.lock();
+        if (!result) {
+            result = std::make_shared<TraceRecorder>(path, capacity);
+            entry = result;
+        }
+
+        return result;
+    }
+
+    TraceRecorder::TraceRecorder(const std::string& path, size_t capacity):
+        m_path(path), m_epoch(std::chrono::steady_clock::now()) {
+        if (capacity == 0)
+            throw edm::Exception(edm::errors::Configuration, "traceBufferSize must be at least 1");
+        m_buffer.reserve(capacity);
+    }
+
+    TraceRecorder::~TraceRecorder() {
+        write();
+    }
+
+    uint32_t TraceRecorder::addAnalyzer(const std::string& name, const std::vector<std::string>& track_names) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        uint32_t index = m_analyzers++;
+        for (size_t i = 0; i < track_names.size(); i++)
+            m_track_names[index * track_names.size() + i] = name + ": " + track_names[i];
+
+        return index;
+    }
+
+    void TraceRecorder::record(const TraceSlice& slice) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        if (m_buffer.size() < m_buffer.capacity())
+            m_buffer.push_back(slice);
+        else
+            m_buffer[m_next] = slice;
+        m_next = (m_next + 1) % m_buffer.capacity();
+        m_recorded++;
+    }
+
+    void TraceRecorder::write() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        std::ofstream out(m_path);
+        if (!out) {
+            std::cerr << "Cannot write the trace to '" << m_path << "'" << std::endl;
+            return;
+        }
+
+        auto microseconds = [](std::chrono::steady_clock::duration d) {
+            return std::chrono::duration<double, std::micro>(d).count();
+        };
+
+        out << "{\"traceEvents\": [";
+        bool first = true;
+
+        for (const auto& track: m_track_names) {
+            out << (first ? "" : ",") << "\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 0, \"tid\": " << track.first << ", \"args\": {\"name\": \"" << track.second << "\"}}";
+            first = false;
+        }
+
+        // Oldest first: once the buffer is full, the oldest slice is the one that would be overwritten next
+        size_t start = m_buffer.size() < m_buffer.capacity() ? 0 : m_next;
+        for (size_t i = 0; i < m_buffer.size(); i++) {
+            const TraceSlice& slice = m_buffer[(start + i) % m_buffer.size()];
+            out << (first ? "" : ",") << "\n{\"name\": \"" << slice.name << "\", \"ph\": \"X\", \"pid\": 0, \"tid\": " << slice.tid
+                << ", \"ts\": " << microseconds(slice.start - m_epoch) << ", \"dur\": " << microseconds(slice.duration)
+                << ", \"args\": {\"event\": " << slice.event << "}}";
+            first = false;
+        }
+
+        out << "\n]}" << std::endl;
+
+        std::cout << "Trace written to '" << m_path << "': " << m_buffer.size() << " slices";
+        if (m_recorded > m_buffer.size())
+            std::cout << " (" << m_recorded - m_buffer.size() << " older ones dropped)";
+        std::cout << std::endl;
+    }
+}
@@ -0,0 +1,29 @@
+#include <cp3_llbb/HHAnalysis/interface/TruthScans.h>
+
+#include <iostream>
+
+namespace HH {
+
+    TruthScanSwitch::TruthScanSwitch(const std::string& name, bool enabled, uint64_t detection_events):
+        m_name(name), m_detection_events(detection_events), m_enabled(enabled), m_decided(!enabled || detection_events == 0) {
+        if (!enabled)
+            std::cout << m_name << ": disabled by sampleType" << std::endl;
+    }
+
+    void TruthScanSwitch::observeSlow(bool found) {
+        // `m_found` is updated before `m_events`, so the thread seeing the last detection event sees all the found ones
+        if (found)
+            m_found++;
+
+        if (++m_events != m_detection_events)
+            return;
+
+        if (m_found == 0) {
+            m_enabled = false;
+            std::cout << m_name << ": nothing found in the first " << m_detection_events << " events, disabled for the rest of the job" << std::endl;
+        } else {
+            std::cout << m_name << ": found in " << m_found << " of the first " << m_detection_events << " events, kept" << std::endl;
+        }
+        m_decided = true;
+    }
+}
@@ -1,4 +1,6 @@
 
+import os
+
 import FWCore.ParameterSet.Config as cms
 
 from Configuration.StandardSequences.Eras import eras
@@ -39,6 +41,10 @@ framework.addAnalyzer('hh_analyzer', cms.PSet(
             jetsProducer = cms.string('jets'),
             metProducer = cms.string('met'),
             nohfMETProducer = cms.string('nohf_met'),
+            # MET variants of the met, llmet and llmetjj candidates, nominal first (default: metProducer only). The lepton and
+            # jet quantities are shared by the variants, only the MET-dependent ones are computed for each of them. met[i] and the
+            # candidates with imet = i use metProducers[i]; isNoHF only flags nohfMETProducer, use imet for any other variant
+            # metProducers = cms.untracked.vstring('met', 'nohf_met'),
 
             # Pre-selection pt cut, applied to all leptons
             leadingElectronPtCut = cms.untracked.double(25),
@@ -68,6 +74,105 @@ framework.addAnalyzer('hh_analyzer', cms.PSet(
             hltDRCut = cms.untracked.double(0.1),
             hltDPtCut = cms.untracked.double(0.5),  # cut will be DPt/Pt < hltDPtCut
             applyBJetRegression = cms.untracked.bool(False), # BE SURE TO ACTIVATE computeRegression FLAG BELOW
+            # If not 0, only the leading N selected jets (in pt order) are paired into jj and llmetjj. Bounds the cost of events with many jets;
+            # capped events are flagged with hh_jets_pairing_capped and counted at the end of the job
+            maxJetsForPairing = cms.untracked.uint32(0),
+            # Orderings of the jet pairs ('ht', 'mh', 'pt', 'csv', 'cmva' or 'ptOverM'), all ranked in one pass, and number of best
+            # 'cmva' pairs kept (0: all). llmetjj[0] (one candidate per MET variant) always uses the best sum(CMVAv2) pair, as the
+            # categories and histograms expect; each other ordering adds the candidates of its best pair, in the configured order,
+            # and hh_llmetjj_ranking tells which ordering picked each candidate. Only the kept pairs get their gen flavours, ΔR, ... computed
+            dijetRankings = cms.untracked.vstring('cmva'),
+            maxDijets = cms.untracked.uint32(1),
+
+            # Gen-reco ΔR output: 'dense' (one entry per reco object and gen target) or 'sparse' (best genDeltaRTopK reco objects per gen target found)
+            genDeltaRMode = cms.untracked.string('dense'),
+            genDeltaRTopK = cms.untracked.uint32(1),
+
+            # 'struct': leptons, jets, met and llmetjj written as vectors of HH structs (needs the dictionaries from src/classes_def.xml)
+            # 'flat': one primitive-typed branch per member, e.g. hh_jets_pt or hh_llmetjj_MT2
+            # 'none': nothing written to the tree (cut flow, metadata and histograms only)
+            outputMode = cms.untracked.string('struct'),
+            # Per-branch policy of the flat output. A report of the uncompressed bytes per branch is printed at the end of the job, with an
+            # estimate (not a measurement) of the reduced-precision columns once compressed; hhReplay --memory measures the compressed bytes
+            #outputPolicy = cms.untracked.PSet(
+            #    drop = cms.untracked.vstring('llmetjj_gen_*'), # '*' wildcards, matched against the branch name without prefix
+            #    deduplicate = cms.untracked.bool(True), # drop llmetjj four-vectors duplicating the leptons / jets / met ones
+            #    reducedPrecision = cms.untracked.vstring('*_pt', '*_eta', '*_e'),
+            #    mantissaBits = cms.untracked.uint32(10),
+            #    fixedPointAngles = cms.untracked.bool(True), # phi stored as int16 in *_phi_fp16 branches
+            #),
+
+            # Histograms of llmetjj[0], filled directly in the job for each category (elel, elmu, muel, mumu, with the lepton pt cuts of
+            # categories_parameters, as the skim) with the event
+            # weight, times the trigger efficiency unless triggerEfficiency is False. Variables are named after the flat llmetjj
+            # columns, plus <p4>_M for the masses. Written at the end of the job, as TH1D / TH2D
+            # named <analyzer>_<name>_<flavour>
+            #histograms = cms.untracked.VPSet(
+            #    cms.untracked.PSet(name = cms.untracked.string('mjj'), x = cms.untracked.string('jj_M'), nBinsX = cms.untracked.uint32(50), xMin = cms.untracked.double(0), xMax = cms.untracked.double(500)),
+            #    cms.untracked.PSet(name = cms.untracked.string('mll_vs_mjj'),
+            #        x = cms.untracked.string('jj_M'), nBinsX = cms.untracked.uint32(25), xMin = cms.untracked.double(0), xMax = cms.untracked.double(500),
+            #        y = cms.untracked.string('ll_M'), nBinsY = cms.untracked.uint32(25), yMin = cms.untracked.double(0), yMax = cms.untracked.double(250)),
+            #),
+            #histogramsFile = cms.untracked.string('histograms.root'),
+
+            # Yields of a grid of thresholds, computed in the same job: product of the lepton pt (harder and softer lepton of ll),
+            # jet-lepton ΔR and b-tagging (discr_name) cuts. Missing lists scan the analyzer value alone (no cut for the lepton pt).
+            # An event enters a grid point with an ll candidate and two paired jets passing its ΔR and b-tagging cuts, weighted by the
+            # event weight times the trigger efficiency. Values looser than the analyzer selection act as the latter. One line per
+            # flavour (elel, elmu, muel, mumu) and grid point is written to `file`, at most 64 values per list
+            #cutScan = cms.untracked.PSet(
+            #    leadingLeptonPtCuts = cms.untracked.vdouble(20, 25, 30),
+            #    subleadingLeptonPtCuts = cms.untracked.vdouble(10, 15, 20),
+            #    minDRLJCuts = cms.untracked.vdouble(0.3, 0.4, 0.5),
+            #    bDiscrCuts = cms.untracked.vdouble(0.185, 0.4432, 0.9432),
+            #    file = cms.untracked.string('cut_scan.tsv'),
+            #),
+
+            # Skim: the events of each dilepton category (same selection as categories_parameters) are also written to `file`, in one tree
+            # per analyzer and category (hh_analyzer_mumu, ...) holding run, lumi, event, event_weight and the flat columns of leptons, jets,
+            # met and llmetjj. `indexFile` (default: file + '.index') lists the (run, lumi, event, tree, entry) of the skimmed events,
+            # sorted, for lookups with HH::SkimIndex (interface/Skim.h). Combine with outputMode = 'none' to only write the skim.
+            # With `asynchronous`, the events are copied to a staging buffer of `bufferEvents` events and the trees are filled and
+            # compressed by a background thread; the analyzer only waits when both buffers are full. Only the skim is asynchronous,
+            # the main tree is still filled synchronously by the framework
+            #skim = cms.untracked.PSet(
+            #    file = cms.untracked.string('skim.root'),
+            #    categories = cms.untracked.vstring('elel', 'elmu', 'muel', 'mumu'),
+            #    asynchronous = cms.untracked.bool(True),
+            #    bufferEvents = cms.untracked.uint32(1000),
+            #),
+
+            # Binary records of the events with a llmetjj candidate (leptons, jets, met and llmetjj), readable without ROOT with the
+            # header-only interface/EventRecordReader.h. The layout is described in interface/EventRecordLayout.h
+            #recordsFile = cms.untracked.string('records.bin'),
+
+            # BR(tau -> e / mu) correction of the signal samples: 'reject' events at random (seeded per event with tauBRSeed), or 'weight' them (hh_gen_tau_br_weight)
+            tauBRCorrection = cms.untracked.string('reject'),
+            tauBRSeed = cms.untracked.uint32(42),
+            # By default the gen truth is only filled for the events with at least two selected leptons able to form an ll candidate (the only ones written). True: fill it for every event (acceptance studies)
+            fillTruthForAllEvents = cms.untracked.bool(False),
+            # Gen truth scans to run: 'all' (default, both on every event, as before), 'signal' (HH only), 'ttbar', 'background' (none),
+            # or 'auto' (opt-in): both, each one disabled for the rest of the job if it finds nothing in the first sampleDetectionEvents events
+            sampleType = cms.untracked.string('all'),
+            sampleDetectionEvents = cms.untracked.uint32(1000),
+
+            # Time the stages of the analyzer (count, mean, p50, p99 and max), printed and stored in the metadata at the end of the job
+            stageTimers = cms.untracked.bool(False),
+            # Heap allocations per stage and per event, and peak capacity of the collections. Allocations are only counted by `hhReplay --memory`, which installs the allocation hook
+            memoryReport = cms.untracked.bool(False),
+            # Capture the analyzer inputs of each event to this file, to be replayed offline with `hhReplay` (bin/hhReplay.cc).
+            # test/checkReplay.sh --update sets it through HH_CAPTURE_INPUTS to create the reference inputs of the golden-output check
+            captureInputs = cms.untracked.string(os.environ.get('HH_CAPTURE_INPUTS', '')),
+            # Capture only the inputs of the slow events to this file, also to be replayed with `hhReplay`. An event is slow when analyze()
+            # takes more than slowEventThreshold ms, or more than the slowEventQuantile quantile of the previous events (0 disables either)
+            slowEventsFile = cms.untracked.string(''),
+            slowEventThreshold = cms.untracked.double(0),
+            slowEventQuantile = cms.untracked.double(0.999),
+            # Timeline of the stages of one event in traceSampling (by event number, so the same events in all systematic clones), as Chrome trace-event JSON
+            # for chrome://tracing or ui.perfetto.dev. At most traceBufferSize slices are kept, the oldest are dropped
+            traceFile = cms.untracked.string(''),
+            traceSampling = cms.untracked.uint32(100),
+            traceBufferSize = cms.untracked.uint32(100000),
 
             hlt_efficiencies = cms.untracked.PSet(
 
@@ -113,6 +218,8 @@ if runOnData:
             '/store/data/Run2016F/DoubleMuon/MINIAOD/23Sep2016-v1/50000/040EDEBA-0490-E611-A424-008CFA110C68.root'
         )
 else: 
+    # The hh_ branches of the main tree are filled and compressed by the Framework on the event thread, every treeFlushSize
+    # bytes. Only the skim (see `skim` above) has an asynchronous writer
     process.framework.treeFlushSize = cms.untracked.uint64(5 * 1024 * 1024)
 
     process.source.fileNames = cms.untracked.vstring(
@@ -0,0 +1,78 @@
+#!/bin/bash
+
+# Golden-output regression check of HHAnalyzer, run offline with hhReplay on the reference inputs of test/replay
+# (see "Offline replay" in README.md). Needs a CMSSW environment where the package is built. Run by `scram b runtests`
+# (test/BuildFile.xml).
+#
+#   test/checkReplay.sh                        replay test/replay/inputs.bin and compare with test/replay/golden.root
+#   test/checkReplay.sh --update REFERENCE_AREA
+#                                              capture new reference inputs with test/HHConfiguration.py of this area,
+#                                              and write their golden output with the analyzer built in the CMSSW area
+#                                              REFERENCE_AREA (the baseline the changes are checked against, e.g. the
+#                                              last release of the package), from its own test/HHConfiguration.py
+#
+# The golden output is the Framework output file of the reference job: hhReplay finds the replayed events in it by
+# their id, and only compares the branches of the analyzer. Both jobs read the first ${EVENTS} events of the same
+# input file, so the two HHConfiguration.py must have the same process.source. Commit inputs.bin and golden.root.
+#
+# Other arguments are given to hhReplay, e.g. --tolerance 'hh_llmetjj.MT2=1e-4'. The exit code is the one of
+# hhReplay: 2 if the output differs from the golden one.
+
+# Events captured by --update, and passes over them: the second pass checks that no state leaks from one event to
+# the next. Every pass is compared with the golden output
+EVENTS=20
+LOOPS=2
+
+TEST_DIR=$(cd $(dirname ${BASH_SOURCE[0]}) && pwd)
+REPLAY_DIR=${TEST_DIR}/replay
+WORK_DIR=$(mktemp -d)
+trap "rm -rf ${WORK_DIR}" EXIT
+
+if [ "$1" == "--update" ];
+then
+    REFERENCE_AREA=$2
+    if [ -z "${REFERENCE_AREA}" -o ! -f "${REFERENCE_AREA}/src/cp3_llbb/HHAnalysis/test/HHConfiguration.py" ];
+    then
+        echo "Usage: $0 --update REFERENCE_AREA, with the reference version of cp3_llbb/HHAnalysis built in REFERENCE_AREA"
+        exit 1
+    fi
+    REFERENCE_AREA=$(cd ${REFERENCE_AREA} && pwd)
+    shift 2
+
+    mkdir -p ${REPLAY_DIR} ${WORK_DIR}/capture ${WORK_DIR}/reference
+
+    # Inputs captured with this area: HHConfiguration.py reads the capture path from HH_CAPTURE_INPUTS
+    cat > ${WORK_DIR}/capture/capture_cfg.py <<END
+exec(open('${TEST_DIR}/HHConfiguration.py').read())
+process.maxEvents = cms.untracked.PSet(input = cms.untracked.int32(${EVENTS}))
+END
+    (cd ${WORK_DIR}/capture && HH_CAPTURE_INPUTS=${REPLAY_DIR}/inputs.bin cmsRun capture_cfg.py) || exit 1
+
+    # Golden output written by the reference analyzer, in the environment of its own area
+    cat > ${WORK_DIR}/reference/reference_cfg.py <<END
+exec(open('${REFERENCE_AREA}/src/cp3_llbb/HHAnalysis/test/HHConfiguration.py').read())
+process.maxEvents = cms.untracked.PSet(input = cms.untracked.int32(${EVENTS}))
+END
+    (cd ${REFERENCE_AREA}/src && eval $(scram runtime -sh) && cd ${WORK_DIR}/reference && cmsRun reference_cfg.py) || exit 1
+    OUTPUTS=(${WORK_DIR}/reference/*.root)
+    if [ ${#OUTPUTS[@]} -ne 1 -o ! -f "${OUTPUTS[0]}" ];
+    then
+        echo "Expected one output file from the reference job, found: ${OUTPUTS[@]}"
+        exit 1
+    fi
+    cp ${OUTPUTS[0]} ${REPLAY_DIR}/golden.root
+
+    # The reference must agree with itself: check the new files right away
+    hhReplay ${REPLAY_DIR}/inputs.bin -n ${LOOPS} -o ${WORK_DIR}/output.root --golden ${REPLAY_DIR}/golden.root "$@"
+    STATUS=$?
+    echo "New reference written to ${REPLAY_DIR} from ${REFERENCE_AREA}: commit inputs.bin and golden.root"
+    exit ${STATUS}
+fi
+
+if [ ! -f ${REPLAY_DIR}/inputs.bin -o ! -f ${REPLAY_DIR}/golden.root ];
+then
+    echo "No reference in ${REPLAY_DIR}: create it first with $0 --update REFERENCE_AREA"
+    exit 1
+fi
+
+hhReplay ${REPLAY_DIR}/inputs.bin -n ${LOOPS} -o ${WORK_DIR}/output.root --golden ${REPLAY_DIR}/golden.root "$@"